@@ -0,0 +1,69 @@
+"""
+Content addressed cache of build artifacts for the compiled backends, and of the parsed ASTs for the python backend
+
+Entries live under $DEWY_CACHE_DIR, or $XDG_CACHE_HOME/dewy, or ~/.cache/dewy, in a directory named by the
+hash of the program source, the language version, the backend, and every file the backend's output depends on
+(e.g. its runtime, and the compiler's own sources). An entry is only visible once it is complete, so concurrent
+builds of the same program at worst do the work twice.
+"""
+
+from pathlib import Path
+from hashlib import sha256
+from tempfile import mkdtemp
+from typing import Iterable
+import os
+import shutil
+
+
+def cache_root() -> Path:
+    if 'DEWY_CACHE_DIR' in os.environ:
+        return Path(os.environ['DEWY_CACHE_DIR'])
+    xdg = os.environ.get('XDG_CACHE_HOME') or Path.home() / '.cache'
+    return Path(xdg) / 'dewy'
+
+
+def compiler_sources() -> list[Path]:
+    """python sources of the dewy compiler itself, so that changing the compiler invalidates what it built"""
+    src_root = Path(__file__).parent.parent
+    return sorted(p for p in src_root.rglob('*.py') if 'tests' not in p.parts)
+
+
+def cache_key(source: bytes, backend: str, dependencies: Iterable[Path]) -> str:
+    from . import get_version # deferred since this module is imported while the backend package is initializing
+
+    h = sha256()
+    for part in (get_version().encode(), backend.encode(), source):
+        h.update(len(part).to_bytes(8, 'little'))
+        h.update(part)
+    for path in dependencies:
+        data = path.read_bytes()
+        h.update(str(path.name).encode())
+        h.update(len(data).to_bytes(8, 'little'))
+        h.update(data)
+    return h.hexdigest()
+
+
+def lookup(backend: str, key: str) -> Path | None:
+    """directory of the finished cache entry for key, if there is one"""
+    entry = cache_root() / backend / key
+    return entry if entry.is_dir() else None
+
+
+def reserve(backend: str) -> Path:
+    """scratch directory on the same filesystem as the cache, to build an entry in before calling commit"""
+    staging = cache_root() / backend / 'tmp'
+    staging.mkdir(parents=True, exist_ok=True)
+    return Path(mkdtemp(dir=staging))
+
+
+def commit(backend: str, key: str, build_dir: Path) -> Path:
+    """atomically publish build_dir as the entry for key. Returns the entry directory"""
+    entry = cache_root() / backend / key
+    try:
+        os.rename(build_dir, entry)
+    except OSError:
+        # another build of the same program finished first. Theirs is identical, so keep it
+        shutil.rmtree(build_dir, ignore_errors=True)
+        if not entry.is_dir():
+            raise
+    return entry
@@ -17,17 +17,49 @@
 // write syscall:
 //     %rax: syscall number, %rdi: file descriptor, %rsi: buffer, %rdx: number of bytes
 //     %rax: return value
-int write(char* buf, int len)
+int sys_write(char* buf, int len)
 {
     int n;
     asm volatile("syscall\n" : "=A"(n) : "a"(SYS_write), "D"(stderr), "S"(buf), "d"(len));
     return n;
 }
 
+// buffered output. writes are collected in outbuf and only sent to the OS when
+// the buffer is full, or when flush() is called (exit() flushes automatically)
+#define outbuf_size 65536
+char outbuf[outbuf_size];
+int outlen = 0;
+void flush()
+{
+    int i = 0;
+    while (i < outlen)
+    {
+        int n = sys_write(&outbuf[i], outlen - i);
+        if (n <= 0) break;
+        i += n;
+    }
+    outlen = 0;
+}
+void write(char* buf, int len)
+{
+    if (outlen + len > outbuf_size)
+    {
+        flush();
+        if (len >= outbuf_size)
+        {
+            sys_write(buf, len);
+            return;
+        }
+    }
+    for (int i = 0; i < len; i++) outbuf[outlen + i] = buf[i];
+    outlen += len;
+}
+
 // exit syscall:
 //     %rax: syscall number, %rdi: exit code
 void exit(int code)
 {
+    flush();
     // infinite loop until the system ends this process
     for (;;) asm volatile("syscall\n" : : "a"(SYS_exit), "D"(code));
 }
@@ -41,28 +73,11 @@ int strlen(char* s)
     return i;
 }
 void puts(char* s) { write(s, strlen(s)); }
-#define buf_size 32
-char buf[buf_size];
-void puti(unsigned int i)
-{
-    int len = 0;
-    do {
-        buf[buf_size - ++len] = '0' + i % 10;
-        i /= 10;
-    } while (i > 0);
-    write(&buf[buf_size - len], len);
-}
-void putx(unsigned int i)
-{
-    int len = 0;
-    do {
-        buf[buf_size - ++len] = '0' + i % 16 > 9 ? 'A' + i % 16 - 10 : '0' + i % 16;
-        i /= 16;
-    } while (i > 0);
-    buf[buf_size - ++len] = 'x';
-    buf[buf_size - ++len] = '0';
-    write(&buf[buf_size - len], len);
-}
+#include "../runtime/fmt.c"
+uint8_t buf[FMT_F64_MAX];
+void puti(unsigned int i) { write((char*)buf, __fmt_u64(buf, i)); }
+void putx(unsigned int i) { write((char*)buf, __fmt_u64x(buf, i)); }
+void putf(double d) { write((char*)buf, __fmt_f64(buf, d)); }
 void putl() { write("\n", 1); }
 
 // TODO->move to a separate file
@@ -83,6 +98,8 @@ int main(int argc, char** argv)
     }
 
     puts("Hello, World!\n");
+    putf(3.14159);
+    putl();
     // puti(42);
     // putl();
     // putx(0xDEADBEEF);
@@ -94,6 +111,9 @@ int main(int argc, char** argv)
     // putl();
     // puti(200);
     // putl();
+
+    // nothing flushes on return from main without a _start that calls exit
+    flush();
     return 0;
 }
 
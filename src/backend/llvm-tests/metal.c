@@ -2,73 +2,233 @@
 #define METAL_C
 
 #include "metal.h"
+#include "../runtime/fmt.c"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+////// buffered output //////
+// all output goes through a runtime-owned buffer which is flushed when full,
+// on newlines in line-buffered mode, before reading stdin, and at exit
+static uint8_t __outbuf[OUTBUF_SIZE];
+static uint64_t __outlen = 0;
+static uint8_t __outmode = BUFMODE_AUTO;
+static uint8_t __outinit = 0;
+
+static void __outsetup()
+{
+    __outinit = 1;
+    if (__outmode == BUFMODE_AUTO) __outmode = isatty(STDOUT_FILENO) ? BUFMODE_LINE : BUFMODE_FULL;
+    atexit(__flush);
+}
+static void __outraw(uint8_t* s, uint64_t len)
+{
+    fwrite(s, len, 1, stdout);
+    fflush(stdout);
+}
+void __flush()
+{
+    if (__outlen == 0) return;
+    __outraw(__outbuf, __outlen);
+    __outlen = 0;
+}
+void __setbufmode(uint8_t mode)
+{
+    __flush();
+    __outmode = mode;
+    if (__outinit && __outmode == BUFMODE_AUTO) __outmode = isatty(STDOUT_FILENO) ? BUFMODE_LINE : BUFMODE_FULL;
+}
+void __write(uint8_t* s, uint64_t len)
+{
+    if (!__outinit) __outsetup();
+    if (__outlen + len > OUTBUF_SIZE)
+    {
+        __flush();
+        // too big to ever fit, so skip the buffer entirely
+        if (len >= OUTBUF_SIZE)
+        {
+            __outraw(s, len);
+            return;
+        }
+    }
+    memcpy(&__outbuf[__outlen], s, len);
+    __outlen += len;
+    if (__outmode == BUFMODE_LINE && memchr(s, '\n', len) != NULL) __flush();
+}
 
 ////// writing to stdout //////
 
-void __puts(uint8_t* s) { fputs((char*)s, stdout); }
+void __puts(uint8_t* s) { __write(s, strlen((char*)s)); }
 void __putu64(uint64_t u)
 {
-    const uint64_t buf_size = 20;
-    uint8_t buf[buf_size];
-    uint8_t len = 0;
-    do {
-        buf[buf_size - ++len] = '0' + u % 10;
-        u /= 10;
-    } while (u > 0);
-    fwrite(&buf[buf_size - len], len, 1, stdout);
-}
-void __putu64x(uint64_t u)
-{
-    const uint64_t buf_size = 18; // 16 for number, 2 for '0x'
-    uint8_t buf[buf_size];
-    uint8_t len = 0;
-    do {
-        uint8_t v = u % 16;
-        buf[buf_size - ++len] = u < 10 ? '0' + v : 'A' + v - 10;
-        u /= 16;
-    } while (u > 0);
-    buf[buf_size - ++len] = 'x';
-    buf[buf_size - ++len] = '0';
-    fwrite(&buf[buf_size - len], len, 1, stdout);
+    uint8_t buf[FMT_U64_MAX];
+    __write(buf, __fmt_u64(buf, u));
+}
+void __putu64x(uint64_t x)
+{
+    uint8_t buf[FMT_X64_MAX];
+    __write(buf, __fmt_u64x(buf, x));
 }
 void __puti64(int64_t i)
 {
-    if (i < 0)
+    uint8_t buf[FMT_I64_MAX];
+    __write(buf, __fmt_i64(buf, i));
+}
+void __putf32(float f)
+{
+    uint8_t buf[FMT_F64_MAX];
+    __write(buf, __fmt_f32(buf, f));
+}
+void __putf64(double d)
+{
+    uint8_t buf[FMT_F64_MAX];
+    __write(buf, __fmt_f64(buf, d));
+}
+void __putl() { __write((uint8_t*)"\n", 1); }
+
+////// reading from stdin //////
+// stdin is read in large blocks into a runtime-owned buffer. __getdlv returns a
+// zero-copy view into it (null terminated in place of the delimiter), which stays
+// valid until the next call that reads stdin. Returns -1 at EOF with no data left
+static uint8_t* __inbuf = NULL;
+static uint64_t __incap = 0; // allocated size of __inbuf
+static uint64_t __inpos = 0; // start of unconsumed data
+static uint64_t __inend = 0; // end of valid data
+static uint8_t __ineof = 0;
+
+// compact unconsumed data to the front, grow if needed, and read another block. Returns 0 at EOF
+static uint64_t __infill()
+{
+    if (__ineof) return 0;
+    if (__inpos > 0)
+    {
+        memmove(__inbuf, __inbuf + __inpos, __inend - __inpos);
+        __inend -= __inpos;
+        __inpos = 0;
+    }
+    // always keep one spare byte so that views can be null terminated
+    if (__incap - __inend <= 1)
+    {
+        uint64_t cap = __incap == 0 ? INBUF_SIZE : __incap * 2;
+        uint8_t* buf = (uint8_t*)realloc(__inbuf, cap);
+        if (buf == NULL) return 0;
+        __inbuf = buf;
+        __incap = cap;
+    }
+    __flush(); // make sure any prompt is visible before blocking on stdin
+    ssize_t n;
+    do n = read(STDIN_FILENO, __inbuf + __inend, __incap - __inend - 1);
+    while (n < 0 && errno == EINTR);
+    if (n <= 0)
+    {
+        __ineof = 1;
+        return 0;
+    }
+    __inend += n;
+    return n;
+}
+
+uint64_t __getlv(uint8_t** dst) { return __getdlv(dst, '\n'); }
+uint64_t __getdlv(uint8_t** dst, uint8_t delimiter)
+{
+    uint64_t scanned = 0; // bytes after __inpos already known not to contain the delimiter
+    for (;;)
     {
-        fputc('-', stdout);
-        i = -i;
+        uint64_t avail = __inend - __inpos;
+        if (scanned < avail)
+        {
+            uint8_t* start = __inbuf + __inpos;
+            uint8_t* hit = (uint8_t*)memchr(start + scanned, delimiter, avail - scanned);
+            if (hit != NULL)
+            {
+                uint64_t len = hit - start;
+                *hit = '\0';
+                *dst = start;
+                __inpos += len + 1;
+                return len;
+            }
+            scanned = avail;
+        }
+        if (__infill() == 0) break;
     }
-    __putu64((uint64_t)i);
+
+    // EOF: hand back whatever is left without a trailing delimiter
+    uint64_t len = __inend - __inpos;
+    if (len == 0)
+    {
+        *dst = (uint8_t*)"";
+        return -1;
+    }
+    __inbuf[__inend] = '\0';
+    *dst = __inbuf + __inpos;
+    __inpos = __inend;
+    return len;
 }
-void __putf32(float f) { printf("%f", f); }
-void __putf64(double d) { printf("%f", d); }
-void __putl() { fputc('\n', stdout); }
 
-////// reading from stdin //////
+// compatibility wrappers returning a heap allocated copy of the line
 uint64_t __getl(uint8_t** dst) { return __getdl(dst, '\n'); }
 uint64_t __getdl(uint8_t** dst, uint8_t delimiter)
 {
-    uint64_t buf_size = 128; // initial buffer size
-    uint64_t count = 0;      // characters read
-    uint64_t c;              // current character
-    uint8_t* buf = malloc(buf_size);
+    uint8_t* view;
+    uint64_t len = __getdlv(&view, delimiter);
+    if (len == (uint64_t)-1) len = 0;
+    uint8_t* buf = (uint8_t*)malloc(len + 1);
     if (buf == NULL) return -1;
-    while ((c = fgetc(stdin)) != EOF && c != delimiter)
+    memcpy(buf, view, len);
+    buf[len] = '\0';
+
+    *dst = buf;
+    return len;
+}
+
+////// threads //////
+// threads are pthreads. The mutex/condvar in ../runtime/sync.c sit on linux futexes directly
+void __futex_wait(uint32_t* addr, uint32_t expected) { syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0); }
+void __futex_wake(uint32_t* addr, uint32_t count) { syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0); }
+void* __thread_spawn(void* (*fn)(void*), void* arg)
+{
+    pthread_t* thread = (pthread_t*)malloc(sizeof(pthread_t));
+    if (thread == NULL) return NULL;
+    if (pthread_create(thread, NULL, fn, arg) != 0)
     {
-        if (count + 1 >= buf_size)
-        {
-            buf_size *= 2;
-            buf = realloc(buf, buf_size);
-            if (buf == NULL) return -1;
-        }
-        buf[count++] = c;
+        free(thread);
+        return NULL;
     }
-    buf[count] = '\0';
+    return thread;
+}
+void* __thread_join(void* thread)
+{
+    void* result = NULL;
+    pthread_join(*(pthread_t*)thread, &result);
+    free(thread);
+    return result;
+}
+#include "../runtime/atomic.c"
+#include "../runtime/sync.c"
 
-    *dst = buf;
-    return count;
+////// timing //////
+uint64_t __time()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+uint64_t __cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return __time();
+#endif
 }
 
 #endif
\ No newline at end of file
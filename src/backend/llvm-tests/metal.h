@@ -6,7 +6,19 @@
 
 #include <stdint.h>
 
+// output buffering modes for __setbufmode
+#define OUTBUF_SIZE 65536
+#define BUFMODE_FULL 0 // flush only when the buffer is full (or on __flush/exit)
+#define BUFMODE_LINE 1 // additionally flush after every newline
+#define BUFMODE_AUTO 2 // (default) line buffered if stdout is a terminal, otherwise fully buffered
+
+// initial size of the stdin buffer, grows to fit lines longer than this
+#define INBUF_SIZE 65536
+
 // printing to stdout
+void __write(uint8_t* s, uint64_t len);
+void __flush();
+void __setbufmode(uint8_t mode);
 void __puts(uint8_t* s);
 void __putu64(uint64_t u);
 void __putu64x(uint64_t x);
@@ -16,5 +28,29 @@ void __putf64(double d);
 void __putl();
 uint64_t __getl(uint8_t** dst);
 uint64_t __getdl(uint8_t** dst, uint8_t delimiter);
+uint64_t __getlv(uint8_t** dst);                     // zero-copy, valid until the next read
+uint64_t __getdlv(uint8_t** dst, uint8_t delimiter); // zero-copy, valid until the next read
+
+// timing
+uint64_t __time();   // monotonic nanoseconds
+uint64_t __cycles(); // cpu timestamp counter
+
+// threads and synchronization (see ../runtime/atomic.h and ../runtime/sync.h)
+void* __thread_spawn(void* (*fn)(void*), void* arg);
+void* __thread_join(void* thread);
+uint64_t __aloadl(uint64_t* ptr);
+void __astorel(uint64_t* ptr, uint64_t value);
+uint64_t __acasl(uint64_t* ptr, uint64_t expected, uint64_t desired);
+uint64_t __afaddl(uint64_t* ptr, uint64_t value);
+uint32_t __aloadw(uint32_t* ptr);
+void __astorew(uint32_t* ptr, uint32_t value);
+uint32_t __acasw(uint32_t* ptr, uint32_t expected, uint32_t desired);
+uint32_t __afaddw(uint32_t* ptr, uint32_t value);
+void __mutex_lock(uint32_t* mutex);
+uint8_t __mutex_trylock(uint32_t* mutex);
+void __mutex_unlock(uint32_t* mutex);
+void __cond_wait(uint32_t* cond, uint32_t* mutex);
+void __cond_signal(uint32_t* cond);
+void __cond_broadcast(uint32_t* cond);
 
 #endif
\ No newline at end of file
@@ -6,7 +6,7 @@ from ..dtypes import (
     register_typeof, short_circuit,
     CallableBase, IndexableBase, IndexerBase, MultipliableBase, ObjectBase,
 )
-from ..parser import top_level_parse, QJux
+from ..parser import top_level_parse, parse_lines, QJux
 from ..syntax import (
     AST,
     Type, TypeParam,
@@ -19,7 +19,7 @@ from ..syntax import (
     Identifier, Express, Declare,
     PrototypeBuiltin, Call, Access, Index,
     Assign,
-    Int, Bool,
+    Int, Bool, make_int, make_bool,
     Range, IterIn,
     BinOp,
     Less, LessEqual, Greater, GreaterEqual, Equal, MemberIn,
@@ -31,17 +31,27 @@ from ..syntax import (
     CycleLeft, CycleRight, Suppress,
     BroadcastOp,
     CollectInto, SpreadOutFrom,
+    DeclarationType,
 )
 
-from ..postparse import post_parse, FunctionLiteral, Signature, normalize_function_args
+from ..postparse import post_parse, fold_constants, FunctionLiteral, Signature, normalize_function_args
 from ..utils import Options
+from ..profiler import Profiler
+from . import cache as build_cache
 
 from dataclasses import dataclass, field
 from pathlib import Path
-from typing import Protocol, cast, Callable as TypingCallable, Any, Generic
+from typing import Protocol, cast, Callable as TypingCallable, Any, Generic, Iterable, Iterator
+from contextlib import nullcontext
+from io import BytesIO, TextIOWrapper
+import pickle
+import shutil
+import sys
 from functools import cache
-from collections import defaultdict
 from types import SimpleNamespace
+from array import array
+from itertools import repeat
+import operator
 
 
 import pdb
@@ -49,24 +59,111 @@ import pdb
 
 
 def python_interpreter(path: Path, args:list[str], options: Options) -> None:
-    # get the source code and tokenize
-    src = path.read_text()
-    tokens = tokenize(src)
-    post_process(tokens)
+    if options.profile is not None:
+        res = profiled_run(path, options)
+    elif options.cache and str(path) != '-':
+        res = evaluate_stream(cached_parse(path, options), options)
+    else:
+        # read the source a line at a time (`-` for stdin), and run each top level expression as soon as it's parsed
+        with (nullcontext(sys.stdin) if str(path) == '-' else open(path)) as lines:
+            asts = map(post_parse, parse_lines(lines))
+            if options.fold:
+                consts = {}
+                asts = (fold_constants(ast, consts) for ast in asts)
+            res = evaluate_stream(asts, options)
+    if res is not void:
+        print(res)
 
-    # parse tokens into AST
-    ast = top_level_parse(tokens)
-    ast = post_parse(ast)
 
-    # debug printing
-    if options.verbose:
-        print_ast(ast)
-        print(repr(ast))
+def profiled_run(path: Path, options: Options) -> AST:
+    """
+    Run a whole file with each stage of the pipeline, and every evaluation, timed (see profiler.py). The source is read
+    in full first and parsed in one go (without the AST cache), so that every stage is measured separately.
+    """
+    profiler = Profiler(str(path))
+    try:
+        src = sys.stdin.read() if str(path) == '-' else path.read_text()
+        with profiler.stage('tokenize'):
+            tokens = tokenize(src)
+        with profiler.stage('post_process'):
+            post_process(tokens)
+        if options.tokens:
+            print(tokens)
+        with profiler.stage('top_level_parse'):
+            ast = top_level_parse(tokens)
+        with profiler.stage('post_parse'):
+            ast = post_parse(ast)
+        if options.fold:
+            with profiler.stage('fold_constants'):
+                ast = fold_constants(ast)
+        with profiler.stage('evaluate'), profiler.instrument(sys.modules[__name__]):
+            return evaluate_stream([ast], options)
+    finally:
+        profiler.finish(options.profile)
 
-    # run the program
-    res = top_level_evaluate(ast)
-    if res is not void:
-        print(res)
+
+def cached_parse(path: Path, options: Options) -> Iterator[AST]:
+    """
+    The post parsed (and folded, if options.fold) top level expressions of a file, from the AST cache (see cache.py) if the same source was parsed
+    by the same version of the compiler before. Otherwise the file is parsed (still yielding each expression as soon
+    as it's parsed), and the ASTs are saved to the cache once the whole file has been parsed.
+    """
+    src = path.read_bytes()
+    key = build_cache.cache_key(src, 'python fold' if options.fold else 'python', build_cache.compiler_sources())
+    if (entry := build_cache.lookup('python', key)) is not None:
+        if options.verbose:
+            print(f'using cached AST {entry}')
+        with open(entry / 'program.dewyc', 'rb') as f:
+            unpickler = pickle.Unpickler(f)
+            for _ in range(unpickler.load()):
+                yield unpickler.load()
+        return
+
+    # each AST is pickled before it's evaluated, since evaluating it sets runtime caches on the nodes
+    asts = BytesIO()
+    pickler = pickle.Pickler(asts, pickle.HIGHEST_PROTOCOL)
+    count = 0
+    consts = {}
+    for ast in parse_lines(TextIOWrapper(BytesIO(src))):
+        ast = post_parse(ast)
+        if options.fold:
+            ast = fold_constants(ast, consts)
+        pickler.dump(ast)
+        count += 1
+        yield ast
+
+    build_dir = build_cache.reserve('python')
+    try:
+        with open(build_dir / 'program.dewyc', 'wb') as f:
+            pickle.dump(count, f, pickle.HIGHEST_PROTOCOL)
+            f.write(asts.getvalue())
+    except BaseException:
+        shutil.rmtree(build_dir, ignore_errors=True)
+        raise
+    build_cache.commit('python', key, build_dir)
+
+
+def evaluate_stream(asts: Iterable[AST], options: Options) -> AST:
+    """evaluate a program one post parsed top level expression at a time, returning what the whole program expresses (as evaluate_group)"""
+    scope = Scope.default()
+    insert_builtins(scope)
+
+    expressed: list[AST] = []
+    for ast in asts:
+        # debug printing
+        if options.verbose:
+            print_ast(ast)
+            print(repr(ast))
+
+        res = compile_closures(ast)(scope) if options.closures else evaluate(ast, scope)
+        if res is not void:
+            expressed.append(res)
+
+    if len(expressed) == 0:
+        return void
+    if len(expressed) == 1:
+        return expressed[0]
+    raise NotImplementedError(f'Block with multiple expressions not yet supported. {expressed=}')
 
 def python_repl(args: list[str], options: Options):
     try:
@@ -78,6 +175,7 @@ def python_repl(args: list[str], options: Options):
     # Set up scope to share between REPL calls
     scope = Scope.default()
     insert_builtins(scope)
+    consts = {} # top level consts folded into later inputs
 
     # get the source code and tokenize
     for src in REPL(history_file='~/.dewy/repl_history'):
@@ -100,6 +198,10 @@ def python_repl(args: list[str], options: Options):
             # parse tokens into AST
             ast = top_level_parse(tokens)
             ast = post_parse(ast)
+            # consts are only kept for later inputs if this one runs without error
+            input_consts = {**consts}
+            if options.fold:
+                ast = fold_constants(ast, input_consts)
 
             # debug printing
             if options.verbose:
@@ -107,7 +209,8 @@ def python_repl(args: list[str], options: Options):
                 print(repr(ast))
 
             # run the program (sharing the same scope)
-            res = evaluate(ast, scope)
+            res = compile_closures(ast)(scope) if options.closures else evaluate(ast, scope)
+            consts = input_consts
             if res is not void:
                 print(res)
         except Exception as e:
@@ -135,28 +238,37 @@ def top_level_evaluate(ast:AST) -> AST:
 
 class MetaNamespace(SimpleNamespace):
     """A simple namespace for storing AST meta attributes for use at runtime"""
-    def __getattribute__(self, key: str) -> Any | None:
-        """Get the attribute associated with the key, or None if it doesn't exist"""
-        try:
-            return super().__getattribute__(key)
-        except AttributeError:
-            return None
+    # the attributes used by the interpreter, so that reading them before they're set doesn't go through __getattr__
+    was_entered: bool | None = None
+    props: Any | None = None
+    call_args: tuple[list[AST], dict[str, AST]] | None = None
 
-    def __setattr__(self, key: str, value: Any) -> None:
-        """Set the attribute associated with the key"""
-        super().__setattr__(key, value)
+    def __getattr__(self, key: str) -> Any | None:
+        """Only called for attributes that haven't been set, which are None"""
+        return None
 
 
-class MetaNamespaceDict(defaultdict):
-    """A defaultdict that preprocesses AST keys to use the classname + memory address as the key"""
-    def __init__(self):
-        super().__init__(MetaNamespace)
+class MetaNamespaceDict(dict):
+    """
+    A side table of AST meta attributes, keyed by the identity of the AST (ASTs compare by value, so can't be keys themselves)
 
-    # add preprocessing to both __getitem__ and __setitem__ to handle AST keys
-    # apparently __setitem__ always calls __getitem__ so we only need to override __getitem__
-    def __getitem__(self, item: AST) -> Any | None:
-        key = f'::{item.__class__.__name__}@{hex(id(item))}'
-        return super().__getitem__(key)
+    Each entry holds on to its AST, so the AST's id can't be reused by a different AST while the entry exists
+    """
+    def __getitem__(self, item: AST) -> MetaNamespace:
+        entry = self.get(id(item))
+        if entry is None:
+            entry = (item, MetaNamespace())
+            self[id(item)] = entry
+        return entry[1]
+
+    def clear_call_args(self) -> None:
+        """Drop the args saved by calls made in this scope (along with any functions only kept alive by them)"""
+        for key, (item, namespace) in [*self.items()]:
+            if namespace.call_args is None:
+                continue
+            del namespace.call_args
+            if len(vars(namespace)) == 0:
+                del self[key]
 
 @dataclass
 class Scope(DTypesScope):
@@ -168,11 +280,15 @@ class Scope(DTypesScope):
 
 
 class Iter(AST):
+    """An iteration over item. The way to step through item is picked once, when the Iter is created"""
     item: AST
-    i: int
+    _next: 'IterNext' = field(init=False, compare=False)
+
+    def __post_init__(self):
+        self._next = get_iter_next(self.item)
 
     def __str__(self):
-        return f'Iter({self.item}, i={self.i})'
+        return f'Iter({self.item})'
 
 class BuiltinArgsPreprocessor(Protocol):
     def __call__(self, args: list[AST], kwargs: dict[str, AST], scope: Scope) -> tuple[list[Any], dict[str, Any]]: ...
@@ -200,6 +316,8 @@ register_typeof(Builtin, short_circuit(Builtin))
 class Closure(CallableBase):
     fn: FunctionLiteral
     scope: Scope
+    # set on closures made by compiled code (see compile_function_literal)
+    _compiled_body: 'Compiled | None' = field(default=None, init=False, compare=False)
 
     def __str__(self):
         return f'{self.fn} with <Scope@{hex(id(self.scope))}>'
@@ -251,6 +369,28 @@ class Float(MultipliableBase):
     def __str__(self):
         return f'{self.val}'
 
+
+class TypedArray(AST):
+    """
+    An array of all Ints or all Floats, stored contiguously as int64 ('q') or float64 ('d') values rather than as a list
+    of boxed values. Made by broadcast ops, which operate on the whole storage at once (see broadcast_packed)
+    """
+    data: array
+
+    def item(self, i: int) -> Int | Float:
+        return make_int(self.data[i]) if self.data.typecode == 'q' else Float(self.data[i])
+
+    def boxed(self) -> list[AST]:
+        """the elements as the values an Array would hold"""
+        if self.data.typecode == 'q':
+            return [*map(make_int, self.data)]
+        return [*map(Float, self.data)]
+
+    def __str__(self):
+        return f'[{" ".join(map(str, self.data))}]'
+
+register_typeof(TypedArray, short_circuit(Array))
+
 ############################ Evaluation functions ############################
 
 #DEBUG supporting py3.11
@@ -304,6 +444,7 @@ def get_eval_fn_map() -> dict[type[AST], EvalFunc]:
         Express: evaluate_express,
         Int: no_op,
         Float: no_op,
+        TypedArray: no_op,
         Bool: no_op,
         Range: no_op,
         Flow: evaluate_flow,
@@ -339,6 +480,7 @@ def get_eval_fn_map() -> dict[type[AST], EvalFunc]:
         LeftRotateCarry: evaluate_binary_dispatch,
         RightRotateCarry: evaluate_binary_dispatch,
         CycleLeft: evaluate_binary_dispatch,
+        BroadcastOp: evaluate_broadcast_op,
         AtHandle: evaluate_at_handle,
         Undefined: no_op,
         Void: no_op,
@@ -346,13 +488,25 @@ def get_eval_fn_map() -> dict[type[AST], EvalFunc]:
     }
 
 def evaluate(ast:AST, scope:Scope) -> AST:
-    eval_fn_map = get_eval_fn_map()
+    # each node remembers the function it was dispatched to (an inline cache), so it's only looked up the first time
+    eval_fn = getattr(ast, '_eval_fn', None)
+    if eval_fn is None:
+        eval_fn = get_eval_fn(ast)
+    return eval_fn(ast, scope)
 
+
+def get_eval_fn(ast: AST) -> EvalFunc:
+    """look up the evaluation function for an AST, and cache it on the node"""
     ast_type = type(ast)
-    if ast_type in eval_fn_map:
-        return eval_fn_map[ast_type](ast, scope)
+    eval_fn_map = get_eval_fn_map()
+    if ast_type not in eval_fn_map:
+        raise NotImplementedError(f'evaluation not implemented for {ast_type}')
 
-    raise NotImplementedError(f'evaluation not implemented for {ast_type}')
+    # values are usually fresh nodes evaluated once, so caching on them wouldn't pay for itself
+    eval_fn = eval_fn_map[ast_type]
+    if eval_fn is not no_op:
+        ast._eval_fn = eval_fn
+    return eval_fn
 
 
 def suspend(ast:AST, scope:Scope) -> Closure:
@@ -473,7 +627,7 @@ def collect_calling_args(args: AST | None, scope: Scope) -> tuple[list[AST], dic
             return call_args, call_kwargs
 
         #TODO: eventually it should just be anything that is left over is positional args rather than specifying them all out
-        case Int() | String() | IString() | Range() | Call() | Access() | Index() | Express() | QJux() | UnaryPrefixOp() | UnaryPostfixOp() | BinOp() | BroadcastOp():
+        case Int() | Bool() | String() | IString() | Range() | Call() | Access() | Index() | Express() | QJux() | UnaryPrefixOp() | UnaryPostfixOp() | BinOp() | BroadcastOp():
             return [args], {}
         # case Call(): return [args], {}
         case _:
@@ -518,15 +672,19 @@ def resolve_calling_args(signature: Signature, args: list[AST], kwargs: dict[str
 
     This is mainly for interfacing with python functions which want *args, **kwargs
     """
-    # for now, just assume all args are position or keyword args
-    # partial eval converts that particular arg to keyword only
-    sig_pkwargs, sig_pargs, sig_kwargs = signature.pkwargs, signature.pargs, signature.kwargs
-    dewy_args, dewy_kwargs = {}, {}
-
     # evaluate all the args and kwargs
     args = [evaluate(arg, caller_scope) for arg in args]
     kwargs = {name: evaluate(arg, caller_scope) for name, arg in kwargs.items()}
 
+    return bind_calling_args(signature, args, kwargs, closure_scope)
+
+
+def bind_calling_args(signature: Signature, args: list[AST], kwargs: dict[str, AST], closure_scope: Scope = Scope()) -> tuple[dict[str, AST], dict[str, AST]]:
+    """pair up already evaluated calling args with the signature, evaluating any defaults in closure_scope (see resolve_calling_args)"""
+    # for now, just assume all args are position or keyword args
+    # partial eval converts that particular arg to keyword only
+    sig_pkwargs, sig_pargs, sig_kwargs = signature.pkwargs, signature.pargs, signature.kwargs
+    dewy_args, dewy_kwargs = {}, {}
 
     # first pull out the calling keyword arguments
     dewy_kwargs.update(kwargs)
@@ -671,6 +829,8 @@ def evaluate_index(ast: Index, scope: Scope) -> AST:
     match left, right:
         case Array(items), Array(items=[Int(i)]):
             return items[i]
+        case TypedArray() as arr, Array(items=[Int(i)]):
+            return arr.item(i)
         case _:
             pdb.set_trace()
     pdb.set_trace()
@@ -715,9 +875,9 @@ def evaluate_iter_in(ast: IterIn, scope: Scope):
     # helper function for progressing the iterator
     def step_iter_in(iter_props: tuple[TypingCallable, Iter], scope: Scope) -> AST:
         binder, iterable = iter_props
-        cond, val = iter_next(iterable).items
+        cond, val = iterable._next()
         binder(val)
-        return cond
+        return make_bool(cond)
 
     # if the iterator properties are already in the scope, use them
     if (res := scope.meta[ast].props) is not None:
@@ -727,12 +887,12 @@ def evaluate_iter_in(ast: IterIn, scope: Scope):
     match ast:
         case IterIn(left=Identifier(name), right=right):
             right = evaluate(right, scope)
-            props = lambda x: scope.assign(name, x), Iter(item=right, i=0)
+            props = lambda x: scope.assign(name, x), Iter(item=right)
             scope.meta[ast].props = props
             return step_iter_in(props, scope)
         case IterIn(left=UnpackTarget() as target, right=right):
             right = evaluate(right, scope)
-            props = lambda x: unpack_assign(target, x, scope), Iter(item=right, i=0)
+            props = lambda x: unpack_assign(target, x, scope), Iter(item=right)
             scope.meta[ast].props = props
             return step_iter_in(props, scope)
 
@@ -747,6 +907,8 @@ def unpack_assign(target: UnpackTarget, value: AST, scope: Scope):
     # current inefficient hack to unpack strings
     if isinstance(value, String):
         value = Array([String(c) for c in value.val])
+    if isinstance(value, TypedArray):
+        value = Array(value.boxed())
 
     # current types supporting unpacking
     if not isinstance(value, (Array, Dict, PointsTo, BidirDict, BidirPointsTo, Undefined)):
@@ -788,59 +950,80 @@ def unpack_assign(target: UnpackTarget, value: AST, scope: Scope):
     if (remaining := [*gen]):
         raise RuntimeError(f'Too many values to unpack. {num_targets=}, {target=}, {value=}, {remaining=}')
 
-# TODO: probably break this up into one function per type of iterable
-def iter_next(iter: Iter):
-    match iter.item:
-        case Array(items):
-            if iter.i >= len(items):
-                cond, val = Bool(False), undefined
-            else:
-                cond, val = Bool(True), items[iter.i]
-            iter.i += 1
-            return Array([cond, val])
-        case Dict(items):
-            if iter.i >= len(items):
-                cond, val = Bool(False), undefined
-            else:
-                cond, val = Bool(True), items[iter.i]
-            iter.i += 1
-            return Array([cond, val])
-        case Range(left=Int(val=l), right=Void()|Undefined(), brackets=brackets):
-            offset = int(brackets[0] == '(') # handle if first value is exclusive
-            cond, val = Bool(True), Int(l + iter.i + offset)
-            iter.i += 1
-            return Array([cond, val])
-        case Range(left=Int(val=l), right=Int(val=r), brackets=brackets):
-            offset = int(brackets[0] == '(') # handle if first value is exclusive
-            end_offset = int(brackets[1] == ']')
-            i = l + iter.i + offset
-            if i > r + end_offset - 1:
-                cond, val = Bool(False), undefined
-            else:
-                cond, val = Bool(True), Int(i)
-            iter.i += 1
-            return Array([cond, val])
-        case Range(left=Array(items=[Int(val=r0), Int(val=r1)]), right=Void()|Undefined(), brackets=brackets):
-            offset = int(brackets[0] == '(') # handle if first value is exclusive
-            step = r1 - r0
-            cond, val = Bool(True), Int(r0 + (iter.i + offset) * step)
-            iter.i += 1
-            return Array([cond, val])
-        case Range(left=Array(items=[Int(val=r0), Int(val=r1)]), right=Int(val=r2), brackets=brackets):
-            offset = int(brackets[0] == '(') # handle if first value is exclusive
-            end_offset = int(brackets[1] == ']')
-            step = r1 - r0
-            i = r0 + (iter.i + offset) * step
-            if i > r2 + end_offset - 1:
-                cond, val = Bool(False), undefined
-            else:
-                cond, val = Bool(True), Int(i)
-            iter.i += 1
-            return Array([cond, val])
-        #TODO: other range cases...
-        case _:
-            pdb.set_trace()
-            raise NotImplementedError(f'iter_next not implemented yet for {iter.item=}')
+# steps an iteration, returning whether there was a next value, and the value (undefined once exhausted)
+IterNext = TypingCallable[[], tuple[bool, AST]]
+
+def get_iter_next(item: AST) -> IterNext:
+    match item:
+        case Array(items) | Dict(items):
+            return iter_items(items)
+        case TypedArray():
+            return iter_items(item.boxed())
+        case Range():
+            if (range_next := iter_range(item)) is not None:
+                return range_next
+    pdb.set_trace()
+    raise NotImplementedError(f'iteration not implemented yet for {item=}')
+
+def iter_items(items: list[AST]) -> IterNext:
+    it = iter(items)
+    def items_next() -> tuple[bool, AST]:
+        item = next(it, None)
+        if item is None:
+            return False, undefined
+        return True, item
+    return items_next
+
+def iter_range(ast: Range) -> IterNext | None:
+    """
+    Step through a range of numbers or characters, keeping the cursor as a python number, and only making the AST for
+    each value as it is stepped to. The range may have a step (`first,second..last`) which may be negative. None if
+    the range can't be iterated over (e.g. no start)
+    """
+    match ast.left:
+        case Array(items=[first, second]): pass
+        case first: second = None
+    last = None if isinstance(ast.right, (Void, Undefined)) else ast.right
+
+    # all the bounds must be the same kind of value
+    bounds = [b for b in (first, second, last) if b is not None]
+    if all(isinstance(b, (Int, Float)) for b in bounds):
+        box = Float if any(isinstance(b, Float) for b in bounds) else make_int
+        unbox = lambda b: b.val
+    elif all(isinstance(b, String) and len(b.val) == 1 for b in bounds):
+        box = lambda c: String(chr(c))
+        unbox = lambda b: ord(b.val)
+    else:
+        return None
+
+    start = unbox(first)
+    step = unbox(second) - start if second is not None else 1
+    k = int(ast.brackets[0] == '(')  # number of steps taken (skipping the first value if it is exclusive)
+
+    if last is None:
+        def unbounded_range_next() -> tuple[bool, AST]:
+            nonlocal k
+            val = start + k * step
+            k += 1
+            return True, box(val)
+        return unbounded_range_next
+
+    # the range ends at the first value past stop (stop is inclusive or exclusive according to the right bracket)
+    stop = unbox(last)
+    inclusive = ast.brackets[1] == ']'
+    descending = step < 0
+    def range_next() -> tuple[bool, AST]:
+        nonlocal k
+        val = start + k * step
+        k += 1
+        if descending:
+            done = val < stop or (val == stop and not inclusive)
+        else:
+            done = val > stop or (val == stop and not inclusive)
+        if done:
+            return False, undefined
+        return True, box(val)
+    return range_next
 
 
 
@@ -943,7 +1126,7 @@ def int_int_div(l: int, r: int) -> Int | Float | Undefined:
         return undefined
     res = l / r
     if res.is_integer():
-        return Int(int(res))
+        return make_int(int(res))
     else:
         return Float(res)
 
@@ -968,64 +1151,64 @@ class SimpleValue(Protocol, Generic[T]):
 
 UnaryDispatchKey =  tuple[type[UnaryPrefixOp]|type[UnaryPostfixOp], type[SimpleValue[T]]]
 unary_dispatch_table: dict[UnaryDispatchKey[T], TypingCallable[[T], AST]] = {
-    (Not, Int): lambda l: Int(~l),
-    (Not, Bool): lambda l: Bool(not l),
-    (UnaryPos, Int): lambda l: Int(l),
-    (UnaryNeg, Int): lambda l: Int(-l),
-    (UnaryMul, Int): lambda l: Int(l),
+    (Not, Int): lambda l: make_int(~l),
+    (Not, Bool): lambda l: make_bool(not l),
+    (UnaryPos, Int): lambda l: make_int(l),
+    (UnaryNeg, Int): lambda l: make_int(-l),
+    (UnaryMul, Int): lambda l: make_int(l),
     (UnaryDiv, Int): lambda l: Int(1/l),
 }
 
 BinaryDispatchKey = tuple[type[BinOp], type[SimpleValue[T]], type[SimpleValue[U]]]
 # These are all symmetric meaning you can swap the operand types and the same function will be used (but the arguments should not be swapped)
 binary_dispatch_table: dict[BinaryDispatchKey[T, U], TypingCallable[[T, U], AST]|TypingCallable[[U, T], AST]] = {
-    (And, Int, Int): lambda l, r: Int(l & r),
-    (And, Bool, Bool): lambda l, r: Bool(l and r),
-    (Or, Int, Int): lambda l, r: Int(l | r),
-    (Or, Bool, Bool): lambda l, r: Bool(l or r),
-    (Xor, Int, Int): lambda l, r: Int(l ^ r),
-    (Xor, Bool, Bool): lambda l, r: Bool(l != r),
-    (Nand, Int, Int): lambda l, r: Int(~(l & r)),
-    (Nand, Bool, Bool): lambda l, r: Bool(not (l and r)),
-    (Nor, Int, Int): lambda l, r: Int(~(l | r)),
-    (Nor, Bool, Bool): lambda l, r: Bool(not (l or r)),
-    (Add, Int, Int): lambda l, r: Int(l + r),
+    (And, Int, Int): lambda l, r: make_int(l & r),
+    (And, Bool, Bool): lambda l, r: make_bool(l and r),
+    (Or, Int, Int): lambda l, r: make_int(l | r),
+    (Or, Bool, Bool): lambda l, r: make_bool(l or r),
+    (Xor, Int, Int): lambda l, r: make_int(l ^ r),
+    (Xor, Bool, Bool): lambda l, r: make_bool(l != r),
+    (Nand, Int, Int): lambda l, r: make_int(~(l & r)),
+    (Nand, Bool, Bool): lambda l, r: make_bool(not (l and r)),
+    (Nor, Int, Int): lambda l, r: make_int(~(l | r)),
+    (Nor, Bool, Bool): lambda l, r: make_bool(not (l or r)),
+    (Add, Int, Int): lambda l, r: make_int(l + r),
     (Add, Int, Float): lambda l, r: Float(l + r),
     (Add, Float, Float): lambda l, r: Float(l + r),
-    (Sub, Int, Int): lambda l, r: Int(l - r),
+    (Sub, Int, Int): lambda l, r: make_int(l - r),
     (Sub, Int, Float): lambda l, r: Float(l - r),
     (Sub, Float, Float): lambda l, r: Float(l - r),
-    (Mul, Int, Int): lambda l, r: Int(l * r),
+    (Mul, Int, Int): lambda l, r: make_int(l * r),
     (Mul, Int, Float): lambda l, r: Float(l * r),
     (Mul, Float, Float): lambda l, r: Float(l * r),
     (Div, Int, Int): int_int_div,
     (Div, Int, Float): float_float_div,
     (Div, Float, Float): float_float_div,
-    (Mod, Int, Int): lambda l, r: Int(l % r),
+    (Mod, Int, Int): lambda l, r: make_int(l % r),
     (Mod, Int, Float): lambda l, r: Float(l % r),
     (Mod, Float, Float): lambda l, r: Float(l % r),
-    (Pow, Int, Int): lambda l, r: Int(l ** r),
+    (Pow, Int, Int): lambda l, r: make_int(l ** r),
     (Pow, Int, Float): lambda l, r: Float(l ** r),
     (Pow, Float, Float): lambda l, r: Float(l ** r),
-    (Less, Int, Int): lambda l, r: Bool(l < r),
-    (Less, Int, Float): lambda l, r: Bool(l < r),
-    (Less, Float, Float): lambda l, r: Bool(l < r),
-    (LessEqual, Int, Int): lambda l, r: Bool(l <= r),
-    (LessEqual, Int, Float): lambda l, r: Bool(l <= r),
-    (LessEqual, Float, Float): lambda l, r: Bool(l <= r),
-    (Greater, Int, Int): lambda l, r: Bool(l > r),
-    (Greater, Int, Float): lambda l, r: Bool(l > r),
-    (Greater, Float, Float): lambda l, r: Bool(l > r),
-    (GreaterEqual, Int, Int): lambda l, r: Bool(l >= r),
-    (GreaterEqual, Int, Float): lambda l, r: Bool(l >= r),
-    (GreaterEqual, Float, Float): lambda l, r: Bool(l >= r),
-    (Equal, Int, Int): lambda l, r: Bool(l == r),
-    (Equal, Float, Float): lambda l, r: Bool(l == r),
-    (Equal, Bool, Bool): lambda l, r: Bool(l == r),
-    (Equal, String, String): lambda l, r: Bool(l == r),
-    # (NotEqual, Int, Int): lambda l, r: Bool(l != r),
-    (LeftShift, Int, Int): lambda l, r: Int(l << r),
-    (RightShift, Int, Int): lambda l, r: Int(l >> r),
+    (Less, Int, Int): lambda l, r: make_bool(l < r),
+    (Less, Int, Float): lambda l, r: make_bool(l < r),
+    (Less, Float, Float): lambda l, r: make_bool(l < r),
+    (LessEqual, Int, Int): lambda l, r: make_bool(l <= r),
+    (LessEqual, Int, Float): lambda l, r: make_bool(l <= r),
+    (LessEqual, Float, Float): lambda l, r: make_bool(l <= r),
+    (Greater, Int, Int): lambda l, r: make_bool(l > r),
+    (Greater, Int, Float): lambda l, r: make_bool(l > r),
+    (Greater, Float, Float): lambda l, r: make_bool(l > r),
+    (GreaterEqual, Int, Int): lambda l, r: make_bool(l >= r),
+    (GreaterEqual, Int, Float): lambda l, r: make_bool(l >= r),
+    (GreaterEqual, Float, Float): lambda l, r: make_bool(l >= r),
+    (Equal, Int, Int): lambda l, r: make_bool(l == r),
+    (Equal, Float, Float): lambda l, r: make_bool(l == r),
+    (Equal, Bool, Bool): lambda l, r: make_bool(l == r),
+    (Equal, String, String): lambda l, r: make_bool(l == r),
+    # (NotEqual, Int, Int): lambda l, r: make_bool(l != r),
+    (LeftShift, Int, Int): lambda l, r: make_int(l << r),
+    (RightShift, Int, Int): lambda l, r: make_int(l >> r),
 
 }
 
@@ -1038,6 +1221,9 @@ unsymmetric_binary_dispatch_table: dict[BinaryDispatchKey[T, U], ] = {
 CustomBinaryDispatchKey = tuple[type[BinOp], type[T], type[U]]
 custom_binary_dispatch_table: dict[CustomBinaryDispatchKey[T, U], TypingCallable[[T, U], AST]] = {
     (Add, Array, Array): lambda l, r: Array(l.items + r.items), #TODO: this will be removed in favor of spread. array add will probably be vector add
+    (Add, Array, TypedArray): lambda l, r: Array(l.items + r.boxed()),
+    (Add, TypedArray, Array): lambda l, r: Array(l.boxed() + r.items),
+    (Add, TypedArray, TypedArray): lambda l, r: Array(l.boxed() + r.boxed()),
     # (BroadcastOp, Array, Array): broadcast_array_op,
     # (BroadcastOp, NpArray, NpArray): broadcast_array_op,
     # (BroadcastOp, Int, Array): broadcast_array_op,
@@ -1051,32 +1237,57 @@ def evaluate_binary_dispatch(op: BinOp, scope: Scope):
     # evaluate the operands
     left = evaluate(op.left, scope)
     right = evaluate(op.right, scope)
-    
+    return dispatch_binary(op, left, right)
+
+
+def dispatch_binary(op: BinOp, left: AST, right: AST) -> AST:
+    # each op remembers the operand types it last saw and the function they dispatched to, and only redoes the dispatch when they change
+    cached = getattr(op, '_dispatch', None)
+    if cached is not None and cached[0] is type(left) and cached[1] is type(right):
+        _, _, fn, unwrap = cached
+        return fn(left.val, right.val) if unwrap else fn(left, right)
+
     # if either operand is undefined, the result is undefined
     if isinstance(left, Undefined) or isinstance(right, Undefined):
         return undefined
-    
-    # dispatch to the appropriate function
+
+    fn, unwrap = resolve_binary_dispatch(op, left, right)
+    op._dispatch = type(left), type(right), fn, unwrap
+    return fn(left.val, right.val) if unwrap else fn(left, right)
+
+
+def resolve_binary_dispatch(op: BinOp, left: AST, right: AST) -> tuple[TypingCallable[[Any, Any], AST], bool]:
+    """
+    find the function for a binary op over the given operands.
+    Returns the function, and whether it takes the operands' .val (the simple tables) or the operands themselves (the custom tables)
+    """
     key = (type(op), type(left), type(right))
     if key in binary_dispatch_table:
-        left, right = cast(SimpleValue[T], left), cast(SimpleValue[U], right)
-        return binary_dispatch_table[key](left.val, right.val)
+        return binary_dispatch_table[key], True
     if key in custom_binary_dispatch_table:
-        return custom_binary_dispatch_table[key](left, right)
+        return custom_binary_dispatch_table[key], False
 
     # if the key wasn't found, try the reverse key (by swapping the types of the operands)
     reverse_key = (type(op), type(right), type(left))
     if reverse_key in binary_dispatch_table:
-        left, right = cast(SimpleValue[U], left), cast(SimpleValue[T], right)
-        return binary_dispatch_table[reverse_key](left.val, right.val)
+        return binary_dispatch_table[reverse_key], True
     if reverse_key in custom_binary_dispatch_table:
-        return custom_binary_dispatch_table[reverse_key](right, left)
+        fn = custom_binary_dispatch_table[reverse_key]
+        return (lambda l, r: fn(r, l)), False
 
     raise NotImplementedError(f'Binary dispatch not implemented for {key=}')
 
 def evaluate_unary_dispatch(op: UnaryPrefixOp|UnaryPostfixOp, scope: Scope):
     # evaluate the operand
     operand = evaluate(op.operand, scope)
+    return dispatch_unary(op, operand)
+
+
+def dispatch_unary(op: UnaryPrefixOp|UnaryPostfixOp, operand: AST) -> AST:
+    # inline cache of the last operand type and its function, as for binary ops
+    cached = getattr(op, '_dispatch', None)
+    if cached is not None and cached[0] is type(operand):
+        return cached[1](operand.val)
 
     # if the operand is undefined, the result is undefined
     if isinstance(operand, Undefined):
@@ -1086,11 +1297,142 @@ def evaluate_unary_dispatch(op: UnaryPrefixOp|UnaryPostfixOp, scope: Scope):
     key = (type(op), type(operand))
     if key in unary_dispatch_table:
         operand = cast(SimpleValue[T], operand)
+        op._dispatch = type(operand), unary_dispatch_table[key]
         return unary_dispatch_table[key](operand.val)
     
     raise NotImplementedError(f'Unary dispatch not implemented for {key=}')
 
 
+def evaluate_broadcast_op(ast: BroadcastOp, scope: Scope):
+    left = evaluate(ast.op.left, scope)
+    right = evaluate(ast.op.right, scope)
+    return broadcast_binary(ast.op, left, right)
+
+
+def broadcast_binary(op: BinOp, left: AST, right: AST) -> AST:
+    """
+    apply op between each pair of elements of left and right, either of which may be a scalar, or a (nested) array.
+    As in numpy, a lower rank side is repeated against each element of the higher rank side, and arrays of length 1
+    are repeated against each element of the other side
+    """
+    left_rank, right_rank = array_rank(left), array_rank(right)
+    if left_rank == right_rank == 0:
+        return dispatch_binary(op, left, right)
+
+    if left_rank <= 1 and right_rank <= 1 and (result := broadcast_packed(op, left, right)) is not None:
+        return result
+
+    # mixed and nested arrays are broadcast an element at a time
+    if left_rank < right_rank:
+        return Array([broadcast_binary(op, left, r) for r in array_elements(right)])
+    if left_rank > right_rank:
+        return Array([broadcast_binary(op, l, right) for l in array_elements(left)])
+    lefts, rights = array_elements(left), array_elements(right)
+    if len(lefts) == len(rights):
+        return Array([broadcast_binary(op, l, r) for l, r in zip(lefts, rights)])
+    if len(lefts) == 1:
+        return Array([broadcast_binary(op, lefts[0], r) for r in rights])
+    if len(rights) == 1:
+        return Array([broadcast_binary(op, l, rights[0]) for l in lefts])
+    raise ValueError(f'Cannot broadcast arrays of lengths {len(lefts)} and {len(rights)} for {op}')
+
+
+def array_rank(ast: AST) -> int:
+    """number of nested array levels in ast (0 for scalars), going by the first element of each level"""
+    rank = 0
+    while True:
+        match ast:
+            case TypedArray():
+                return rank + 1
+            case Array(items=[first, *_]):
+                ast = first
+            case Array():
+                return rank + 1
+            case _:
+                return rank
+        rank += 1
+
+def array_elements(ast: AST) -> list[AST]:
+    return ast.boxed() if isinstance(ast, TypedArray) else ast.items
+
+
+# bulk versions of the binary_dispatch_table functions, over the raw values of packed arrays (and scalars). Keyed by
+# (op, left typecode, right typecode), for the typecodes 'q' (Int) and 'd' (Float). Each gives the typecode of the
+# result (None for Bools, which are returned as an Array), and the function over raw values
+PackedKernel = tuple[str | None, TypingCallable[[Any, Any], Any]]
+mixed_typecodes = (('q', 'd'), ('d', 'q'), ('d', 'd'))
+packed_kernels: dict[tuple[type[BinOp], str, str], PackedKernel] = {
+    **{(op, 'q', 'q'): ('q', fn) for op, fn in [
+        (Add, operator.add), (Sub, operator.sub), (Mul, operator.mul), (Mod, operator.mod), (Pow, operator.pow),
+        (And, operator.and_), (Or, operator.or_), (Xor, operator.xor), (Nand, lambda l, r: ~(l & r)), (Nor, lambda l, r: ~(l | r)),
+        (LeftShift, operator.lshift), (RightShift, operator.rshift),
+    ]},
+    **{(op, l, r): ('d', fn) for l, r in mixed_typecodes for op, fn in [
+        (Add, operator.add), (Sub, operator.sub), (Mul, operator.mul), (Div, operator.truediv), (Mod, operator.mod), (Pow, operator.pow),
+    ]},
+    **{(op, l, r): (None, fn) for l, r in (('q', 'q'), *mixed_typecodes) for op, fn in [
+        (Less, operator.lt), (LessEqual, operator.le), (Greater, operator.gt), (GreaterEqual, operator.ge),
+    ]},
+    (Equal, 'q', 'q'): (None, operator.eq),
+    (Equal, 'd', 'd'): (None, operator.eq),
+}
+
+def broadcast_packed(op: BinOp, left: AST, right: AST) -> AST | None:
+    """
+    broadcast op over a flat array of Ints or Floats (and a scalar, or another such array) in bulk. None if the operands
+    can't be packed, or the op has no kernel for them. Also None if the kernel fails, or would give values that don't
+    fit the result's typecode (e.g. Int overflow, division by zero), in which case broadcasting elementwise gives the
+    same result (or error) as the op would give on each element
+    """
+    if (l := packed_operand(left)) is None or (r := packed_operand(right)) is None:
+        return None
+    (left_code, left_values), (right_code, right_values) = l, r
+    if (kernel := packed_kernels.get((type(op), left_code, right_code))) is None:
+        return None
+    code, fn = kernel
+
+    # length 1 arrays are repeated like scalars
+    if isinstance(left_values, array) and isinstance(right_values, array) and len(left_values) != len(right_values):
+        if len(left_values) == 1:
+            left_values = left_values[0]
+        elif len(right_values) == 1:
+            right_values = right_values[0]
+        else:
+            return None
+    if not isinstance(left_values, array):
+        left_values = repeat(left_values, len(right_values))
+    elif not isinstance(right_values, array):
+        right_values = repeat(right_values, len(left_values))
+
+    try:
+        values = map(fn, left_values, right_values)
+        if code is None:
+            return Array([*map(make_bool, values)])
+        return TypedArray(array(code, values))
+    except (ArithmeticError, TypeError, ValueError):
+        return None
+
+def packed_operand(ast: AST) -> tuple[str, array | int | float] | None:
+    """the typecode and raw value(s) of a scalar or flat array for broadcast_packed, or None if it has other values"""
+    match ast:
+        case TypedArray(data):
+            return data.typecode, data
+        case Int(val):
+            return 'q', val
+        case Float(val):
+            return 'd', val
+        case Array(items=[first, *_] as items):
+            cls = type(first)
+            if cls is not Int and cls is not Float or any(type(i) is not cls for i in items):
+                return None
+            code = 'q' if cls is Int else 'd'
+            try:
+                return code, array(code, [i.val for i in items])
+            except OverflowError:
+                return None
+    return None
+
+
 def evaluate_at_handle(ast: AtHandle, scope: Scope):
     match ast.operand:
         case Identifier(name):
@@ -1099,14 +1441,364 @@ def evaluate_at_handle(ast: AtHandle, scope: Scope):
             pdb.set_trace()
             raise NotImplementedError(f'AtHandle not implemented for {ast.operand=}')
 
+############################ Closure compilation ############################
+# An alternative to walking the AST with evaluate() on every execution: each top level expression is compiled once into
+# a tree of python closures (Compiled), each taking the runtime scope. Children are compiled up front, so evaluating
+# a loop body is just nested function calls. Any AST without a specialized compile function falls back to evaluate(),
+# so the two modes always agree.
+#
+# Identifier reads skip the scopes that can't hold the name. Each scope a compiled closure creates (blocks, flows,
+# function calls) is a level in the environment (Env), holding the names that could be bound in it. A read starts
+# its lookup at the innermost level that could hold the name, or at the scope the expression was compiled for.
+#
+# Levels with a known set of names are array-backed frames: each name gets a fixed slot (its Layout), which the
+# frame's Scope keeps filled alongside the usual vars dict. Reads and writes of a name bound in its frame are then
+# an index into the slots, and only fall back to the dict lookups up the parent chain when the slot is empty (i.e.
+# the name is bound in an outer scope). Function scopes (AnyName) and the top level scope (e.g. in the REPL) stay
+# dict only.
+
+Compiled = TypingCallable[[Scope], AST]
+
+class AnyName:
+    """stand-in for the names of a scope that anything could be bound in (e.g. a function's scope, which takes the caller's keyword args)"""
+    def __contains__(self, name: str) -> bool:
+        return True
+
+Layout = dict[str, int]
+Env = tuple[Layout | AnyName, ...]
+
+
+def compile_closures(ast: AST) -> Compiled:
+    """compile an AST into a function evaluating it in a given scope, equivalent to `lambda scope: evaluate(ast, scope)`"""
+    return compile_closure(ast, ())
+
+
+class CompileClosureFunc(Protocol):
+    def __call__(self, ast: T, env: Env) -> Compiled: ...
+
+@cache
+def get_compile_closure_fn_map() -> dict[type[AST], CompileClosureFunc]:
+    return {
+        **{t: compile_value for t, fn in get_eval_fn_map().items() if fn is no_op},
+        Express: compile_express,
+        Assign: compile_assign,
+        Group: compile_group,
+        Block: compile_block,
+        Flow: compile_flow,
+        If: compile_single_branch,
+        Loop: compile_single_branch,
+        Default: compile_single_branch,
+        Call: compile_call,
+        FunctionLiteral: compile_function_literal,
+        IString: compile_istring,
+        **{t: compile_binary_dispatch for t, fn in get_eval_fn_map().items() if fn is evaluate_binary_dispatch},
+        **{t: compile_unary_dispatch for t, fn in get_eval_fn_map().items() if fn is evaluate_unary_dispatch},
+        BroadcastOp: compile_broadcast_op,
+    }
+
+def compile_closure(ast: AST, env: Env) -> Compiled:
+    compile_fn = get_compile_closure_fn_map().get(type(ast))
+    if compile_fn is None:
+        return compile_fallback(ast, env)
+    return compile_fn(ast, env)
+
+def compile_fallback(ast: AST, env: Env) -> Compiled:
+    return lambda scope: evaluate(ast, scope)
+
+
+def scope_bindings(ast: AST) -> set[str]:
+    """names that evaluating ast could bind in the scope it is evaluated in (over-approximated)"""
+    match ast:
+        # these evaluate everything in a new scope (or not at all)
+        case Block() | Flow() | If() | Loop() | Default() | FunctionLiteral() | ObjectLiteral():
+            return set()
+        case Assign(left=target, right=right) | IterIn(left=target, right=right):
+            return identifier_names(target) | scope_bindings(right)
+        case Declare(target=target):
+            return identifier_names(target)
+        case _:
+            return set().union(*map(scope_bindings, ast.__iter_asts__()))
+
+def identifier_names(ast: AST) -> set[str]:
+    match ast:
+        case Identifier(name): return {name}
+        case UnpackTarget(target): return set().union(*map(identifier_names, target)) # not traversed by __iter_asts__
+        case _: return set().union(*map(identifier_names, ast.__iter_asts__()))
+
+def make_layout(names: set[str]) -> Layout:
+    return {name: slot for slot, name in enumerate(sorted(names))}
+
+def new_frame(scope: Scope, layout: Layout) -> Scope:
+    return Scope(scope, layout=layout, slots=[None] * len(layout))
+
+def scope_depth(name: str, env: Env) -> int:
+    """number of scopes to skip before looking up name"""
+    for depth, names in enumerate(env):
+        if name in names:
+            return depth
+    return len(env)
+
+def lookup(scope: Scope, name: str, depth: int) -> Scope._var:
+    """scope.get(name), skipping the first `depth` scopes, which can't hold name"""
+    for _ in range(depth):
+        scope = scope.parent
+    return scope.get(name)
+
+def compile_lookup(name: str, env: Env) -> TypingCallable[[Scope], Scope._var]:
+    """function getting the variable for name from a runtime scope matching env"""
+    depth = scope_depth(name, env)
+    if depth == len(env) or isinstance(layout := env[depth], AnyName):
+        return lambda scope: lookup(scope, name, depth)
+
+    slot = layout[name]
+    def lookup_slot(scope: Scope) -> Scope._var:
+        for _ in range(depth):
+            scope = scope.parent
+        var = scope.slots[slot]
+        if var is None:
+            # not bound in this frame, so it can only be in a parent scope
+            return scope.parent.get(name)
+        return var
+    return lookup_slot
+
+
+def compile_value(ast: AST, env: Env) -> Compiled:
+    return lambda scope: ast
+
+def compile_express(ast: Express, env: Env) -> Compiled:
+    get_var = compile_lookup(ast.id.name, env)
+    values = {t for t, fn in get_eval_fn_map().items() if fn is no_op}
+
+    def express(scope: Scope) -> AST:
+        val = get_var(scope).value
+        if type(val) in values:
+            return val
+        return evaluate(val, scope)
+    return express
+
+def compile_assign(ast: Assign, env: Env) -> Compiled:
+    if not isinstance(ast.left, Identifier):
+        return compile_fallback(ast, env)
+    name = ast.left.name
+    right = compile_closure(ast.right, env)
+
+    if len(env) == 0 or isinstance(layout := env[0], AnyName):
+        def assign(scope: Scope) -> AST:
+            scope.assign(name, right(scope))
+            return void
+        return assign
+
+    slot = layout[name]
+    def assign_slot(scope: Scope) -> AST:
+        value = right(scope)
+        var = scope.slots[slot]
+        if var is None or var.decltype == DeclarationType.CONST:
+            scope.assign(name, value)
+        else:
+            var.value = value
+        return void
+    return assign_slot
+
+def compile_group(ast: Group, env: Env) -> Compiled:
+    items = [compile_closure(item, env) for item in ast.items]
+
+    def group(scope: Scope) -> AST:
+        expressed: list[AST] = []
+        for item in items:
+            res = item(scope)
+            if res is not void:
+                expressed.append(res)
+        if len(expressed) == 0:
+            return void
+        if len(expressed) == 1:
+            return expressed[0]
+        raise NotImplementedError(f'Block with multiple expressions not yet supported. {ast=}, {expressed=}')
+    return group
+
+def compile_block(ast: Block, env: Env) -> Compiled:
+    inner = Group(ast.items)
+    layout = make_layout(scope_bindings(inner))
+    group = compile_group(inner, (layout, *env))
+    return lambda scope: group(new_frame(scope, layout))
+
+
+BranchCompiled = TypingCallable[[Scope], tuple[bool, AST]]
+
+def compile_branch(ast: Flowable, env: Env) -> BranchCompiled | None:
+    """compile a flow branch into a function returning whether the branch was entered, and its result"""
+    match ast:
+        case Default(body=body):
+            layout = make_layout(scope_bindings(body))
+            body = compile_closure(body, (layout, *env))
+            return lambda scope: (True, body(new_frame(scope, layout)))
+
+        case If(condition=condition, body=body):
+            layout = make_layout(scope_bindings(condition) | scope_bindings(body))
+            condition, body = compile_closure(condition, (layout, *env)), compile_closure(body, (layout, *env))
+            def if_branch(scope: Scope) -> tuple[bool, AST]:
+                scope = new_frame(scope, layout)
+                if cast(Bool, condition(scope)).val:
+                    return True, body(scope)
+                return False, void
+            return if_branch
+
+        case Loop(condition=condition, body=body):
+            layout = make_layout(scope_bindings(condition) | scope_bindings(body))
+            condition, body = compile_closure(condition, (layout, *env)), compile_closure(body, (layout, *env))
+            def loop_branch(scope: Scope) -> tuple[bool, AST]:
+                scope = new_frame(scope, layout)
+                entered = False
+                while cast(Bool, condition(scope)).val:
+                    entered = True
+                    body(scope)
+                # for now loops can't return anything
+                return entered, void
+            return loop_branch
+
+    return None
+
+def compile_single_branch(ast: Flowable, env: Env) -> Compiled:
+    branch = compile_branch(ast, env)
+    return lambda scope: branch(scope)[1]
+
+def compile_flow(ast: Flow, env: Env) -> Compiled:
+    branches = [compile_branch(branch, env) for branch in ast.branches]
+    if any(branch is None for branch in branches):
+        return compile_fallback(ast, env)
+
+    def flow(scope: Scope) -> AST:
+        for branch in branches:
+            entered, res = branch(scope)
+            if entered:
+                return res
+        return void
+    return flow
+
+
+# collects the calling args (as collect_calling_args) from the call's scope, and evaluates them in the caller scope
+CompiledArg = tuple[TypingCallable[[Scope], AST], TypingCallable[[AST, Scope], AST]]
+
+def compile_calling_args(args: AST | None, env: Env, caller_env: Env) -> tuple[list[CompiledArg], list[tuple[str, CompiledArg]]] | None:
+    """compile the args of a call into the positional and keyword arg collectors/evaluators. None if unsupported"""
+    match args:
+        case None | Void(): return [], []
+        case Identifier(name):
+            get_var = compile_lookup(name, env)
+            return [(lambda scope: get_var(scope).value, evaluate)], []
+        case Assign(left=Identifier(name)|TypedIdentifier(id=Identifier(name)), right=right):
+            right_fn = compile_closure(right, caller_env)
+            return [], [(name, (lambda scope: right, lambda _, caller_scope: right_fn(caller_scope)))]
+        case Assign(): return None
+        case Group(items):
+            pos, kw = [], []
+            for item in items:
+                compiled = compile_calling_args(item, env, caller_env)
+                if compiled is None:
+                    return None
+                pos.extend(compiled[0])
+                kw.extend(compiled[1])
+            return pos, kw
+        case Int() | Bool() | String() | IString() | Range() | Call() | Access() | Index() | Express() | QJux() | UnaryPrefixOp() | UnaryPostfixOp() | BinOp() | BroadcastOp():
+            arg_fn = compile_closure(args, caller_env)
+            return [(lambda scope: args, lambda _, caller_scope: arg_fn(caller_scope))], []
+    return None
+
+def compile_call(ast: Call, env: Env) -> Compiled:
+    match ast.f:
+        case Group() as f:
+            get_f = compile_closure(f, env)
+        case Identifier(name):
+            get_var = compile_lookup(name, env)
+            get_f = lambda scope: get_var(scope).value
+        case f:
+            get_f = lambda scope: f
+
+    # the args are evaluated in a new scope under the calling scope
+    caller_layout = make_layout(scope_bindings(ast.args) if ast.args is not None else set())
+    caller_env = (caller_layout, *env)
+    compiled_args = compile_calling_args(ast.args, env, caller_env)
+    if compiled_args is None:
+        return compile_fallback(ast, env)
+    pos, kw = compiled_args
+
+    def call(scope: Scope) -> AST:
+        f = get_f(scope)
+
+        # if this is a handle, do a partial evaluation rather than a call
+        if isinstance(f, AtHandle):
+            return apply_partial_eval(f.operand, ast.args, scope)
+
+        # AST being called must be TypingCallable
+        assert isinstance(f, (Builtin, Closure)), f'expected Function or Builtin, got {f}'
+
+        # collect the calling args, and save them as metadata for the function AST (as evaluate_call does)
+        call_args = [collect(scope) for collect, _ in pos]
+        call_kwargs = {name: collect(scope) for name, (collect, _) in kw}
+        scope.meta[f].call_args = call_args, call_kwargs
+
+        if isinstance(f, Builtin):
+            caller_scope = new_frame(scope, caller_layout)
+            args = [ev(arg, caller_scope) for arg, (_, ev) in zip(call_args, pos)]
+            kwargs = {name: ev(call_kwargs[name], caller_scope) for name, (_, ev) in dict(kw).items()}
+            dewy_args, dewy_kwargs = bind_calling_args(f.signature, args, kwargs)
+            py_args, py_kwargs = f.preprocessor([*dewy_args.values()], dewy_kwargs, caller_scope)
+            return f.action(*py_args, **py_kwargs)
+
+        closure_scope = Scope(f.scope)
+        caller_scope = new_frame(scope, caller_layout)
+        args = [ev(arg, caller_scope) for arg, (_, ev) in zip(call_args, pos)]
+        kwargs = {name: ev(call_kwargs[name], caller_scope) for name, (_, ev) in dict(kw).items()}
+        dewy_args, dewy_kwargs = bind_calling_args(f.fn.args, args, kwargs, closure_scope)
+        for name, value in (dewy_args | dewy_kwargs).items():
+            closure_scope.assign(name, value)
+
+        # closures made by compiled code carry their compiled body
+        body = f._compiled_body
+        if body is None:
+            return evaluate(f.fn.body, closure_scope)
+        return body(closure_scope)
+    return call
+
+def compile_function_literal(ast: FunctionLiteral, env: Env) -> Compiled:
+    # the body runs in a new scope under the scope the function was defined in
+    body = compile_closure(ast.body, (AnyName(), *env))
+
+    def function_literal(scope: Scope) -> AST:
+        closure = Closure(fn=ast, scope=scope)
+        closure._compiled_body = body
+        return closure
+    return function_literal
+
+def compile_istring(ast: IString, env: Env) -> Compiled:
+    parts = [compile_closure(part, env) for part in ast.parts]
+    def istring(scope: Scope) -> String:
+        return String(''.join(py_stringify_value(part(scope), scope) for part in parts))
+    return istring
+
+def compile_binary_dispatch(ast: BinOp, env: Env) -> Compiled:
+    left, right = compile_closure(ast.left, env), compile_closure(ast.right, env)
+    return lambda scope: dispatch_binary(ast, left(scope), right(scope))
+
+def compile_unary_dispatch(ast: UnaryPrefixOp|UnaryPostfixOp, env: Env) -> Compiled:
+    operand = compile_closure(ast.operand, env)
+    return lambda scope: dispatch_unary(ast, operand(scope))
+
+def compile_broadcast_op(ast: BroadcastOp, env: Env) -> Compiled:
+    left, right = compile_closure(ast.op.left, env), compile_closure(ast.op.right, env)
+    return lambda scope: broadcast_binary(ast.op, left(scope), right(scope))
+
+
 ############################ Builtin functions and helpers ############################
 
 # all references to python functions go through this interface to allow for easy swapping
 from functools import partial
+from time import perf_counter_ns
 class BuiltinFuncs:
     printl=print
     print=partial(print, end='')
     readl=input
+    time=perf_counter_ns
+    cycles=perf_counter_ns # python has no access to the cpu's cycle counter
 
 #TODO: consider adding a flag repr vs str, where initially str is used, but children get repr. 
 # as is, stringifying should put quotes around strings that are children of other objects 
@@ -1114,10 +1806,15 @@ class BuiltinFuncs:
 def py_stringify(ast: AST, scope: Scope, top_level:bool=False) -> str:    
     # don't evaluate. already evaluated by resolve_calling_args
     ast = evaluate(ast, scope) if not isinstance(ast, (Builtin, Closure)) else ast
+    return py_stringify_value(ast, scope)
+
+def py_stringify_value(ast: AST, scope: Scope) -> str:
+    """stringify an AST that has already been evaluated (its children are still evaluated by py_stringify)"""
     match ast:
         # types that require special handling (i.e. because they have children that need to be stringified)
         case String(val): return val# if top_level else f'"{val}"'
         case Array(items): return f"[{' '.join(py_stringify(i, scope) for i in items)}]"
+        case TypedArray(): return str(ast)
         case Dict(items): return f"[{' '.join(py_stringify(kv, scope) for kv in items)}]"
         case PointsTo(left, right): return f'{py_stringify(left, scope)}->{py_stringify(right, scope)}'
         case BidirDict(items): return f"[{' '.join(py_stringify(kv, scope) for kv in items)}]"
@@ -1163,6 +1860,15 @@ def py_print(s:str) -> Void:
 def py_readl() -> String:
     return String(BuiltinFuncs.readl())
 
+def py_time() -> Int:
+    return Int(BuiltinFuncs.time())
+
+def py_cycles() -> Int:
+    return Int(BuiltinFuncs.cycles())
+
+def preprocess_no_args(args: list[AST], kwargs: dict[str, AST], scope: Scope) -> tuple[list[Any], dict[str, Any]]:
+    return [], {}
+
 def insert_builtins(scope: Scope):
     """replace prototype builtin stubs with actual implementations"""
     if 'printl' in scope.vars:
@@ -1173,4 +1879,10 @@ def insert_builtins(scope: Scope):
         scope.vars['print'].value = Builtin.from_prototype(proto, preprocess_py_print_args, py_print)
     if 'readl' in scope.vars:
         assert isinstance((proto:=scope.vars['readl'].value), PrototypeBuiltin)
-        scope.vars['readl'].value = Builtin.from_prototype(proto, lambda *a: ([],{}), py_readl)
+        scope.vars['readl'].value = Builtin.from_prototype(proto, preprocess_no_args, py_readl)
+    if 'time' in scope.vars:
+        assert isinstance((proto:=scope.vars['time'].value), PrototypeBuiltin)
+        scope.vars['time'].value = Builtin.from_prototype(proto, preprocess_no_args, py_time)
+    if 'cycles' in scope.vars:
+        assert isinstance((proto:=scope.vars['cycles'].value), PrototypeBuiltin)
+        scope.vars['cycles'].value = Builtin.from_prototype(proto, preprocess_no_args, py_cycles)
@@ -3,7 +3,7 @@ from ...postok import post_process
 from ...dtypes import (
     Scope as DTypesScope,
     typecheck_call, typecheck_index, typecheck_multiply,
-    register_typeof, short_circuit,
+    register_typeof, short_circuit, typeof,
     CallableBase, IndexableBase, IndexerBase, MultipliableBase, ObjectBase,
 )
 from ...parser import top_level_parse, QJux
@@ -31,10 +31,13 @@ from ...syntax import (
     CycleLeft, CycleRight, Suppress,
     BroadcastOp,
     CollectInto, SpreadOutFrom,
+    DeclarationType,
 )
 
-from ...postparse import post_parse, FunctionLiteral, Signature, normalize_function_args
+from ...postparse import post_parse, fold_constants, FunctionLiteral, Signature, normalize_function_args
 from ...utils import Options
+from ...profiler import Profiler
+from .. import cache as build_cache
 
 from dataclasses import dataclass, field
 from pathlib import Path
@@ -43,60 +46,174 @@ from functools import cache
 from collections import defaultdict
 from types import SimpleNamespace
 from itertools import count
+from tempfile import TemporaryDirectory
+from contextlib import nullcontext
+import os
+import shutil
+import subprocess
 
 
 import pdb
 
 
-from functools import cache
-from pathlib import Path
-from ...utils import Options
+# TODO: not quite sure what to do about scope. for now, just steal from
+from ..python import Scope, Closure, get_arg_name
 
 
-# TODO: not quite sure what to do about scope. for now, just steal from
-from ..python import Scope, Closure
+# Generated code works on the dynamically typed values in ../runtime/value.h: every dewy value is an
+# `l` word, ints/bools/undefined/void are tagged immediates, and everything else is a pointer into the
+# runtime's arena. Operators, printing, iteration and closure calls are calls into the runtime (__val_*)
+#
+# build steps (done by qbe_compiler, and cached by source hash unless --no-cache is given):
+# qbe -o <file>.s <file>.ssa && cc <file>.s shim.c -pthread -o <file> && ./<file>
+
+shim_path = Path(__file__).parent / 'shim.c'
 
-# command to compile a .qbe file to an executable
-# qbe <file>.ssa | gcc -x assembler -static -o hello 
 
 def qbe_compiler(path: Path, args: list[str], options: Options) -> None:
-    # get the source code and tokenize
-    src = path.read_text()
-    tokens = tokenize(src)
-    post_process(tokens)
+    if options.profile is not None:
+        # always build, so that every stage is timed
+        profiler = Profiler(str(path))
+        try:
+            with TemporaryDirectory(prefix='dewy_') as build_dir:
+                exe_path = build(path.read_text(), Path(build_dir), shim_path, options, profiler)
+                with profiler.stage('run'):
+                    result = subprocess.run([str(exe_path), *args])
+        finally:
+            profiler.finish(options.profile)
+    elif options.cache:
+        # reuse the executable from a previous build of the same source, if there is one
+        exe_path = cached_build(path.read_bytes(), options)
+        result = subprocess.run([str(exe_path), *args])
+    else:
+        with TemporaryDirectory(prefix='dewy_') as build_dir:
+            exe_path = build(path.read_text(), Path(build_dir), shim_path, options)
+            result = subprocess.run([str(exe_path), *args])
+
+    if result.returncode != 0:
+        raise SystemExit(result.returncode)
+
+
+def build(src: str, build_dir: Path, runtime: Path, options: Options, profiler: Profiler | None = None) -> Path:
+    """
+    compile a dewy program into an executable in build_dir, linked with runtime (shim.c, or a prebuilt object of it).
+    Each stage is timed by profiler, if given
+    """
+    stage = profiler.stage if profiler is not None else lambda name: nullcontext()
+
+    # tokenize the source code
+    with stage('tokenize'):
+        tokens = tokenize(src)
+    with stage('post_process'):
+        post_process(tokens)
 
     # parse tokens into AST
-    ast = top_level_parse(tokens)
-    ast = post_parse(ast)
+    with stage('top_level_parse'):
+        ast = top_level_parse(tokens)
+    with stage('post_parse'):
+        ast = post_parse(ast)
+    if options.fold:
+        with stage('fold_constants'):
+            ast = fold_constants(ast)
 
     # debug printing
     if options.verbose:
         print(repr(ast))
 
     # generate the program qbe
-    qbe = top_level_compile(ast)
-    ssa = str(qbe)
-    #DEBUG
-    print(ssa)
+    with stage('compile'):
+        qbe = top_level_compile(ast)
+        ssa = str(qbe)
+    if options.verbose:
+        print(ssa)
 
-    # TODO:
     # write the ssa to a file
-    # compile the ssa with qbe
-    # construct the full executable
-    # run the executable
-
+    ssa_path = build_dir / 'program.ssa'
+    ssa_path.write_text(ssa)
+
+    # compile the ssa with qbe, and link against the runtime shim
+    with stage('qbe + cc'):
+        return build_executable(ssa_path, runtime)
+
+
+def build_executable(ssa_path: Path, runtime: Path = shim_path) -> Path:
+    """Compile a .ssa file with qbe, and link it with the runtime into an executable next to it"""
+    asm_path = ssa_path.with_suffix('.s')
+    exe_path = ssa_path.with_suffix('')
+    cc = check_toolchain()
+    subprocess.run(['qbe', '-o', str(asm_path), str(ssa_path)], check=True)
+    subprocess.run([cc, '-O2', str(asm_path), str(runtime), '-pthread', '-Wl,--gc-sections', '-o', str(exe_path)], check=True)
+    return exe_path
+
+
+def check_toolchain() -> str:
+    """make sure qbe and a C compiler are available. Returns the C compiler to use"""
+    cc = os.environ.get('CC', 'cc')
+    for tool in ('qbe', cc):
+        if shutil.which(tool) is None:
+            raise RuntimeError(f'`{tool}` was not found on the PATH. The QBE backend needs qbe (https://c9x.me/compile/) and a C compiler')
+    return cc
+
+
+# matches CFLAGS in ../runtime/Makefile. Per-function sections let --gc-sections drop unused runtime code
+runtime_cflags = ['-O3', '-ffunction-sections', '-fdata-sections', '-flto', '-ffat-lto-objects']
+
+def runtime_sources() -> list[Path]:
+    """shim.c and everything it #includes"""
+    runtime_dir = shim_path.parent.parent / 'runtime'
+    return [shim_path, *sorted(runtime_dir.glob('*.[ch]'))]
+
+
+def cached_build(src: bytes, options: Options) -> Path:
+    """executable for src from the build cache (see ../cache.py), building it first if it isn't there"""
+    cc = os.environ.get('CC', 'cc')
+    key = build_cache.cache_key(src, f'qbe {cc} fold' if options.fold else f'qbe {cc}', [*build_cache.compiler_sources(), *runtime_sources()])
+    if (entry := build_cache.lookup('qbe', key)) is not None:
+        if options.verbose:
+            print(f'using cached build {entry}')
+        return entry / 'program'
+
+    build_dir = build_cache.reserve('qbe')
+    try:
+        exe_path = build(src.decode(), build_dir, cached_runtime(), options)
+    except BaseException:
+        shutil.rmtree(build_dir, ignore_errors=True)
+        raise
+    return build_cache.commit('qbe', key, build_dir) / exe_path.name
+
+
+def cached_runtime() -> Path:
+    """shim.c compiled to an object once, rather than for every program (same as `make -C ../runtime hosted`)"""
+    cc = check_toolchain()
+    key = build_cache.cache_key(b'', f'qbe-runtime {cc}', runtime_sources())
+    if (entry := build_cache.lookup('qbe-runtime', key)) is not None:
+        return entry / 'shim.o'
+
+    build_dir = build_cache.reserve('qbe-runtime')
+    try:
+        subprocess.run([cc, *runtime_cflags, '-c', str(shim_path), '-o', str(build_dir / 'shim.o')], check=True)
+    except BaseException:
+        shutil.rmtree(build_dir, ignore_errors=True)
+        raise
+    return build_cache.commit('qbe-runtime', key, build_dir) / 'shim.o'
 
 
 def top_level_compile(ast: AST) -> 'QbeModule':
     scope = Scope.default()
     qbe = QbeModule()
-    compile(ast, scope, qbe)
-    return qbe
 
-@dataclass
-class CAST:
-    ast: AST
-    meta: SimpleNamespace
+    # the whole program is the body of main. Its value is printed unless it's void (like the python backend)
+    qbe.begin_function('$main', export=True, args=[], ret='w', parent=None, body=ast, scope=scope, params=[])
+    result = compile(ast, scope, qbe)
+    qbe.call('$__val_result', result, ret=None)
+    qbe.emit('ret 0')
+    qbe.end_function()
+
+    # function literals are compiled once everything they could refer to has been declared
+    while qbe.pending:
+        compile_function_body(*qbe.pending.pop(0), qbe)
+
+    return qbe
 
 
 # TODO: include user defined struct types...
@@ -133,43 +250,394 @@ class QbeFunction:
         blocks = '\n'.join(map(str, self.blocks))
         return f'{export}function {ret}{self.name}({args}) {{\n{blocks}\n}}'
 
+
+@dataclass(eq=False)
+class FunctionContext:
+    """Compilation state of the QBE function currently being generated"""
+    fn: QbeFunction
+    parent: 'FunctionContext | None'  # function that the closure being compiled was defined in
+    heap_frame: bool                  # variables live in a frame that nested closures can reference, rather than in temporaries
+    block: QbeBlock                   # block that instructions are currently appended to
+    frame_slots: int = 1              # slot 0 of a frame points to the parent's frame
+    prologue: list[str] = field(default_factory=list)       # allocs and variable initialization, placed at the top of @start
+    iterators: dict[int, str] = field(default_factory=dict) # id(IterIn) -> temporary holding the iterator it steps
+    var_types: dict[str, Type] = field(default_factory=dict) # static type of each variable assigned in the function (see infer_var_types)
+
+
 @dataclass
 class QbeModule:
     functions: list[QbeFunction] = field(default_factory=list)
     global_data: list[str] = field(default_factory=list)
-    global_counter = count(0)
-
-    # TODO: function for getting identifiers, or next counter
-
+    strings: dict[str, str] = field(default_factory=dict)   # string literal -> data symbol of its value
+    cstrings: dict[str, str] = field(default_factory=dict)  # string literal -> data symbol of its bytes
+    pending: list[tuple[FunctionLiteral, Scope, FunctionContext, str]] = field(default_factory=list)
+    ctx: FunctionContext | None = None
+    global_counter: count = field(default_factory=lambda: count(0))
+
+    def name(self, prefix: str) -> str:
+        """unique identifier (without sigil)"""
+        return f'{prefix}.{next(self.global_counter)}'
+
+    def temp(self, prefix: str = 't') -> str:
+        return f'%{self.name(prefix)}'
+
+    def label(self, prefix: str) -> str:
+        return f'@{self.name(prefix)}'
+
+    def emit(self, line: str) -> None:
+        self.ctx.block.lines.append(line)
+
+    def start_block(self, label: str) -> None:
+        self.ctx.block = QbeBlock(label, [])
+        self.ctx.fn.blocks.append(self.ctx.block)
+
+    def jump(self, label: str) -> None:
+        """unconditional jump, ending the current block"""
+        self.emit(f'jmp {label}')
+        self.start_block(self.label('after'))
+
+    def call(self, fn: str, *args: str, ret: QbeType | None = 'l') -> str:
+        """call a function whose arguments are all l words. Returns the temporary holding the result"""
+        args_str = ', '.join(f'l {a}' for a in args)
+        if ret is None:
+            self.emit(f'call {fn}({args_str})')
+            return '4' # void
+        result = self.temp()
+        self.emit(f'{result} ={ret} call {fn}({args_str})')
+        return result
+
+    def alloc(self, size: int) -> str:
+        """stack space, allocated once at the top of the function so loops don't grow the stack"""
+        ptr = self.temp('slot')
+        self.ctx.prologue.append(f'{ptr} =l alloc8 {max(size, 8)}')
+        return ptr
+
+    def cstring(self, s: str) -> str:
+        """null terminated bytes of a string literal"""
+        if s not in self.cstrings:
+            symbol = f'${self.name("bytes")}'
+            self.global_data.append(f'data {symbol} = {{ {qbe_bytes(s.encode())}, b 0 }}')
+            self.cstrings[s] = symbol
+        return self.cstrings[s]
+
+    def string(self, s: str) -> str:
+        """static string object (see VAL_KIND_STRING) for a string literal"""
+        if s not in self.strings:
+            symbol = f'${self.name("str")}'
+            self.global_data.append(f'data {symbol} = align 8 {{ l 1, l {len(s.encode())}, l {self.cstring(s)} }}')
+            self.strings[s] = symbol
+        return self.strings[s]
+
+    def begin_function(self, name: str, export: bool, args: list[QbeArg], ret: QbeType | None, parent: FunctionContext | None, body: AST, scope: Scope, params: list[str]) -> None:
+        assert self.ctx is None, 'INTERNAL ERROR: functions are compiled one at a time'
+        # any closures created in the function may capture its variables, so they need to outlive the call
+        heap_frame = any(isinstance(child, FunctionLiteral) for child in body.__full_traversal_iter__())
+        fn = QbeFunction(name, export, args, ret, [QbeBlock('@start', [])])
+        self.functions.append(fn)
+        self.ctx = FunctionContext(fn, parent, heap_frame, fn.blocks[0], var_types=infer_var_types(body, scope, params))
+
+    def end_function(self) -> None:
+        ctx = self.ctx
+        prologue = []
+        if ctx.heap_frame:
+            env = '%env' if ctx.parent is not None else '0'
+            prologue.append(f'%frame =l call $__val_frame(l {env}, l {ctx.frame_slots})')
+        ctx.fn.blocks[0].lines[:0] = prologue + ctx.prologue
+        self.ctx = None
 
     def __str__(self) -> str:
         functions = '\n\n'.join(map(str, self.functions))
         global_data = '\n'.join(self.global_data)
-        return f'{global_data}\n\n{functions}'
+        return f'{global_data}\n\n{functions}\n'
+
+
+def qbe_bytes(data: bytes) -> str:
+    """QBE data items for some bytes. Printable ascii goes in string items, everything else as numbers"""
+    items, run = [], ''
+    for byte in data:
+        if 0x20 <= byte < 0x7f and byte not in b'"\\':
+            run += chr(byte)
+            continue
+        if run:
+            items.append(f'b "{run}"')
+            run = ''
+        items.append(f'b {byte}')
+    if run:
+        items.append(f'b "{run}"')
+    return ', '.join(items) if items else 'b 0'
+
+
+############################ Compile time values ############################
+
+class Dynamic(AST):
+    """type of values that are only known at runtime (e.g. the result of calling a closure)"""
+    def __str__(self) -> str:
+        return 'dynamic'
+dynamic = Type(Dynamic)
+register_typeof(Dynamic, short_circuit(Dynamic))
+
+
+class QbeVar(AST):
+    """Where a dewy variable lives in the generated program. Used as the value of the variable in the compile time scope"""
+    ctx: FunctionContext
+    temp: str | None = None         # function-local temporary. QBE builds SSA form out of the repeated assignments
+    offset: int | None = None       # byte offset into the owning function's heap frame
+    unboxed: QbeType | None = None  # temp holds a raw Int (l) or Bool (w) rather than a tagged value
+
+    def __str__(self) -> str:
+        return self.temp if self.temp is not None else f'<frame+{self.offset}>'
+
+
+# tagged immediates (see ../runtime/value.h)
+VAL_UNDEFINED = '3'
+VAL_VOID = '4'
+VAL_INT_MIN, VAL_INT_MAX = -(1 << 60), (1 << 60) - 1
+
+def box_int(val: int) -> str:
+    if not VAL_INT_MIN <= val <= VAL_INT_MAX:
+        raise NotImplementedError(f'Int literal {val} does not fit in a 61-bit int, which is all the QBE backend supports right now')
+    return str((val << 3) | 1)
+
+def box_bool(val: bool) -> str:
+    return '10' if val else '2'
+
+
+def unboxed_repr(t: Type) -> QbeType | None:
+    """machine type that values of type t are compiled to when they don't need to be tagged"""
+    if t == Type(Int): return 'l'
+    if t == Type(Bool): return 'w'
+    return None
+
+def box(value: str, repr: QbeType, qbe: 'QbeModule') -> str:
+    """tag a raw Int (l) or Bool (w) so it can be passed to the runtime"""
+    if value.lstrip('-').isdigit():
+        return box_int(int(value)) if repr == 'l' else box_bool(value != '0')
+    if repr == 'w':
+        wide = qbe.temp()
+        qbe.emit(f'{wide} =l extuw {value}')
+        value = wide
+    shifted, boxed = qbe.temp(), qbe.temp()
+    qbe.emit(f'{shifted} =l shl {value}, 3')
+    qbe.emit(f'{boxed} =l or {shifted}, {1 if repr == "l" else 2}')
+    return boxed
+
+def unbox(value: str, repr: QbeType, qbe: 'QbeModule') -> str:
+    """raw Int (l) or Bool (w) out of a tagged value that is statically known to have that type"""
+    raw = qbe.temp()
+    qbe.emit(f'{raw} ={repr} {"sar" if repr == "l" else "shr"} {value}, 3')
+    return raw
+
+
+def new_var(name: str, qbe: 'QbeModule') -> tuple[QbeVar, Type]:
+    ctx = qbe.ctx
+    t = ctx.var_types.get(name, dynamic)
+    if ctx.heap_frame:
+        var = QbeVar(ctx, offset=ctx.frame_slots * 8)
+        ctx.frame_slots += 1
+        return var, t
+    temp = qbe.temp(f'v.{"".join(c if c.isalnum() and c.isascii() else "_" for c in name)}')
+    unboxed = unboxed_repr(t)
+    ctx.prologue.append(f'{temp} ={unboxed or "l"} copy {0 if unboxed else VAL_VOID}')
+    return QbeVar(ctx, temp=temp, unboxed=unboxed), t
+
+
+def frame_pointer(owner: FunctionContext, qbe: 'QbeModule') -> str:
+    """temporary holding the address of owner's frame, from inside the function currently being compiled"""
+    if owner is qbe.ctx:
+        return '%frame'
+    ptr, ctx = '%env', qbe.ctx.parent
+    while ctx is not owner:
+        assert ctx is not None, 'INTERNAL ERROR: variable belongs to a function that does not enclose the current one'
+        parent_ptr = qbe.temp('env')
+        qbe.emit(f'{parent_ptr} =l loadl {ptr}')
+        ptr, ctx = parent_ptr, ctx.parent
+    return ptr
+
+
+def load_var(var: QbeVar, qbe: 'QbeModule') -> str:
+    """the (tagged) value of a variable"""
+    if var.temp is not None:
+        assert var.ctx is qbe.ctx, 'INTERNAL ERROR: temporaries cannot be captured by closures'
+        return box(var.temp, var.unboxed, qbe) if var.unboxed else var.temp
+    addr, value = qbe.temp('addr'), qbe.temp()
+    qbe.emit(f'{addr} =l add {frame_pointer(var.ctx, qbe)}, {var.offset}')
+    qbe.emit(f'{value} =l loadl {addr}')
+    return value
+
+
+def store_var(var: QbeVar, value: str, qbe: 'QbeModule') -> None:
+    """value must already be in the variable's representation (see compile_as)"""
+    if var.temp is not None:
+        assert var.ctx is qbe.ctx, 'INTERNAL ERROR: temporaries cannot be captured by closures'
+        qbe.emit(f'{var.temp} ={var.unboxed or "l"} copy {value}')
+        return
+    addr = qbe.temp('addr')
+    qbe.emit(f'{addr} =l add {frame_pointer(var.ctx, qbe)}, {var.offset}')
+    qbe.emit(f'storel {value}, {addr}')
+
+
+def assign_var(name: str, value: AST | str, scope: Scope, qbe: 'QbeModule') -> None:
+    """
+    compile time version of Scope.assign: reuse the variable if it's visible, otherwise declare it in scope.
+    value is either the expression to assign, or a tagged value that was already computed
+    """
+    var = scope.get(name, throw=False)
+    if var is None:
+        qvar, t = new_var(name, qbe)
+        operand = compile_as(value, qvar.unboxed, scope, qbe)
+        scope.let(name, qvar, t)
+    elif var.decltype == DeclarationType.CONST:
+        raise ValueError(f'Attempted to assign to constant variable: {name=}')
+    elif not isinstance(var.value, QbeVar):
+        raise NotImplementedError(f'Assigning to "{name}" (a {var.value.__class__.__name__}) is not supported by the QBE backend yet')
+    else:
+        qvar = var.value
+        operand = compile_as(value, qvar.unboxed, scope, qbe)
+    store_var(qvar, operand, qbe)
+
+
+def declare_var(name: str, value: AST | str, decltype: DeclarationType, scope: Scope, qbe: 'QbeModule') -> None:
+    if name in scope.vars:
+        assert scope.vars[name].decltype != DeclarationType.CONST, f'Attempted to {decltype.name.lower()} declare a value that is const in this current scope. {name=}'
+    qvar, t = new_var(name, qbe)
+    operand = compile_as(value, qvar.unboxed, scope, qbe)
+    scope.declare(name, qvar, t, decltype)
+    store_var(qvar, operand, qbe)
+
+
+def collect_bindings(ast: AST, bindings: dict[str, list[AST | None]]) -> None:
+    """every expression assigned to each variable name (None for values only known at runtime, e.g. loop items)"""
+    match ast:
+        case Assign(left=Identifier(name), right=right) | Declare(target=Assign(left=Identifier(name), right=right)):
+            bindings[name].append(right)
+        case Declare(target=Identifier(name) | TypedIdentifier(id=Identifier(name)) | Assign(left=TypedIdentifier(id=Identifier(name)))):
+            bindings[name].append(None)
+        case IterIn(left=Identifier(name)):
+            bindings[name].append(None)
+        case IterIn(left=target) | Assign(left=target):
+            for child in (target, *target.__full_traversal_iter__()):
+                if isinstance(child, Identifier):
+                    bindings[child.name].append(None)
+        case FunctionLiteral():
+            # parameters could shadow variables of the same name, which isn't tracked
+            for spec in ast.args.pargs + ast.args.pkwargs + ast.args.kwargs:
+                bindings[get_arg_name(spec)].append(None)
+    for child in ast.__iter_asts__():
+        collect_bindings(child, bindings)
+
+
+def infer_var_types(body: AST, scope: Scope, params: list[str]) -> dict[str, Type]:
+    """
+    Static types for the variables assigned in a function, such that every assignment to a name (anywhere in the
+    function, including its closures) produces that type. Variables without a single such type are `dynamic`.
+    Names that are already visible in scope belong to an enclosing function, and keep the types it gave them.
+    """
+    bindings: dict[str, list[AST | None]] = defaultdict(list)
+    for name in params:
+        bindings[name].append(None)
+    collect_bindings(body, bindings)
+    types: dict[str, Type] = {name: dynamic for name in bindings if scope.get(name, throw=False) is None}
+
+    def binding_types(name: str) -> list[Type]:
+        trial = Scope(scope)
+        for other, t in types.items():
+            trial.let(other, undefined, t)
+        result = []
+        for binding in bindings[name]:
+            try:
+                result.append(dynamic if binding is None else static_type(binding, trial))
+            except ValueError: # e.g. a QJux that can't be resolved without more type information
+                result.append(dynamic)
+        return result
+
+    # guess from the first assignment with a known type, then drop guesses contradicted by other assignments
+    for name in types:
+        types[name] = next((t for t in binding_types(name) if t != dynamic), dynamic)
+    changed = True
+    while changed:
+        changed = False
+        for name, t in types.items():
+            if t != dynamic and any(bt != t for bt in binding_types(name)):
+                types[name] = dynamic
+                changed = True
+
+    return types
+
+
+cmp_ops = (Less, LessEqual, Greater, GreaterEqual, Equal)
+int_ops = (Add, Sub, Mul, Mod, LeftShift, RightShift, And, Or, Xor, Nand, Nor)
+bool_ops = (And, Or, Xor, Nand, Nor)
+
+def static_type(ast: AST, scope: Scope) -> Type:
+    """
+    The type a value will have at runtime, as far as can be told at compile time (otherwise `dynamic`).
+    Used for picking how to compile QJux and bare references, skipping void expressions in groups, and
+    deciding which values can be left unboxed
+    """
+    match ast:
+        case Int() | Bool() | String() | Array() | Range() | Void() | Undefined(): return Type(type(ast))
+        case IString(): return Type(String)
+        case FunctionLiteral(): return Type(Closure)
+        case Assign() | Declare() | Loop(): return Type(Void)
+        case IterIn(): return Type(Bool)
+        case Express(id=Identifier(name)) | Identifier(name):
+            var = scope.get(name, throw=False)
+            if var is None: return dynamic
+            if isinstance(var.value, PrototypeBuiltin):
+                return cast(Type, var.value.return_type) if isinstance(ast, Express) else var.type
+            if isinstance(ast, Express) and var.type == Type(Closure):
+                return dynamic
+            return var.type
+        case Call(f=Identifier(name)):
+            var = scope.get(name, throw=False)
+            if var is not None and isinstance(var.value, PrototypeBuiltin):
+                return cast(Type, var.value.return_type)
+            return dynamic
+        case QJux():
+            return static_type(resolve_qjux(ast, scope), scope)
+        case Group(items) | Block(items):
+            expressed = [t for i in items if (t := static_type(i, scope)) != Type(Void)]
+            if len(expressed) == 0: return Type(Void)
+            if len(expressed) == 1: return expressed[0]
+            return dynamic
+        case BinOp(left=left, right=right):
+            left, right = static_type(left, scope), static_type(right, scope)
+            if isinstance(ast, (Equal, *bool_ops)) and left == right == Type(Bool):
+                return Type(Bool)
+            if left != Type(Int) or right != Type(Int):
+                return dynamic
+            if isinstance(ast, cmp_ops): return Type(Bool)
+            if isinstance(ast, int_ops): return Type(Int)
+            return dynamic
+        case Not(operand=operand):
+            t = static_type(operand, scope)
+            return t if t in (Type(Int), Type(Bool)) else dynamic
+        case UnaryNeg(operand=operand) | UnaryPos(operand=operand):
+            return Type(Int) if static_type(operand, scope) == Type(Int) else dynamic
+        case _:
+            return dynamic
+
 
+############################ Compile functions ############################
 
 from typing import Protocol, TypeVar
 T = TypeVar('T', bound=AST)
 U = TypeVar('U', bound=AST)
 class CompileFunc(Protocol):
-    #TODO: what is the correct return type here?
-    #      - str for the name of the expression as stored in the scope if needs to be looked up?
-    #         - could be good because we make us of scopes, and help keep things organized
-    #         - what gets stored in the scope though? and how does the scope name map to the name in the QBE module?
-    #      - CAST which includes the AST, and any qbe identifiers for it?
-    def __call__(self, ast: T, scope: Scope, qbe: QbeModule) -> CAST: ...
+    def __call__(self, ast: T, scope: Scope, qbe: QbeModule) -> str:
+        """emit the code for ast into qbe's current function, and return the operand (temporary or constant) holding its value"""
 
 
 
 @cache
 def get_compile_fn_map() -> dict[type[AST], CompileFunc]:
     return {
-        # Declare: compile_declare,
+        Declare: compile_declare,
         QJux: compile_qjux,
         Call: compile_call,
-        # Block: compile_block,
-        # Group: compile_group,
-        # Array: compile_array,
+        Block: compile_block,
+        Group: compile_group,
+        Array: compile_array,
         # Dict: compile_dict,
         # PointsTo: compile_points_to,
         # BidirDict: compile_bidir_dict,
@@ -178,113 +646,519 @@ def get_compile_fn_map() -> dict[type[AST], CompileFunc]:
         # Object: no_op,
         # Access: compile_access,
         # Index: compile_index,
-        # Assign: compile_assign,
-        # IterIn: compile_iter_in,
-        # FunctionLiteral: compile_function_literal,
+        Assign: compile_assign,
+        IterIn: compile_iter_in,
+        FunctionLiteral: compile_function_literal,
         # Closure: compile_closure,
         # Builtin: compile_builtin,
         String: compile_string,
-        # IString: compile_istring,
+        IString: compile_istring,
         # Identifier: cannot_evaluate,
-        # Express: compile_express,
-        # Int: no_op,
+        Express: compile_express,
+        Int: compile_int,
         # Float: no_op,
-        # Bool: no_op,
-        # Range: no_op,
-        # Flow: compile_flow,
-        # Default: compile_default,
-        # If: compile_if,
-        # Loop: compile_loop,
-        # UnaryPos: compile_unary_dispatch,
-        # UnaryNeg: compile_unary_dispatch,
+        Bool: compile_bool,
+        Range: compile_range,
+        Flow: compile_flow,
+        Default: compile_default,
+        If: compile_if,
+        Loop: compile_loop,
+        UnaryPos: compile_unary_dispatch,
+        UnaryNeg: compile_unary_dispatch,
         # UnaryMul: compile_unary_dispatch,
         # UnaryDiv: compile_unary_dispatch,
-        # Not: compile_unary_dispatch,
-        # Greater: compile_binary_dispatch,
-        # GreaterEqual: compile_binary_dispatch,
-        # Less: compile_binary_dispatch,
-        # LessEqual: compile_binary_dispatch,
-        # Equal: compile_binary_dispatch,
-        # And: compile_binary_dispatch,
-        # Or: compile_binary_dispatch,
-        # Xor: compile_binary_dispatch,
-        # Nand: compile_binary_dispatch,
-        # Nor: compile_binary_dispatch,
-        # Xnor: compile_binary_dispatch,
-        # Add: compile_binary_dispatch,
-        # Sub: compile_binary_dispatch,
-        # Mul: compile_binary_dispatch,
-        # Div: compile_binary_dispatch,
-        # Mod: compile_binary_dispatch,
-        # Pow: compile_binary_dispatch,
+        Not: compile_unary_dispatch,
+        Greater: compile_binary_dispatch,
+        GreaterEqual: compile_binary_dispatch,
+        Less: compile_binary_dispatch,
+        LessEqual: compile_binary_dispatch,
+        Equal: compile_binary_dispatch,
+        And: compile_binary_dispatch,
+        Or: compile_binary_dispatch,
+        Xor: compile_binary_dispatch,
+        Nand: compile_binary_dispatch,
+        Nor: compile_binary_dispatch,
+        Xnor: compile_binary_dispatch,
+        Add: compile_binary_dispatch,
+        Sub: compile_binary_dispatch,
+        Mul: compile_binary_dispatch,
+        Div: compile_binary_dispatch,
+        Mod: compile_binary_dispatch,
+        Pow: compile_binary_dispatch,
+        LeftShift: compile_binary_dispatch,
+        RightShift: compile_binary_dispatch,
+        BroadcastOp: compile_broadcast_op,
         # AtHandle: compile_at_handle,
-        # Undefined: no_op,
-        # Void: no_op,
+        Undefined: lambda ast, scope, qbe: VAL_UNDEFINED,
+        Void: lambda ast, scope, qbe: VAL_VOID,
         # #TODO: other AST types here
     }
 
 
 
-def compile(ast:AST, scope:Scope, qbe: QbeModule):
+def compile(ast:AST, scope:Scope, qbe: QbeModule) -> str:
     compile_fn_map = get_compile_fn_map()
 
     ast_type = type(ast)
+
+    # operators on values proven to be Int/Bool are computed unboxed, and only tagged once the result is needed
+    if ast_type in unboxed_op_types and (repr := unboxed_repr(static_type(ast, scope))):
+        return box(compile_unboxed(ast, repr, scope, qbe), repr, qbe)
+
     if ast_type in compile_fn_map:
         return compile_fn_map[ast_type](ast, scope, qbe)
 
     raise NotImplementedError(f'AST type {ast_type} not implemented yet')
 
-def compile_qjux(ast: QJux, scope: Scope, qbe: QbeModule):
+
+def compile_as(value: AST | str, repr: QbeType | None, scope: Scope, qbe: QbeModule) -> str:
+    """compile value (or take an already computed tagged operand) as a tagged value (repr=None), or a raw l Int / w Bool"""
+    if isinstance(value, str):
+        return value if repr is None else unbox(value, repr, qbe)
+    if repr is None:
+        return compile(value, scope, qbe)
+    return compile_unboxed(value, repr, scope, qbe)
+
+
+def compile_unboxed(ast: AST, repr: QbeType, scope: Scope, qbe: QbeModule) -> str:
+    """emit code for an expression statically known to be an Int (repr='l') or Bool (repr='w'), returning the raw value"""
+    assert unboxed_repr(static_type(ast, scope)) == repr, f'INTERNAL ERROR: {ast=} is not statically a {repr} value'
+    match ast:
+        case Int(val):
+            box_int(val) # same 61-bit limit as tagged literals
+            return str(val)
+        case Bool(val):
+            return '1' if val else '0'
+        case Express(id=Identifier(name)) if isinstance(var := scope.get(name).value, QbeVar):
+            return var.temp if var.unboxed else unbox(load_var(var, qbe), repr, qbe)
+        case LeftShift() | RightShift() if not (type(ast.right) is Int and 0 <= ast.right.val < 61):
+            # qbe takes shift counts mod 64, so any count that isn't known to be in range goes through the runtime's shift
+            return unbox(compile_binary_dispatch(ast, scope, qbe), repr, qbe)
+        case BinOp() if type(ast) in unboxed_op_types:
+            return compile_unboxed_binop(ast, repr, scope, qbe)
+        case UnaryPrefixOp() if type(ast) in unboxed_op_types:
+            return compile_unboxed_unary(ast, repr, scope, qbe)
+
+    # anything else (e.g. a call to a function returning an Int) is computed as a tagged value and unpacked
+    return unbox(compile(ast, scope, qbe), repr, qbe)
+
+
+# single instruction versions of the runtime's operators, for Int (l) and Bool (w) operands
+unboxed_binops: dict[tuple[type[BinOp], QbeType], str] = {
+    (Add, 'l'): 'add',
+    (Sub, 'l'): 'sub',
+    (Mul, 'l'): 'mul',
+    (LeftShift, 'l'): 'shl',
+    (RightShift, 'l'): 'sar',
+    (Less, 'l'): 'csltl',
+    (LessEqual, 'l'): 'cslel',
+    (Greater, 'l'): 'csgtl',
+    (GreaterEqual, 'l'): 'csgel',
+    (Equal, 'l'): 'ceql',
+    (Equal, 'w'): 'ceqw',
+    **{(op, repr): inst for repr in ('l', 'w') for op, inst in ((And, 'and'), (Or, 'or'), (Xor, 'xor'), (Nand, 'and'), (Nor, 'or'))},
+}
+unboxed_op_types = {op for op, _ in unboxed_binops} | {Mod, Not, UnaryNeg, UnaryPos}
+
+def compile_unboxed_binop(op: BinOp, repr: QbeType, scope: Scope, qbe: QbeModule) -> str:
+    operand_repr = unboxed_repr(static_type(op.left, scope))
+    left = compile_unboxed(op.left, operand_repr, scope, qbe)
+    right = compile_unboxed(op.right, operand_repr, scope, qbe)
+
+    if isinstance(op, Mod):
+        return compile_unboxed_mod(left, right, qbe)
+
+    result = qbe.temp()
+    qbe.emit(f'{result} ={repr} {unboxed_binops[(type(op), operand_repr)]} {left}, {right}')
+    if isinstance(op, (Nand, Nor)):
+        inverted = qbe.temp()
+        qbe.emit(f'{inverted} ={repr} xor {result}, {-1 if repr == "l" else 1}')
+        result = inverted
+    if isinstance(op, wrapping_ops):
+        result = wrap_int(result, qbe)
+    return result
+
+# ops whose raw result can leave the 61 bits of an Int, and so has to wrap like the runtime's tagged ops
+wrapping_ops = (Add, Sub, Mul, LeftShift, UnaryNeg)
+
+def wrap_int(value: str, qbe: QbeModule) -> str:
+    """sign extend a raw l Int from 61 bits, so it's the same value as once it's boxed"""
+    shifted, wrapped = qbe.temp(), qbe.temp()
+    qbe.emit(f'{shifted} =l shl {value}, 3')
+    qbe.emit(f'{wrapped} =l sar {shifted}, 3')
+    return wrapped
+
+def compile_unboxed_mod(left: str, right: str, qbe: QbeModule) -> str:
+    # floored like the runtime's (and python's) %, which means adjusting rem when the signs differ
+    if not right.lstrip('-').isdigit() or right == '0':
+        nonzero, ok, fail = qbe.temp(), qbe.label('mod.ok'), qbe.label('mod.zero')
+        qbe.emit(f'{nonzero} =w cnel {right}, 0')
+        qbe.emit(f'jnz {nonzero}, {ok}, {fail}')
+        qbe.start_block(fail)
+        compile_fail('integer modulo by zero', qbe)
+        qbe.emit(f'jmp {ok}')
+        qbe.start_block(ok)
+    rem, signs, negative, nonzero, adjust, wide, offset, result = (qbe.temp() for _ in range(8))
+    qbe.emit(f'{rem} =l rem {left}, {right}')
+    qbe.emit(f'{signs} =l xor {rem}, {right}')
+    qbe.emit(f'{negative} =w csltl {signs}, 0')
+    qbe.emit(f'{nonzero} =w cnel {rem}, 0')
+    qbe.emit(f'{adjust} =w and {negative}, {nonzero}')
+    qbe.emit(f'{wide} =l extuw {adjust}')
+    qbe.emit(f'{offset} =l mul {wide}, {right}')
+    qbe.emit(f'{result} =l add {rem}, {offset}')
+    return result
+
+def compile_unboxed_unary(op: UnaryPrefixOp, repr: QbeType, scope: Scope, qbe: QbeModule) -> str:
+    operand = compile_unboxed(op.operand, repr, scope, qbe)
+    if isinstance(op, UnaryPos):
+        return operand
+    result = qbe.temp()
+    if isinstance(op, UnaryNeg):
+        qbe.emit(f'{result} =l neg {operand}')
+        return wrap_int(result, qbe)
+    else:
+        qbe.emit(f'{result} ={repr} xor {operand}, {-1 if repr == "l" else 1}')
+    return result
+
+
+def compile_condition(ast: AST, scope: Scope, qbe: QbeModule) -> str:
+    """w temporary that is 1 if the condition of an if/loop holds"""
+    if static_type(ast, scope) == Type(Bool):
+        return compile_unboxed(ast, 'w', scope, qbe)
+    return qbe.call('$__val_truthy', compile(ast, scope, qbe), ret='w')
+
+
+def resolve_qjux(ast: QJux, scope: Scope) -> AST:
+    """pick which interpretation of the juxtaposition is valid (same rules as the python backend's evaluate_qjux)"""
     if ast.call is not None and typecheck_call(ast.call, scope):
-        return compile_call(ast.call, scope, qbe)
+        return ast.call
     if ast.index is not None and typecheck_index(ast.index, scope):
-        return compile_index(ast.index, scope, qbe)
+        return ast.index
     if typecheck_multiply(ast.mul, scope):
-        return compile_binary_dispatch(ast.mul, scope, qbe)
+        return ast.mul
+
+    # without a value to check, assume a call is intended if what's being called is only known at runtime
+    if ast.call is not None and typeof(ast.call.f, scope) == dynamic:
+        return ast.call
 
     raise ValueError(f'Typechecking failed to match a valid evaluation for QJux. {ast=}')
 
+def compile_qjux(ast: QJux, scope: Scope, qbe: QbeModule) -> str:
+    return compile(resolve_qjux(ast, scope), scope, qbe)
 
 
-def compile_string(ast: String, scope: Scope, qbe: QbeModule):
-    pdb.set_trace()
-    ...
+def compile_int(ast: Int, scope: Scope, qbe: QbeModule) -> str:
+    return box_int(ast.val)
 
-def compile_call(call: Call, scope: Scope, qbe: QbeModule):
-    f = call.f
+def compile_bool(ast: Bool, scope: Scope, qbe: QbeModule) -> str:
+    return box_bool(ast.val)
 
-    # get the expression of the group
-    if isinstance(f, Group):
-        pdb.set_trace()
-        f = evaluate(f, scope)
+def compile_string(ast: String, scope: Scope, qbe: QbeModule) -> str:
+    return qbe.string(ast.val)
 
-    # get the value pointed to by the identifier
-    if isinstance(f, Identifier):
-        f = scope.get(f.name).value
 
-    # if this is a handle, do a partial evaluation rather than a call
-    if isinstance(f, AtHandle):
-        pdb.set_trace()
-        return apply_partial_eval(f.operand, call.args, scope)
+def compile_values(items: list[AST], scope: Scope, qbe: QbeModule) -> tuple[str, str]:
+    """compile each item and store them in a stack array. Returns the (count, pointer) arguments for the runtime"""
+    values = [compile(i, scope, qbe) for i in items]
+    if len(values) == 0:
+        return '0', '0'
+    ptr = qbe.alloc(8 * len(values))
+    for i, value in enumerate(values):
+        addr = qbe.temp('addr')
+        qbe.emit(f'{addr} =l add {ptr}, {8 * i}')
+        qbe.emit(f'storel {value}, {addr}')
+    return str(len(values)), ptr
 
-    # AST being called must be TypingCallable
-    assert isinstance(f, (PrototypeBuiltin, Closure)), f'expected Function or Builtin, got {f}'
 
-    # save the args of the call as metadata for the function AST
-    call_args, call_kwargs = collect_calling_args(call.args, scope)
-    scope.meta[f].call_args = call_args, call_kwargs
+def compile_istring(ast: IString, scope: Scope, qbe: QbeModule) -> str:
+    # arguments to print/printl are printed part by part instead (see compile_print)
+    return qbe.call('$__val_concat', *compile_values(ast.parts, scope, qbe))
 
-    # run the function and return the result
-    if isinstance(f, PrototypeBuiltin):
-        return compile_call_pyaction(f, scope, qbe)
-    if isinstance(f, Closure):
-        return compile_call_closure(f, scope, qbe)
+def compile_array(ast: Array, scope: Scope, qbe: QbeModule) -> str:
+    return qbe.call('$__val_array', *compile_values(ast.items, scope, qbe))
 
-    pdb.set_trace()
-    raise NotImplementedError(f'Function evaluation not implemented yet')
+def compile_range(ast: Range, scope: Scope, qbe: QbeModule) -> str:
+    match ast.left:
+        case Array(items=[first, second]):
+            first, second = compile(first, scope, qbe), compile(second, scope, qbe)
+        case _:
+            first, second = compile(ast.left, scope, qbe), VAL_UNDEFINED
+    last = compile(ast.right, scope, qbe)
+    brackets = int(ast.brackets[0] == '(') | int(ast.brackets[1] == ']') << 1
+    return qbe.call('$__val_range', first, second, last, str(brackets))
+
+
+def compile_group(ast: Group, scope: Scope, qbe: QbeModule) -> str:
+    # the value of a group is whichever item isn't void (the python backend raises if there are several)
+    result = None
+    for expr in ast.items:
+        value = compile(expr, scope, qbe)
+        if static_type(expr, scope) == Type(Void):
+            continue
+        result = value if result is None else qbe.call('$__val_keep', result, value)
+    return VAL_VOID if result is None else result
+
+def compile_block(ast: Block, scope: Scope, qbe: QbeModule) -> str:
+    scope = Scope(scope)
+    return compile_group(Group(ast.items), scope, qbe)
+
+
+def compile_express(ast: Express, scope: Scope, qbe: QbeModule) -> str:
+    var = scope.get(ast.id.name)
+
+    # bare builtins (e.g. `readl`) are called with no arguments
+    if isinstance(var.value, PrototypeBuiltin):
+        return compile_call_pyaction(ast.id.name, var.value, None, scope, qbe)
+    if not isinstance(var.value, QbeVar):
+        raise NotImplementedError(f'Express of {var.value.__class__.__name__} not supported by the QBE backend yet')
+
+    value = load_var(var.value, qbe)
+    if var.type == Type(Closure):
+        return qbe.call('$__val_call', value, '0', '0')
+    if var.type == dynamic:
+        return qbe.call('$__val_express', value)
+    return value
+
+
+def compile_declare(ast: Declare, scope: Scope, qbe: QbeModule) -> str:
+    match ast.target:
+        case Identifier(name) | TypedIdentifier(id=Identifier(name)):
+            value = VAL_VOID
+        case Assign(left=Identifier(name) | TypedIdentifier(id=Identifier(name)), right=value):
+            pass
+        case _:
+            raise NotImplementedError(f'Declare not implemented yet for {ast.target=}')
+
+    declare_var(name, value, ast.decltype, scope, qbe)
+    return VAL_VOID
+
+
+def compile_assign(ast: Assign, scope: Scope, qbe: QbeModule) -> str:
+    match ast:
+        case Assign(left=Identifier(name), right=right):
+            assign_var(name, right, scope, qbe)
+            return VAL_VOID
+    raise NotImplementedError(f'Assign not implemented yet for {ast.left=}')
+
+
+def collect_iter_ins(ast: AST) -> list[IterIn]:
+    """IterIns making up a loop condition (but not ones inside nested loops or functions, which have their own)"""
+    if isinstance(ast, IterIn):
+        return [ast]
+    if isinstance(ast, (Loop, FunctionLiteral)):
+        return []
+    return [i for child in ast.__iter_asts__() for i in collect_iter_ins(child)]
+
+def start_iterator(ast: IterIn, scope: Scope, qbe: QbeModule) -> str:
+    iterator = qbe.call('$__val_iter', compile(ast.right, scope, qbe))
+    qbe.ctx.iterators[id(ast)] = iterator
+    return iterator
+
+def compile_iter_in(ast: IterIn, scope: Scope, qbe: QbeModule) -> str:
+    # iterators for a loop condition are started before the loop. Anywhere else, they start fresh each time
+    iterator = qbe.ctx.iterators.get(id(ast)) or start_iterator(ast, scope, qbe)
+    slot = qbe.alloc(8)
+    cond = qbe.call('$__val_next', iterator, slot)
+    item = qbe.temp()
+    qbe.emit(f'{item} =l loadl {slot}')
+    match ast.left:
+        case Identifier(name):
+            assign_var(name, item, scope, qbe)
+        case _:
+            raise NotImplementedError(f'IterIn not implemented yet for {ast.left=}')
+    return cond
+
+
+def compile_flow(ast: Flow, scope: Scope, qbe: QbeModule) -> str:
+    # the value of a flow is the value of whichever branch was entered, or void
+    result = qbe.temp('flow')
+    qbe.emit(f'{result} =l copy {VAL_VOID}')
+    end = qbe.label('flow.end')
+    for branch in ast.branches:
+        branch_scope = Scope(scope)
+        next_branch = qbe.label('flow.next')
+        match branch:
+            case If(condition=condition, body=body):
+                cond = compile_condition(condition, branch_scope, qbe)
+                then = qbe.label('if.then')
+                qbe.emit(f'jnz {cond}, {then}, {next_branch}')
+                qbe.start_block(then)
+                qbe.emit(f'{result} =l copy {compile(body, branch_scope, qbe)}')
+                qbe.jump(end)
+
+            case Loop(condition=condition, body=body):
+                for iter_in in collect_iter_ins(condition):
+                    start_iterator(iter_in, branch_scope, qbe)
+                entered = qbe.temp('entered')
+                qbe.emit(f'{entered} =w copy 0')
+                head, loop_body, done = qbe.label('loop.cond'), qbe.label('loop.body'), qbe.label('loop.end')
+                qbe.emit(f'jmp {head}')
+                qbe.start_block(head)
+                cond = compile_condition(condition, branch_scope, qbe)
+                qbe.emit(f'jnz {cond}, {loop_body}, {done}')
+                qbe.start_block(loop_body)
+                qbe.emit(f'{entered} =w copy 1')
+                compile(body, branch_scope, qbe)
+                qbe.emit(f'jmp {head}')
+                qbe.start_block(done)
+                # loops don't express a value, so the flow just ends if the loop ran at all
+                qbe.emit(f'jnz {entered}, {end}, {next_branch}')
+
+            case Default(body=body):
+                qbe.emit(f'{result} =l copy {compile(body, branch_scope, qbe)}')
+                qbe.emit(f'jmp {end}')
+
+            case _:
+                raise NotImplementedError(f'compile_flow not implemented for flow type {branch=}')
+
+        qbe.start_block(next_branch)
+
+    qbe.start_block(end)
+    return result
+
+def compile_if(ast: If, scope: Scope, qbe: QbeModule) -> str:
+    return compile_flow(Flow([ast]), scope, qbe)
+
+def compile_loop(ast: Loop, scope: Scope, qbe: QbeModule) -> str:
+    compile_flow(Flow([ast]), scope, qbe)
+    return VAL_VOID
+
+def compile_default(ast: Default, scope: Scope, qbe: QbeModule) -> str:
+    return compile(ast.body, Scope(scope), qbe)
+
+
+binary_runtime_fns: dict[type[BinOp], str] = {
+    Add: '$__val_add',
+    Sub: '$__val_sub',
+    Mul: '$__val_mul',
+    Div: '$__val_div',
+    Mod: '$__val_mod',
+    Pow: '$__val_pow',
+    Less: '$__val_lt',
+    LessEqual: '$__val_le',
+    Greater: '$__val_gt',
+    GreaterEqual: '$__val_ge',
+    Equal: '$__val_eq',
+    And: '$__val_and',
+    Or: '$__val_or',
+    Xor: '$__val_xor',
+    Nand: '$__val_nand',
+    Nor: '$__val_nor',
+    Xnor: '$__val_xnor',
+    LeftShift: '$__val_shl',
+    RightShift: '$__val_shr',
+}
+# which operator __val_broadcast applies (VAL_OP_* in ../runtime/value.h, in the same order as above)
+broadcast_op_codes: dict[type[BinOp], int] = {op: code for code, op in enumerate(binary_runtime_fns)}
+
+unary_runtime_fns: dict[type[UnaryPrefixOp], str] = {
+    Not: '$__val_not',
+    UnaryNeg: '$__val_neg',
+    UnaryPos: '$__val_pos',
+}
+
+def compile_binary_dispatch(op: BinOp, scope: Scope, qbe: QbeModule) -> str:
+    # both sides are always evaluated (no short circuiting), same as the python backend
+    left = compile(op.left, scope, qbe)
+    right = compile(op.right, scope, qbe)
+    return qbe.call(binary_runtime_fns[type(op)], left, right)
+
+def compile_unary_dispatch(op: UnaryPrefixOp, scope: Scope, qbe: QbeModule) -> str:
+    operand = compile(op.operand, scope, qbe)
+    return qbe.call(unary_runtime_fns[type(op)], operand)
+
+def compile_broadcast_op(ast: BroadcastOp, scope: Scope, qbe: QbeModule) -> str:
+    if type(ast.op) not in broadcast_op_codes:
+        raise NotImplementedError(f'Broadcasting {type(ast.op).__name__} is not supported by the QBE backend yet')
+    left = compile(ast.op.left, scope, qbe)
+    right = compile(ast.op.right, scope, qbe)
+    return qbe.call('$__val_broadcast', str(broadcast_op_codes[type(ast.op)]), left, right)
+
+
+def compile_function_literal(ast: FunctionLiteral, scope: Scope, qbe: QbeModule) -> str:
+    symbol = f'${qbe.name("dewy.fn")}'
+    qbe.pending.append((ast, scope, qbe.ctx, symbol))
+    env = '%frame' if qbe.ctx.heap_frame else '0'
+    return qbe.call('$__val_closure', symbol, env, qbe.string(str(ast)))
+
+def compile_function_body(ast: FunctionLiteral, scope: Scope, parent: FunctionContext, symbol: str, qbe: QbeModule) -> None:
+    """generate `function l <symbol>(l %env, l %argc, l %argv)` for a function literal (see ../runtime/value.h)"""
+    args = [QbeArg('%env', 'l'), QbeArg('%argc', 'l'), QbeArg('%argv', 'l')]
+    fn_scope = Scope(scope)
+    params = [get_arg_name(spec) for spec in ast.args.pargs + ast.args.pkwargs + ast.args.kwargs]
+    qbe.begin_function(symbol, export=False, args=args, ret='l', parent=parent, body=ast.body, scope=fn_scope, params=params)
+    bind_arguments(ast.args, fn_scope, qbe)
+    result = compile(ast.body, fn_scope, qbe)
+    qbe.emit(f'ret {result}')
+    qbe.end_function()
+
+def compile_fail(msg: str, qbe: QbeModule) -> None:
+    qbe.call('$__val_fail', qbe.cstring(msg), ret=None)
+    qbe.emit('ret 0') # unreachable, __val_fail exits
+    qbe.start_block(qbe.label('after'))
+
+def bind_arguments(signature: Signature, scope: Scope, qbe: QbeModule) -> None:
+    """declare the parameters of the function being compiled from %argc/%argv, falling back to their defaults"""
+    positional = signature.pargs + signature.pkwargs
+    too_many, ok = qbe.temp(), qbe.label('args.ok')
+    fail = qbe.label('args.fail')
+    qbe.emit(f'{too_many} =w cugtl %argc, {len(positional)}')
+    qbe.emit(f'jnz {too_many}, {fail}, {ok}')
+    qbe.start_block(fail)
+    compile_fail(f'Too many positional arguments for function. {signature=}', qbe)
+    qbe.emit(f'jmp {ok}')
+    qbe.start_block(ok)
+
+    for i, spec in enumerate(positional):
+        name = get_arg_name(spec)
+        given, missing, done = qbe.label('arg.given'), qbe.label('arg.default'), qbe.label('arg.done')
+        has_arg = qbe.temp()
+        qbe.emit(f'{has_arg} =w cugtl %argc, {i}')
+        qbe.emit(f'jnz {has_arg}, {given}, {missing}')
+        qbe.start_block(given)
+        addr, value = qbe.temp('addr'), qbe.temp('arg')
+        qbe.emit(f'{addr} =l add %argv, {8 * i}')
+        qbe.emit(f'{value} =l loadl {addr}')
+        qbe.emit(f'jmp {done}')
+        qbe.start_block(missing)
+        if isinstance(spec, Assign):
+            qbe.emit(f'{value} =l copy {compile(spec.right, scope, qbe)}')
+        else:
+            compile_fail(f'Missing argument "{name}" for function. {signature=}', qbe)
+        qbe.emit(f'jmp {done}')
+        qbe.start_block(done)
+        declare_var(name, value, DeclarationType.LET, scope, qbe)
+
+    for spec in signature.kwargs:
+        assert isinstance(spec, Assign), f'INTERNAL ERROR: {spec=} is not an Assign'
+        declare_var(get_arg_name(spec), spec.right, DeclarationType.LET, scope, qbe)
+
+
+def compile_call(call: Call, scope: Scope, qbe: QbeModule) -> str:
+    f = call.f
+
+    # get the value pointed to by the identifier
+    if isinstance(f, Identifier):
+        var = scope.get(f.name)
+        if isinstance(var.value, PrototypeBuiltin):
+            return compile_call_pyaction(f.name, var.value, call.args, scope, qbe)
+        if not isinstance(var.value, QbeVar):
+            raise NotImplementedError(f'Calling {var.value.__class__.__name__} not supported by the QBE backend yet')
+        f_value = load_var(var.value, qbe)
 
+    # if this is a handle, do a partial evaluation rather than a call
+    elif isinstance(f, AtHandle):
+        raise NotImplementedError('Partial evaluation is not supported by the QBE backend yet')
 
+    # e.g. a group holding a function literal
+    else:
+        f_value = compile(f, scope, qbe)
 
+    call_args, call_kwargs = collect_calling_args(call.args, scope)
+    if call_kwargs:
+        raise NotImplementedError(f'Keyword arguments are not supported by the QBE backend yet. {call=}')
+    return compile_call_closure(f_value, call_args, scope, qbe)
 
 
 #TODO: longer term this might also return a list/dict of spread args passed into the function
@@ -303,17 +1177,10 @@ def collect_calling_args(args: AST | None, scope: Scope) -> tuple[list[AST], dic
     """
     match args:
         case None | Void(): return [], {}
-        case Identifier(name): return [scope.get(name).value], {}
+        case Identifier(): return [Express(args)], {}
         case Assign(left=Identifier(name)|TypedIdentifier(id=Identifier(name)), right=right): return [], {name: right}
-        # case Assign(left=UnpackTarget() as target, right=right): raise NotImplementedError('UnpackTarget not implemented yet')
-        case Assign(): raise NotImplementedError('Assign not implemented yet') #called recursively if a calling arg was an keyword arg rather than positional
-        case CollectInto(right=right):
-            pdb.set_trace()
-            ... #right should be iterable, so extend with the values it expresses
-                #whether to add to args or kwargs depends on each type from right
-            val = evaluate(right, scope)
-            match val:
-                case Array(items): ... #return [collect_calling_args(i, scope) for i in items]
+        case Assign(): raise NotImplementedError('Assign not implemented yet')
+        case CollectInto(): raise NotImplementedError('Spreading arguments is not supported by the QBE backend yet')
         case Group(items):
             call_args, call_kwargs = [], {}
             for i in items:
@@ -321,32 +1188,47 @@ def collect_calling_args(args: AST | None, scope: Scope) -> tuple[list[AST], dic
                 call_args.extend(a)
                 call_kwargs.update(kw)
             return call_args, call_kwargs
-
-        #TODO: eventually it should just be anything that is left over is positional args rather than specifying them all out
-        case Int() | String() | IString() | Range() | Call() | Access() | Index() | Express() | QJux() | UnaryPrefixOp() | UnaryPostfixOp() | BinOp() | BroadcastOp():
-            return [args], {}
-        # case Call(): return [args], {}
         case _:
-            pdb.set_trace()
-            raise NotImplementedError(f'collect_args not implemented yet for {args}')
-
-
-    raise NotImplementedError(f'collect_args not implemented yet for {args}')
-
-
-
-
-
-
-
-
-
-
-def compile_call_pyaction(f: PrototypeBuiltin, scope: Scope, qbe: QbeModule):
-    pdb.set_trace()
-    ...
+            return [args], {}
 
 
-def compile_call_closure(f: Closure, scope: Scope, qbe: QbeModule):
-    pdb.set_trace()
-    ...
\ No newline at end of file
+def compile_call_pyaction(name: str, f: PrototypeBuiltin, args: AST | None, scope: Scope, qbe: QbeModule) -> str:
+    """calls to builtins go straight to the runtime"""
+    signature = normalize_function_args(f.args)
+    call_args, call_kwargs = collect_calling_args(args, scope)
+    positional = signature.pargs + signature.pkwargs
+    if len(call_args) > len(positional):
+        raise ValueError(f'Too many positional arguments for {name}. {signature=}, {call_args=}')
+    bound: dict[str, AST] = {get_arg_name(spec): arg for spec, arg in zip(positional, call_args)} | call_kwargs
+    for spec in positional + signature.kwargs:
+        if get_arg_name(spec) not in bound:
+            if not isinstance(spec, Assign):
+                raise ValueError(f'Missing argument "{get_arg_name(spec)}" for {name}')
+            bound[get_arg_name(spec)] = spec.right
+
+    match name:
+        case 'printl' | 'print':
+            compile_print(bound['s'], scope, qbe, newline=name == 'printl')
+            return VAL_VOID
+        case 'readl': return qbe.call('$__val_readl')
+        case 'time': return qbe.call('$__val_time')
+        case 'cycles': return qbe.call('$__val_cycles')
+
+    raise NotImplementedError(f'builtin "{name}" is not supported by the QBE backend yet')
+
+def compile_print(s: AST, scope: Scope, qbe: QbeModule, newline: bool) -> None:
+    # literal text is written directly, and interpolated strings are printed piece by piece rather than joined first
+    parts = s.parts if isinstance(s, IString) else [s]
+    for part in parts:
+        if isinstance(part, String):
+            if part.val:
+                qbe.call('$__write', qbe.cstring(part.val), str(len(part.val.encode())), ret=None)
+        else:
+            qbe.call('$__val_print', compile(part, scope, qbe), ret=None)
+    if newline:
+        qbe.call('$__putl', ret=None)
+
+
+def compile_call_closure(f: str, args: list[AST], scope: Scope, qbe: QbeModule) -> str:
+    argc, argv = compile_values(args, scope, qbe)
+    return qbe.call('$__val_call', f, argc, argv)
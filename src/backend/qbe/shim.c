@@ -5,6 +5,8 @@
  * 
  * Usage:
  * qbe myprog.ssa > myprog.s && gcc shim.c myprog.s -o myprog && ./myprog
+ * or link against the prebuilt runtime (`make -C ../runtime hosted`) instead of recompiling this file:
+ * gcc myprog.s ../runtime/build/hosted/libdewyrt.a -pthread -Wl,--gc-sections -o myprog
  * note that myprog.ssa should contain a $main function
  * ```qbe
  * export function w $main(l %argc, l %argv, l %envp) { ... }
@@ -13,12 +15,43 @@
  * 
  * Other notes:
  * - to increment argv/envp to the next pointer, you must add 8
- * -
+ * - all output goes through a runtime-owned buffer (see __write). It is flushed
+ *   when full, on newlines in line-buffered mode, before reading stdin, and at exit.
+ *   Call __flush to force it out, and __setbufmode to pick the buffering mode
+ * - numbers are formatted by ../runtime/fmt.c rather than printf. Floats print
+ *   the shortest digits that round-trip, laid out like python's float repr
+ * - stdin is read in blocks. __getdlv/__getlv return zero-copy views into the
+ *   input buffer; __getdl/__getl return a heap allocated copy (free with __free)
+ * - __arena_* provide bump allocation for temporaries that can all be released together
+ * - threads (__thread_spawn/__thread_join) are pthreads, so link with -pthread. mutexes
+ *   and condition variables are zero-initialized w words (see ../runtime/sync.h), and
+ *   atomics are documented in ../runtime/atomic.h
+ * - __spawn/__sync/__par_for run tasks on a work-stealing scheduler (see ../runtime/tasks.h)
+ * - __val_* implement dewy's dynamically typed values for code generated by
+ *   qbe.py (see ../runtime/value.h)
+ * - file functions follow ../runtime/file.h, which documents the shared ABI with
+ *   the freestanding runtime. __fmap maps a whole file for zero-copy reading
  * 
  */
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// number formatting (libc-free, shared with the freestanding runtime)
+#include "../runtime/fmt.c"
 
 
 // declarations
@@ -31,14 +64,19 @@ void __puti64(int64_t i);
 void __putf32(float f);
 void __putf64(double d);
 void __putl();
+void __flush();
+void __setbufmode(uint8_t mode);
 uint64_t __getl(uint8_t** dst);
 uint64_t __getdl(uint8_t** dst, uint8_t delimiter);
+uint64_t __getlv(uint8_t** dst);
+uint64_t __getdlv(uint8_t** dst, uint8_t delimiter);
 void* __malloc(uint64_t size);
 void __free(void* ptr);
 void* __realloc(void* ptr, uint64_t size);
-
-
-// future extensions
+void* __arena_new(uint64_t chunk_size);
+void* __arena_alloc(void* arena, uint64_t size);
+void __arena_reset(void* arena);
+void __arena_free(void* arena);
 void* __fopen(uint8_t* path, uint8_t* mode);
 void __fclose(void* stream);
 uint64_t __fread(void* stream, uint8_t* buffer, uint64_t size);
@@ -49,13 +87,39 @@ uint64_t __fseek(void* stream, int64_t offset, uint8_t whence);
 uint64_t __ftell(void* stream);
 uint64_t __stat(uint8_t* path, uint64_t* size, uint64_t* mtime);
 uint8_t __unlink(uint8_t* path);
+uint8_t* __fmap(uint8_t* path, uint64_t* size);
+void __funmap(uint8_t* ptr, uint64_t size);
 void __memcpy(uint8_t* dest, uint8_t* src, uint64_t size);
 void __memset(uint8_t* dest, uint8_t value, uint64_t size);
 void __exit(uint64_t code);
+uint64_t __time();   // monotonic nanoseconds
+uint64_t __cycles(); // cpu timestamp counter
+void* __thread_spawn(void* (*fn)(void*), void* arg);
+void* __thread_join(void* thread);
+void** __thread_local();
+uint64_t __ncpus();
+uint64_t __aloadl(uint64_t* ptr);
+void __astorel(uint64_t* ptr, uint64_t value);
+uint64_t __acasl(uint64_t* ptr, uint64_t expected, uint64_t desired);
+uint64_t __afaddl(uint64_t* ptr, uint64_t value);
+uint32_t __aloadw(uint32_t* ptr);
+void __astorew(uint32_t* ptr, uint32_t value);
+uint32_t __acasw(uint32_t* ptr, uint32_t expected, uint32_t desired);
+uint32_t __afaddw(uint32_t* ptr, uint32_t value);
+void __mutex_lock(uint32_t* mutex);
+uint8_t __mutex_trylock(uint32_t* mutex);
+void __mutex_unlock(uint32_t* mutex);
+void __cond_wait(uint32_t* cond, uint32_t* mutex);
+void __cond_signal(uint32_t* cond);
+void __cond_broadcast(uint32_t* cond);
+void __sched_init(uint64_t workers);
+void __spawn(void (*fn)(void* ctx), void* ctx);
+void __sync();
+void __par_for(int64_t begin, int64_t end, int64_t grain, void (*fn)(void* ctx, int64_t lo, int64_t hi), void* ctx);
+
+
+// future extensions
 uint64_t __system(uint8_t* command);
-uint64_t __time(); //return microseconds?
-// struct {uint64_t s; uint64_t n} __precise_time(){} //return uint128_t of nanoseconds?
-//threading stuff/synchronization
 
 
 // implementations
@@ -65,71 +129,306 @@ uint64_t __cstrlen(uint8_t* s)
     while (s[len] != '\0') len++;
     return len;
 }
-void __putcstr(uint8_t* s) { fputs((char*)s, stdout); }
-void __write(uint8_t* s, uint64_t len) { fwrite(s, len, 1, stdout); }
+
+////// buffered output //////
+#define OUTBUF_SIZE 65536
+#define BUFMODE_FULL 0 // flush only when the buffer is full (or on __flush/exit)
+#define BUFMODE_LINE 1 // additionally flush after every newline
+#define BUFMODE_AUTO 2 // line buffered if stdout is a terminal, otherwise fully buffered
+
+static uint8_t __outbuf[OUTBUF_SIZE];
+static uint64_t __outlen = 0;
+static uint8_t __outmode = BUFMODE_AUTO;
+static uint8_t __outinit = 0;
+
+static void __outsetup()
+{
+    __outinit = 1;
+    if (__outmode == BUFMODE_AUTO) __outmode = isatty(STDOUT_FILENO) ? BUFMODE_LINE : BUFMODE_FULL;
+    atexit(__flush);
+}
+static void __outraw(uint8_t* s, uint64_t len)
+{
+    fwrite(s, len, 1, stdout);
+    fflush(stdout);
+}
+void __flush()
+{
+    if (__outlen == 0) return;
+    __outraw(__outbuf, __outlen);
+    __outlen = 0;
+}
+void __setbufmode(uint8_t mode)
+{
+    __flush();
+    __outmode = mode;
+    if (__outinit && __outmode == BUFMODE_AUTO) __outmode = isatty(STDOUT_FILENO) ? BUFMODE_LINE : BUFMODE_FULL;
+}
+void __write(uint8_t* s, uint64_t len)
+{
+    if (!__outinit) __outsetup();
+    if (__outlen + len > OUTBUF_SIZE)
+    {
+        __flush();
+        // too big to ever fit, so skip the buffer entirely
+        if (len >= OUTBUF_SIZE)
+        {
+            __outraw(s, len);
+            return;
+        }
+    }
+    memcpy(&__outbuf[__outlen], s, len);
+    __outlen += len;
+    if (__outmode == BUFMODE_LINE && memchr(s, '\n', len) != NULL) __flush();
+}
+
+void __putcstr(uint8_t* s) { __write(s, __cstrlen(s)); }
 void __putu64(uint64_t u)
 {
-    const uint64_t buf_size = 20;
-    uint8_t buf[buf_size];
-    uint8_t len = 0;
-    do {
-        buf[buf_size - ++len] = '0' + u % 10;
-        u /= 10;
-    } while (u > 0);
-    fwrite(&buf[buf_size - len], len, 1, stdout);
-}
-void __putu64x(uint64_t u)
-{
-    const uint64_t buf_size = 18; // 16 for number, 2 for '0x'
-    uint8_t buf[buf_size];
-    uint8_t len = 0;
-    do {
-        uint8_t v = u & 0xF;   
-        buf[buf_size - ++len] = v < 10 ? '0' + v : 'A' + v - 10;
-        u >>= 4;
-    } while (u > 0);
-    buf[buf_size - ++len] = 'x';
-    buf[buf_size - ++len] = '0';
-    fwrite(&buf[buf_size - len], len, 1, stdout);
+    uint8_t buf[FMT_U64_MAX];
+    __write(buf, __fmt_u64(buf, u));
+}
+void __putu64x(uint64_t x)
+{
+    uint8_t buf[FMT_X64_MAX];
+    __write(buf, __fmt_u64x(buf, x));
 }
 void __puti64(int64_t i)
 {
-    if (i < 0)
+    uint8_t buf[FMT_I64_MAX];
+    __write(buf, __fmt_i64(buf, i));
+}
+void __putf32(float f)
+{
+    uint8_t buf[FMT_F64_MAX];
+    __write(buf, __fmt_f32(buf, f));
+}
+void __putf64(double d)
+{
+    uint8_t buf[FMT_F64_MAX];
+    __write(buf, __fmt_f64(buf, d));
+}
+void __putl() { __write((uint8_t*)"\n", 1); }
+
+////// reading from stdin //////
+#define INBUF_SIZE 65536 // initial size, grows to fit lines longer than this
+// stdin is read in large blocks into a runtime-owned buffer. __getdlv returns a
+// zero-copy view into it (null terminated in place of the delimiter), which stays
+// valid until the next call that reads stdin. Returns -1 at EOF with no data left
+static uint8_t* __inbuf = NULL;
+static uint64_t __incap = 0; // allocated size of __inbuf
+static uint64_t __inpos = 0; // start of unconsumed data
+static uint64_t __inend = 0; // end of valid data
+static uint8_t __ineof = 0;
+
+// compact unconsumed data to the front, grow if needed, and read another block. Returns 0 at EOF
+static uint64_t __infill()
+{
+    if (__ineof) return 0;
+    if (__inpos > 0)
+    {
+        memmove(__inbuf, __inbuf + __inpos, __inend - __inpos);
+        __inend -= __inpos;
+        __inpos = 0;
+    }
+    // always keep one spare byte so that views can be null terminated
+    if (__incap - __inend <= 1)
     {
-        fputc('-', stdout);
-        i = -i;
+        uint64_t cap = __incap == 0 ? INBUF_SIZE : __incap * 2;
+        uint8_t* buf = (uint8_t*)realloc(__inbuf, cap);
+        if (buf == NULL) return 0;
+        __inbuf = buf;
+        __incap = cap;
     }
-    __putu64((uint64_t)i);
+    __flush(); // make sure any prompt is visible before blocking on stdin
+    ssize_t n;
+    do n = read(STDIN_FILENO, __inbuf + __inend, __incap - __inend - 1);
+    while (n < 0 && errno == EINTR);
+    if (n <= 0)
+    {
+        __ineof = 1;
+        return 0;
+    }
+    __inend += n;
+    return n;
 }
-void __putf32(float f) { printf("%f", f); }
-void __putf64(double d) { printf("%f", d); }
-void __putl() { fputc('\n', stdout); }
 
-////// reading from stdin //////
-uint64_t __getl(uint8_t** dst) { return __getdl(dst, '\n'); }
-uint64_t __getdl(uint8_t** dst, uint8_t delimiter)
+uint64_t __getlv(uint8_t** dst) { return __getdlv(dst, '\n'); }
+uint64_t __getdlv(uint8_t** dst, uint8_t delimiter)
 {
-    uint64_t buf_size = 128; // initial buffer size
-    uint64_t count = 0;      // characters read
-    uint64_t c;              // current character
-    uint8_t* buf = (uint8_t*)malloc(buf_size);
-    if (buf == NULL) return -1;
-    while ((c = fgetc(stdin)) != EOF && c != delimiter)
+    uint64_t scanned = 0; // bytes after __inpos already known not to contain the delimiter
+    for (;;)
     {
-        if (count + 1 >= buf_size)
+        uint64_t avail = __inend - __inpos;
+        if (scanned < avail)
         {
-            buf_size *= 2;
-            buf = (uint8_t*)realloc(buf, buf_size);
-            if (buf == NULL) return -1;
+            uint8_t* start = __inbuf + __inpos;
+            uint8_t* hit = (uint8_t*)memchr(start + scanned, delimiter, avail - scanned);
+            if (hit != NULL)
+            {
+                uint64_t len = hit - start;
+                *hit = '\0';
+                *dst = start;
+                __inpos += len + 1;
+                return len;
+            }
+            scanned = avail;
         }
-        buf[count++] = c;
+        if (__infill() == 0) break;
+    }
+
+    // EOF: hand back whatever is left without a trailing delimiter
+    uint64_t len = __inend - __inpos;
+    if (len == 0)
+    {
+        *dst = (uint8_t*)"";
+        return -1;
     }
-    buf[count] = '\0';
+    __inbuf[__inend] = '\0';
+    *dst = __inbuf + __inpos;
+    __inpos = __inend;
+    return len;
+}
+
+// compatibility wrappers returning a heap allocated copy of the line
+uint64_t __getl(uint8_t** dst) { return __getdl(dst, '\n'); }
+uint64_t __getdl(uint8_t** dst, uint8_t delimiter)
+{
+    uint8_t* view;
+    uint64_t len = __getdlv(&view, delimiter);
+    if (len == (uint64_t)-1) len = 0;
+    uint8_t* buf = (uint8_t*)malloc(len + 1);
+    if (buf == NULL) return -1;
+    memcpy(buf, view, len);
+    buf[len] = '\0';
 
     *dst = buf;
-    return count;
+    return len;
 }
 
 void* __malloc(uint64_t size) { return malloc(size); }
 void __free(void* ptr) { free(ptr); }
-void* __realloc(void* ptr, uint64_t size) { return realloc(ptr, size); }
\ No newline at end of file
+void* __realloc(void* ptr, uint64_t size) { return realloc(ptr, size); }
+
+////// files //////
+void* __fopen(uint8_t* path, uint8_t* mode) { return fopen((char*)path, (char*)mode); }
+void __fclose(void* stream) { fclose((FILE*)stream); }
+uint64_t __fread(void* stream, uint8_t* buffer, uint64_t size) { return fread(buffer, 1, size, (FILE*)stream); }
+void __fwrite(void* stream, uint8_t* buffer, uint64_t size) { fwrite(buffer, 1, size, (FILE*)stream); }
+uint64_t __fgetc(void* stream)
+{
+    int c = fgetc((FILE*)stream);
+    return c == EOF ? (uint64_t)-1 : (uint64_t)c;
+}
+void __fputc(void* stream, uint8_t c) { fputc(c, (FILE*)stream); }
+uint64_t __fseek(void* stream, int64_t offset, uint8_t whence)
+{
+    if (fseek((FILE*)stream, offset, whence) != 0) return -1;
+    return ftell((FILE*)stream);
+}
+uint64_t __ftell(void* stream) { return ftell((FILE*)stream); }
+uint64_t __stat(uint8_t* path, uint64_t* size, uint64_t* mtime)
+{
+    struct stat st;
+    if (stat((char*)path, &st) != 0) return 1;
+    if (size) *size = st.st_size;
+    if (mtime) *mtime = (uint64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    return 0;
+}
+uint8_t __unlink(uint8_t* path) { return unlink((char*)path) != 0; }
+uint8_t* __fmap(uint8_t* path, uint64_t* size)
+{
+    int fd = open((char*)path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    *size = st.st_size;
+
+    // empty files can't be mapped, but still get a valid (empty) buffer
+    if (*size == 0)
+    {
+        close(fd);
+        return (uint8_t*)"";
+    }
+    void* ptr = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping stays valid after the descriptor is closed
+    if (ptr == MAP_FAILED) return NULL;
+    madvise(ptr, *size, MADV_SEQUENTIAL);
+    return (uint8_t*)ptr;
+}
+void __funmap(uint8_t* ptr, uint64_t size)
+{
+    if (size > 0) munmap(ptr, size);
+}
+
+// libc's versions are already vectorized (see ../runtime/mem.c for the freestanding ones)
+void __memcpy(uint8_t* dest, uint8_t* src, uint64_t size) { memcpy(dest, src, size); }
+void __memset(uint8_t* dest, uint8_t value, uint64_t size) { memset(dest, value, size); }
+
+// arenas for temporaries with a shared lifetime, built on __malloc/__free (shared with the freestanding runtime)
+#include "../runtime/arena.c"
+
+////// threads //////
+// threads are pthreads. The mutex/condvar in ../runtime/sync.c sit on linux futexes directly
+void __futex_wait(uint32_t* addr, uint32_t expected) { syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0); }
+void __futex_wake(uint32_t* addr, uint32_t count) { syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0); }
+void* __thread_spawn(void* (*fn)(void*), void* arg)
+{
+    pthread_t* thread = (pthread_t*)malloc(sizeof(pthread_t));
+    if (thread == NULL) return NULL;
+    if (pthread_create(thread, NULL, fn, arg) != 0)
+    {
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+void* __thread_join(void* thread)
+{
+    void* result = NULL;
+    pthread_join(*(pthread_t*)thread, &result);
+    free(thread);
+    return result;
+}
+void** __thread_local()
+{
+    static __thread void* slot = NULL;
+    return &slot;
+}
+uint64_t __ncpus()
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (uint64_t)n : 1;
+}
+#include "../runtime/atomic.c"
+#include "../runtime/sync.c"
+#include "../runtime/tasks.c"
+
+////// timing //////
+uint64_t __time()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+uint64_t __cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return __time();
+#endif
+}
+
+void __exit(uint64_t code)
+{
+    __flush();
+    exit((int)code);
+}
+////// dewy values //////
+// the dynamically typed values that qbe.py generates code against
+#include "../runtime/value.c"
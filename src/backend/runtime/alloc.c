@@ -0,0 +1,209 @@
+#ifndef ALLOC_C
+#define ALLOC_C
+
+#include "alloc.h"
+#include "syscall.h"
+
+#define ALLOC_NUM_CLASSES 40
+#define ALLOC_HEADER_SIZE 16 // keeps every block 16-byte aligned
+#define ALLOC_LARGE_CLASS 0xFFFFFFFF
+#define ALLOC_PAGE_SIZE 4096
+
+// header at the start of every slab and large mapping
+typedef struct {
+    uint32_t size_class; // ALLOC_LARGE_CLASS for large mappings
+    uint32_t _pad;
+    uint64_t map_size; // total size of a large mapping (unused for slabs)
+} alloc_header;
+
+// freed blocks store the free list link in their own first bytes
+typedef struct alloc_free_block { struct alloc_free_block* next; } alloc_free_block;
+
+static alloc_free_block* alloc_free_lists[ALLOC_NUM_CLASSES];
+static uint8_t* alloc_bump[ALLOC_NUM_CLASSES];     // next never-used block in the current slab of each class
+static uint8_t* alloc_bump_end[ALLOC_NUM_CLASSES]; // end of the last whole block in that slab
+static uint8_t* alloc_arena = 0;                   // next unused slab in the current arena
+static uint8_t* alloc_arena_end = 0;
+
+// a single spinlock around the whole heap. Critical sections are a few instructions except when mapping memory
+static uint32_t alloc_lock = 0;
+static void alloc_acquire()
+{
+    while (__atomic_exchange_n(&alloc_lock, 1, __ATOMIC_ACQUIRE) != 0)
+        while (__atomic_load_n(&alloc_lock, __ATOMIC_RELAXED) != 0) __builtin_ia32_pause();
+}
+static void alloc_release() { __atomic_store_n(&alloc_lock, 0, __ATOMIC_RELEASE); }
+
+static uint64_t alloc_class_size(uint32_t c)
+{
+    if (c < 8) return (uint64_t)(c + 1) * 16;
+    uint32_t b = 7 + (c - 8) / 4;
+    return ((uint64_t)1 << b) + ((c - 8) % 4 + 1) * ((uint64_t)1 << (b - 2));
+}
+
+static uint32_t alloc_size_class(uint64_t size)
+{
+    if (size <= 128) return size == 0 ? 0 : (size - 1) / 16;
+    uint64_t n = size - 1;
+    uint32_t b = 63 - __builtin_clzll(n);
+    return 8 + (b - 7) * 4 + (uint32_t)(n >> (b - 2)) - 4;
+}
+
+static alloc_header* alloc_header_of(void* ptr) { return (alloc_header*)((uint64_t)ptr & ~(uint64_t)(ALLOC_SLAB_SIZE - 1)); }
+
+// map size bytes (a multiple of the page size) aligned to ALLOC_SLAB_SIZE
+static uint8_t* alloc_map_aligned(uint64_t size)
+{
+    int64_t ret = __syscall6(SYS_mmap, 0, size + ALLOC_SLAB_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (__syscall_failed(ret)) return 0;
+
+    // trim the excess on either side of the aligned region
+    uint64_t start = (uint64_t)ret;
+    uint64_t end = start + size + ALLOC_SLAB_SIZE;
+    uint64_t aligned = (start + ALLOC_SLAB_SIZE - 1) & ~(uint64_t)(ALLOC_SLAB_SIZE - 1);
+    if (aligned > start) __syscall3(SYS_munmap, start, aligned - start, 0);
+    if (end > aligned + size) __syscall3(SYS_munmap, aligned + size, end - (aligned + size), 0);
+    return (uint8_t*)aligned;
+}
+
+static uint8_t alloc_new_slab(uint32_t c)
+{
+    if (alloc_arena == alloc_arena_end)
+    {
+        alloc_arena = alloc_map_aligned(ALLOC_ARENA_SIZE);
+        if (alloc_arena == 0) return 0;
+        alloc_arena_end = alloc_arena + ALLOC_ARENA_SIZE;
+    }
+    uint8_t* slab = alloc_arena;
+    alloc_arena += ALLOC_SLAB_SIZE;
+
+    ((alloc_header*)slab)->size_class = c;
+    uint64_t size = alloc_class_size(c);
+    alloc_bump[c] = slab + ALLOC_HEADER_SIZE;
+    alloc_bump_end[c] = alloc_bump[c] + (ALLOC_SLAB_SIZE - ALLOC_HEADER_SIZE) / size * size;
+    return 1;
+}
+
+static uint64_t alloc_large_map_size(uint64_t size) { return (size + ALLOC_HEADER_SIZE + ALLOC_PAGE_SIZE - 1) & ~(uint64_t)(ALLOC_PAGE_SIZE - 1); }
+
+static void* alloc_large(uint64_t size)
+{
+    if (size > ((uint64_t)1 << 62)) return 0;
+    uint64_t map_size = alloc_large_map_size(size);
+    alloc_header* h = (alloc_header*)alloc_map_aligned(map_size);
+    if (h == 0) return 0;
+    h->size_class = ALLOC_LARGE_CLASS;
+    h->map_size = map_size;
+    return (uint8_t*)h + ALLOC_HEADER_SIZE;
+}
+
+// sizes are always whole class sizes, i.e. multiples of 16
+static void alloc_copy(uint8_t* dst, uint8_t* src, uint64_t len)
+{
+    uint64_t* d = (uint64_t*)dst;
+    uint64_t* s = (uint64_t*)src;
+    for (uint64_t i = 0; i < len / 8; i++) d[i] = s[i];
+}
+
+static void* alloc_malloc(uint64_t size)
+{
+    if (size > ALLOC_SMALL_MAX) return alloc_large(size);
+
+    uint32_t c = alloc_size_class(size);
+    alloc_free_block* block = alloc_free_lists[c];
+    if (block != 0)
+    {
+        alloc_free_lists[c] = block->next;
+        return block;
+    }
+    if (alloc_bump[c] == alloc_bump_end[c] && !alloc_new_slab(c)) return 0;
+    uint8_t* ptr = alloc_bump[c];
+    alloc_bump[c] += alloc_class_size(c);
+    return ptr;
+}
+
+static void alloc_free(void* ptr)
+{
+    if (ptr == 0) return;
+    alloc_header* h = alloc_header_of(ptr);
+    if (h->size_class == ALLOC_LARGE_CLASS)
+    {
+        __syscall3(SYS_munmap, (int64_t)h, h->map_size, 0);
+        return;
+    }
+    alloc_free_block* block = (alloc_free_block*)ptr;
+    block->next = alloc_free_lists[h->size_class];
+    alloc_free_lists[h->size_class] = block;
+}
+
+static void* alloc_realloc(void* ptr, uint64_t size)
+{
+    if (ptr == 0) return alloc_malloc(size);
+    if (size == 0)
+    {
+        alloc_free(ptr);
+        return 0;
+    }
+
+    alloc_header* h = alloc_header_of(ptr);
+    if (h->size_class == ALLOC_LARGE_CLASS)
+    {
+        if (size <= h->map_size - ALLOC_HEADER_SIZE) return ptr;
+        if (size > ((uint64_t)1 << 62)) return 0;
+        uint64_t map_size = alloc_large_map_size(size);
+
+        // grow in place if the address space after the mapping is free
+        int64_t ret = __syscall6(SYS_mremap, (int64_t)h, h->map_size, map_size, 0, 0, 0);
+        if (!__syscall_failed(ret))
+        {
+            h->map_size = map_size;
+            return ptr;
+        }
+
+        // otherwise have the kernel move the pages (no copying) to a new aligned region
+        uint8_t* dst = alloc_map_aligned(map_size);
+        if (dst == 0) return 0;
+        ret = __syscall6(SYS_mremap, (int64_t)h, h->map_size, map_size, MREMAP_MAYMOVE | MREMAP_FIXED, (int64_t)dst, 0);
+        if (__syscall_failed(ret))
+        {
+            __syscall3(SYS_munmap, (int64_t)dst, map_size, 0);
+            return 0;
+        }
+        ((alloc_header*)dst)->map_size = map_size;
+        return dst + ALLOC_HEADER_SIZE;
+    }
+
+    // small blocks can grow in place up to the size of their class
+    uint64_t capacity = alloc_class_size(h->size_class);
+    if (size <= capacity) return ptr;
+    uint8_t* moved = (uint8_t*)alloc_malloc(size);
+    if (moved == 0) return 0;
+    alloc_copy(moved, (uint8_t*)ptr, capacity);
+    alloc_free(ptr);
+    return moved;
+}
+
+void* __malloc(uint64_t size)
+{
+    alloc_acquire();
+    void* ptr = alloc_malloc(size);
+    alloc_release();
+    return ptr;
+}
+
+void __free(void* ptr)
+{
+    alloc_acquire();
+    alloc_free(ptr);
+    alloc_release();
+}
+
+void* __realloc(void* ptr, uint64_t size)
+{
+    alloc_acquire();
+    ptr = alloc_realloc(ptr, size);
+    alloc_release();
+    return ptr;
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef ALLOC_H
+#define ALLOC_H
+
+/* freestanding heap allocator providing __malloc/__free/__realloc without libc */
+/*
+ * Layout:
+ * - memory is reserved from the OS in ALLOC_ARENA_SIZE arenas (one mmap each), which are
+ *   carved into ALLOC_SLAB_SIZE slabs. Each slab serves a single size class, and records
+ *   that class in a small header at its (aligned) start so __free can find it by masking
+ * - there are 40 size classes: multiples of 16 up to 128 bytes, then 4 classes per power
+ *   of two up to ALLOC_SMALL_MAX. Freed blocks go on a per-class free list and are reused first
+ * - requests larger than ALLOC_SMALL_MAX get their own mapping, which is unmapped on __free
+ *   and grown in place with mremap by __realloc when the address space allows it
+ *
+ * Throughput: __malloc/__free on small sizes are O(1) and make no syscalls in the steady
+ * state (a free list pop/push, or a bump within the current slab). Only new arenas and
+ * large allocations go to the kernel.
+ *
+ * Fragmentation: rounding up to a size class wastes at most 15 bytes below 128 bytes and at
+ * most 25% above it. Slabs are never returned to the OS or moved between classes, so the
+ * footprint of each class stays at its peak, and a workload that shifts from one size to
+ * another keeps the old slabs reserved. All blocks are 16-byte aligned.
+ *
+ * Thread-safe via a single global spinlock, so heavy allocation from many threads at once will serialize.
+ */
+
+#include <stdint.h>
+
+#define ALLOC_ARENA_SIZE (8 << 20)
+#define ALLOC_SLAB_SIZE (256 << 10)
+#define ALLOC_SMALL_MAX (32 << 10)
+
+void* __malloc(uint64_t size);
+void __free(void* ptr);
+void* __realloc(void* ptr, uint64_t size);
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef ARENA_C
+#define ARENA_C
+
+#include "arena.h"
+
+void* __malloc(uint64_t size);
+void __free(void* ptr);
+
+#define ARENA_ALIGN 16
+
+typedef struct arena_chunk {
+    struct arena_chunk* next;
+    uint64_t size; // usable bytes after the header
+} arena_chunk;
+
+typedef struct {
+    arena_chunk* chunks; // most recent first. The head is the chunk currently being bumped
+    uint8_t* ptr;
+    uint8_t* end;
+    uint64_t chunk_size;
+    uint64_t used; // bytes handed out since the last reset, including alignment padding
+} arena;
+
+#define ARENA_CHUNK_HEADER ((sizeof(arena_chunk) + ARENA_ALIGN - 1) & ~(uint64_t)(ARENA_ALIGN - 1))
+
+static uint8_t* arena_chunk_data(arena_chunk* chunk) { return (uint8_t*)chunk + ARENA_CHUNK_HEADER; }
+
+static arena_chunk* arena_chunk_new(uint64_t size)
+{
+    arena_chunk* chunk = (arena_chunk*)__malloc(ARENA_CHUNK_HEADER + size);
+    if (chunk == 0) return 0;
+    chunk->next = 0;
+    chunk->size = size;
+    return chunk;
+}
+
+static void arena_free_chunks(arena_chunk* chunk)
+{
+    while (chunk != 0)
+    {
+        arena_chunk* next = chunk->next;
+        __free(chunk);
+        chunk = next;
+    }
+}
+
+void* __arena_new(uint64_t chunk_size)
+{
+    arena* a = (arena*)__malloc(sizeof(arena));
+    if (a == 0) return 0;
+    a->chunk_size = chunk_size == 0 ? ARENA_DEFAULT_CHUNK : chunk_size;
+    a->chunks = arena_chunk_new(a->chunk_size);
+    if (a->chunks == 0)
+    {
+        __free(a);
+        return 0;
+    }
+    a->ptr = arena_chunk_data(a->chunks);
+    a->end = a->ptr + a->chunks->size;
+    a->used = 0;
+    return a;
+}
+
+void* __arena_alloc(void* arena_ptr, uint64_t size)
+{
+    arena* a = (arena*)arena_ptr;
+    size = (size + ARENA_ALIGN - 1) & ~(uint64_t)(ARENA_ALIGN - 1);
+    a->used += size;
+    if (size <= (uint64_t)(a->end - a->ptr))
+    {
+        uint8_t* ptr = a->ptr;
+        a->ptr += size;
+        return ptr;
+    }
+
+    // big requests get a dedicated chunk behind the current one, so its free space isn't wasted
+    if (size > a->chunk_size / 4)
+    {
+        arena_chunk* chunk = arena_chunk_new(size);
+        if (chunk == 0) return 0;
+        chunk->next = a->chunks->next;
+        a->chunks->next = chunk;
+        return arena_chunk_data(chunk);
+    }
+
+    arena_chunk* chunk = arena_chunk_new(a->chunk_size);
+    if (chunk == 0) return 0;
+    chunk->next = a->chunks;
+    a->chunks = chunk;
+    a->ptr = arena_chunk_data(chunk) + size;
+    a->end = arena_chunk_data(chunk) + chunk->size;
+    return arena_chunk_data(chunk);
+}
+
+void __arena_reset(void* arena_ptr)
+{
+    arena* a = (arena*)arena_ptr;
+    if (a->chunks->next != 0)
+    {
+        // replace all the chunks with one that would have fit everything
+        uint64_t size = a->used > a->chunk_size ? a->used : a->chunk_size;
+        arena_chunk* chunk = arena_chunk_new(size);
+        if (chunk != 0)
+        {
+            arena_free_chunks(a->chunks);
+            a->chunks = chunk;
+        }
+        else
+        {
+            // out of memory: just keep the current chunk
+            arena_free_chunks(a->chunks->next);
+            a->chunks->next = 0;
+        }
+    }
+    a->ptr = arena_chunk_data(a->chunks);
+    a->end = a->ptr + a->chunks->size;
+    a->used = 0;
+}
+
+void __arena_free(void* arena_ptr)
+{
+    arena* a = (arena*)arena_ptr;
+    arena_free_chunks(a->chunks);
+    __free(a);
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+/* region allocation for temporaries that all die at the same time (e.g. one loop iteration or one call) */
+/*
+ * __arena_new creates an arena that hands out memory in chunk_size pieces (0 for ARENA_DEFAULT_CHUNK).
+ * __arena_alloc bumps a pointer within the current chunk (16-byte aligned), starting a new chunk when
+ * it runs out. __arena_reset releases everything allocated so far in one step, and __arena_free
+ * releases the arena itself. There is no per-object free.
+ *
+ * Chunks come from __malloc/__free, so this works on top of both libc (shim.c) and the freestanding
+ * allocator (alloc.c). After a reset the arena keeps a single chunk big enough for everything that
+ * was allocated before it, so a loop that allocates the same amount each iteration settles into
+ * zero __malloc calls per iteration.
+ */
+
+#include <stdint.h>
+
+#define ARENA_DEFAULT_CHUNK (64 << 10)
+
+void* __arena_new(uint64_t chunk_size);
+void* __arena_alloc(void* arena, uint64_t size);
+void __arena_reset(void* arena);
+void __arena_free(void* arena);
+
+#endif
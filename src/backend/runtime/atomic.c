@@ -0,0 +1,24 @@
+#ifndef ATOMIC_C
+#define ATOMIC_C
+
+#include "atomic.h"
+
+uint64_t __aloadl(uint64_t* ptr) { return __atomic_load_n(ptr, __ATOMIC_SEQ_CST); }
+void __astorel(uint64_t* ptr, uint64_t value) { __atomic_store_n(ptr, value, __ATOMIC_SEQ_CST); }
+uint64_t __acasl(uint64_t* ptr, uint64_t expected, uint64_t desired)
+{
+    __atomic_compare_exchange_n(ptr, &expected, desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return expected;
+}
+uint64_t __afaddl(uint64_t* ptr, uint64_t value) { return __atomic_fetch_add(ptr, value, __ATOMIC_SEQ_CST); }
+
+uint32_t __aloadw(uint32_t* ptr) { return __atomic_load_n(ptr, __ATOMIC_SEQ_CST); }
+void __astorew(uint32_t* ptr, uint32_t value) { __atomic_store_n(ptr, value, __ATOMIC_SEQ_CST); }
+uint32_t __acasw(uint32_t* ptr, uint32_t expected, uint32_t desired)
+{
+    __atomic_compare_exchange_n(ptr, &expected, desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return expected;
+}
+uint32_t __afaddw(uint32_t* ptr, uint32_t value) { return __atomic_fetch_add(ptr, value, __ATOMIC_SEQ_CST); }
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef ATOMIC_H
+#define ATOMIC_H
+
+/* atomic operations on l (64-bit) and w (32-bit) words, shared by the hosted and freestanding runtimes */
+/* all operations are sequentially consistent. __acas* and __afadd* return the previous value (cas succeeded iff it equals expected) */
+
+#include <stdint.h>
+
+uint64_t __aloadl(uint64_t* ptr);
+void __astorel(uint64_t* ptr, uint64_t value);
+uint64_t __acasl(uint64_t* ptr, uint64_t expected, uint64_t desired);
+uint64_t __afaddl(uint64_t* ptr, uint64_t value);
+
+uint32_t __aloadw(uint32_t* ptr);
+void __astorew(uint32_t* ptr, uint32_t value);
+uint32_t __acasw(uint32_t* ptr, uint32_t expected, uint32_t desired);
+uint32_t __afaddw(uint32_t* ptr, uint32_t value);
+
+#endif
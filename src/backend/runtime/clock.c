@@ -0,0 +1,21 @@
+#ifndef CLOCK_C
+#define CLOCK_C
+
+#include "clock.h"
+#include "syscall.h"
+
+uint64_t __time()
+{
+    int64_t ts[2]; // struct timespec {tv_sec, tv_nsec}
+    __syscall3(SYS_clock_gettime, CLOCK_MONOTONIC, (int64_t)ts, 0);
+    return (uint64_t)ts[0] * 1000000000 + ts[1];
+}
+
+uint64_t __cycles()
+{
+    uint32_t lo, hi;
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+/* timing for the freestanding runtime, with the same ABI as the hosted versions in ../qbe/shim.c */
+
+#include <stdint.h>
+
+uint64_t __time();   // monotonic nanoseconds (clock_gettime syscall, the vDSO isn't available without libc)
+uint64_t __cycles(); // cpu timestamp counter (rdtsc). Not serializing, and ticks at a fixed rate regardless of frequency scaling
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef FILE_C
+#define FILE_C
+
+#include "file.h"
+#include "syscall.h"
+
+// streams are the file descriptor + 1, so that fd 0 isn't confused with NULL
+static int64_t file_fd(void* stream) { return (int64_t)stream - 1; }
+
+// offsets of the fields we need in the x86_64 kernel struct stat (144 bytes)
+#define STAT_SIZE 144
+#define STAT_ST_SIZE 48
+#define STAT_ST_MTIME 88
+
+static uint64_t file_open_flags(uint8_t* mode)
+{
+    uint8_t plus = mode[0] != '\0' && (mode[1] == '+' || (mode[1] != '\0' && mode[2] == '+'));
+    switch (mode[0])
+    {
+        case 'r': return plus ? O_RDWR : O_RDONLY;
+        case 'w': return (plus ? O_RDWR : O_WRONLY) | O_CREAT | O_TRUNC;
+        case 'a': return (plus ? O_RDWR : O_WRONLY) | O_CREAT | O_APPEND;
+        default: return (uint64_t)-1;
+    }
+}
+
+void* __fopen(uint8_t* path, uint8_t* mode)
+{
+    uint64_t flags = file_open_flags(mode);
+    if (flags == (uint64_t)-1) return 0;
+    int64_t fd;
+    do fd = __syscall3(SYS_open, (int64_t)path, flags, 0666);
+    while (fd == -EINTR);
+    if (fd < 0) return 0;
+    return (void*)(fd + 1);
+}
+
+void __fclose(void* stream) { __syscall3(SYS_close, file_fd(stream), 0, 0); }
+
+uint64_t __fread(void* stream, uint8_t* buffer, uint64_t size)
+{
+    // keep reading until size bytes or EOF, since read can return short counts (e.g. on pipes)
+    uint64_t total = 0;
+    while (total < size)
+    {
+        int64_t n = __syscall3(SYS_read, file_fd(stream), (int64_t)(buffer + total), size - total);
+        if (n == -EINTR) continue;
+        if (n <= 0) break;
+        total += n;
+    }
+    return total;
+}
+
+void __fwrite(void* stream, uint8_t* buffer, uint64_t size)
+{
+    while (size > 0)
+    {
+        int64_t n = __syscall3(SYS_write, file_fd(stream), (int64_t)buffer, size);
+        if (n == -EINTR) continue;
+        if (n <= 0) return;
+        buffer += n;
+        size -= n;
+    }
+}
+
+uint64_t __fgetc(void* stream)
+{
+    uint8_t c;
+    return __fread(stream, &c, 1) == 1 ? c : (uint64_t)-1;
+}
+
+void __fputc(void* stream, uint8_t c) { __fwrite(stream, &c, 1); }
+
+uint64_t __fseek(void* stream, int64_t offset, uint8_t whence)
+{
+    int64_t pos = __syscall3(SYS_lseek, file_fd(stream), offset, whence);
+    return pos < 0 ? (uint64_t)-1 : (uint64_t)pos;
+}
+
+uint64_t __ftell(void* stream) { return __fseek(stream, 0, 1); }
+
+uint64_t __stat(uint8_t* path, uint64_t* size, uint64_t* mtime)
+{
+    uint64_t st[STAT_SIZE / 8];
+    int64_t ret = __syscall3(SYS_stat, (int64_t)path, (int64_t)st, 0);
+    if (ret < 0) return 1;
+    if (size) *size = st[STAT_ST_SIZE / 8];
+    if (mtime) *mtime = st[STAT_ST_MTIME / 8] * 1000000000 + st[STAT_ST_MTIME / 8 + 1];
+    return 0;
+}
+
+uint8_t __unlink(uint8_t* path) { return __syscall3(SYS_unlink, (int64_t)path, 0, 0) < 0; }
+
+uint8_t* __fmap(uint8_t* path, uint64_t* size)
+{
+    int64_t fd = __syscall3(SYS_open, (int64_t)path, O_RDONLY, 0);
+    if (fd < 0) return 0;
+    uint64_t st[STAT_SIZE / 8];
+    if (__syscall3(SYS_fstat, fd, (int64_t)st, 0) < 0)
+    {
+        __syscall3(SYS_close, fd, 0, 0);
+        return 0;
+    }
+    *size = st[STAT_ST_SIZE / 8];
+
+    // empty files can't be mapped, but still get a valid (empty) buffer
+    if (*size == 0)
+    {
+        __syscall3(SYS_close, fd, 0, 0);
+        return (uint8_t*)"";
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    int64_t ptr = __syscall6(SYS_mmap, 0, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    __syscall3(SYS_close, fd, 0, 0);
+    return __syscall_failed(ptr) ? 0 : (uint8_t*)ptr;
+}
+
+void __funmap(uint8_t* ptr, uint64_t size)
+{
+    if (size == 0) return;
+    __syscall3(SYS_munmap, (int64_t)ptr, size, 0);
+}
+
+#endif
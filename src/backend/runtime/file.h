@@ -0,0 +1,32 @@
+#ifndef FILE_H
+#define FILE_H
+
+/* file I/O for the freestanding runtime, with the same ABI as the hosted versions in ../qbe/shim.c */
+/*
+ * - streams are opaque pointers returned by __fopen (NULL on failure). mode is one of the fopen
+ *   modes "r", "w", "a", "r+", "w+", "a+" (a trailing 'b' is ignored)
+ * - __fread returns the number of bytes read (0 at EOF), __fgetc returns -1 at EOF
+ * - __fseek returns the new offset (or -1), whence is 0/1/2 for set/current/end
+ * - __stat and __unlink return 0 on success. mtime is in nanoseconds since the unix epoch
+ * - __fmap maps a whole file read-only into memory and writes its length to *size (NULL on failure).
+ *   Release it with __funmap(ptr, size)
+ *
+ * Freestanding streams are unbuffered: every call is a syscall.
+ */
+
+#include <stdint.h>
+
+void* __fopen(uint8_t* path, uint8_t* mode);
+void __fclose(void* stream);
+uint64_t __fread(void* stream, uint8_t* buffer, uint64_t size);
+void __fwrite(void* stream, uint8_t* buffer, uint64_t size);
+uint64_t __fgetc(void* stream);
+void __fputc(void* stream, uint8_t c);
+uint64_t __fseek(void* stream, int64_t offset, uint8_t whence);
+uint64_t __ftell(void* stream);
+uint64_t __stat(uint8_t* path, uint64_t* size, uint64_t* mtime);
+uint8_t __unlink(uint8_t* path);
+uint8_t* __fmap(uint8_t* path, uint64_t* size);
+void __funmap(uint8_t* ptr, uint64_t size);
+
+#endif
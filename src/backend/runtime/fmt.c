@@ -0,0 +1,414 @@
+#ifndef FMT_C
+#define FMT_C
+
+#include "fmt.h"
+
+////// integers //////
+// two digits are produced per division using a lookup table of all pairs "00".."99"
+static const uint8_t fmt_digit_pairs[200] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+static const uint8_t fmt_hex_digits[16] = "0123456789ABCDEF";
+
+static uint64_t fmt_ndigits(uint64_t u)
+{
+    uint64_t n = 1;
+    for (;;)
+    {
+        if (u < 10) return n;
+        if (u < 100) return n + 1;
+        if (u < 1000) return n + 2;
+        if (u < 10000) return n + 3;
+        u /= 10000;
+        n += 4;
+    }
+}
+
+uint64_t __fmt_u64(uint8_t* buf, uint64_t u)
+{
+    uint64_t len = fmt_ndigits(u);
+    uint8_t* p = buf + len;
+    while (u >= 100)
+    {
+        uint64_t r = (u % 100) * 2;
+        u /= 100;
+        *--p = fmt_digit_pairs[r + 1];
+        *--p = fmt_digit_pairs[r];
+    }
+    if (u >= 10)
+    {
+        *--p = fmt_digit_pairs[u * 2 + 1];
+        *--p = fmt_digit_pairs[u * 2];
+    }
+    else *--p = '0' + u;
+    return len;
+}
+
+uint64_t __fmt_i64(uint8_t* buf, int64_t i)
+{
+    if (i >= 0) return __fmt_u64(buf, (uint64_t)i);
+    // negate as unsigned so that INT64_MIN doesn't overflow
+    buf[0] = '-';
+    return 1 + __fmt_u64(buf + 1, (uint64_t)0 - (uint64_t)i);
+}
+
+uint64_t __fmt_u64x(uint8_t* buf, uint64_t x)
+{
+    uint64_t len = 3;
+    for (uint64_t t = x >> 4; t != 0; t >>= 4) len++;
+    buf[0] = '0';
+    buf[1] = 'x';
+    uint8_t* p = buf + len;
+    do {
+        *--p = fmt_hex_digits[x & 0xF];
+        x >>= 4;
+    } while (x != 0);
+    return len;
+}
+
+
+////// floating point //////
+// Grisu2 (Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with Integers", 2010)
+// the output always round-trips, and is the shortest/closest representation in all but ~0.1% of cases
+
+// f * 2^e with a 64-bit significand
+typedef struct { uint64_t f; int32_t e; } fmt_diyfp;
+
+// cached normalized powers of ten 10^k ~= f * 2^e for k = -300, -292, ..., 324
+typedef struct { uint64_t f; int32_t e; int32_t k; } fmt_cached_power;
+#define FMT_CACHED_POWERS_MIN_K -300
+#define FMT_CACHED_POWERS_STEP 8
+static const fmt_cached_power fmt_cached_powers[79] = {
+    {0xAB70FE17C79AC6CA, -1060, -300},
+    {0xFF77B1FCBEBCDC4F, -1034, -292},
+    {0xBE5691EF416BD60C, -1007, -284},
+    {0x8DD01FAD907FFC3C, -980, -276},
+    {0xD3515C2831559A83, -954, -268},
+    {0x9D71AC8FADA6C9B5, -927, -260},
+    {0xEA9C227723EE8BCB, -901, -252},
+    {0xAECC49914078536D, -874, -244},
+    {0x823C12795DB6CE57, -847, -236},
+    {0xC21094364DFB5637, -821, -228},
+    {0x9096EA6F3848984F, -794, -220},
+    {0xD77485CB25823AC7, -768, -212},
+    {0xA086CFCD97BF97F4, -741, -204},
+    {0xEF340A98172AACE5, -715, -196},
+    {0xB23867FB2A35B28E, -688, -188},
+    {0x84C8D4DFD2C63F3B, -661, -180},
+    {0xC5DD44271AD3CDBA, -635, -172},
+    {0x936B9FCEBB25C996, -608, -164},
+    {0xDBAC6C247D62A584, -582, -156},
+    {0xA3AB66580D5FDAF6, -555, -148},
+    {0xF3E2F893DEC3F126, -529, -140},
+    {0xB5B5ADA8AAFF80B8, -502, -132},
+    {0x87625F056C7C4A8B, -475, -124},
+    {0xC9BCFF6034C13053, -449, -116},
+    {0x964E858C91BA2655, -422, -108},
+    {0xDFF9772470297EBD, -396, -100},
+    {0xA6DFBD9FB8E5B88F, -369, -92},
+    {0xF8A95FCF88747D94, -343, -84},
+    {0xB94470938FA89BCF, -316, -76},
+    {0x8A08F0F8BF0F156B, -289, -68},
+    {0xCDB02555653131B6, -263, -60},
+    {0x993FE2C6D07B7FAC, -236, -52},
+    {0xE45C10C42A2B3B06, -210, -44},
+    {0xAA242499697392D3, -183, -36},
+    {0xFD87B5F28300CA0E, -157, -28},
+    {0xBCE5086492111AEB, -130, -20},
+    {0x8CBCCC096F5088CC, -103, -12},
+    {0xD1B71758E219652C, -77, -4},
+    {0x9C40000000000000, -50, 4},
+    {0xE8D4A51000000000, -24, 12},
+    {0xAD78EBC5AC620000, 3, 20},
+    {0x813F3978F8940984, 30, 28},
+    {0xC097CE7BC90715B3, 56, 36},
+    {0x8F7E32CE7BEA5C70, 83, 44},
+    {0xD5D238A4ABE98068, 109, 52},
+    {0x9F4F2726179A2245, 136, 60},
+    {0xED63A231D4C4FB27, 162, 68},
+    {0xB0DE65388CC8ADA8, 189, 76},
+    {0x83C7088E1AAB65DB, 216, 84},
+    {0xC45D1DF942711D9A, 242, 92},
+    {0x924D692CA61BE758, 269, 100},
+    {0xDA01EE641A708DEA, 295, 108},
+    {0xA26DA3999AEF774A, 322, 116},
+    {0xF209787BB47D6B85, 348, 124},
+    {0xB454E4A179DD1877, 375, 132},
+    {0x865B86925B9BC5C2, 402, 140},
+    {0xC83553C5C8965D3D, 428, 148},
+    {0x952AB45CFA97A0B3, 455, 156},
+    {0xDE469FBD99A05FE3, 481, 164},
+    {0xA59BC234DB398C25, 508, 172},
+    {0xF6C69A72A3989F5C, 534, 180},
+    {0xB7DCBF5354E9BECE, 561, 188},
+    {0x88FCF317F22241E2, 588, 196},
+    {0xCC20CE9BD35C78A5, 614, 204},
+    {0x98165AF37B2153DF, 641, 212},
+    {0xE2A0B5DC971F303A, 667, 220},
+    {0xA8D9D1535CE3B396, 694, 228},
+    {0xFB9B7CD9A4A7443C, 720, 236},
+    {0xBB764C4CA7A44410, 747, 244},
+    {0x8BAB8EEFB6409C1A, 774, 252},
+    {0xD01FEF10A657842C, 800, 260},
+    {0x9B10A4E5E9913129, 827, 268},
+    {0xE7109BFBA19C0C9D, 853, 276},
+    {0xAC2820D9623BF429, 880, 284},
+    {0x80444B5E7AA7CF85, 907, 292},
+    {0xBF21E44003ACDD2D, 933, 300},
+    {0x8E679C2F5E44FF8F, 960, 308},
+    {0xD433179D9C8CB841, 986, 316},
+    {0x9E19DB92B4E31BA9, 1013, 324},
+};
+
+// range for the binary exponent of products with the cached power, so that the integral part fits in 32 bits
+#define FMT_ALPHA -60
+#define FMT_GAMMA -32
+
+static fmt_diyfp fmt_diyfp_sub(fmt_diyfp x, fmt_diyfp y) { return (fmt_diyfp){x.f - y.f, x.e}; }
+
+// upper 64 bits of the 128-bit product (rounded), i.e. x * y with the exponent adjusted
+static fmt_diyfp fmt_diyfp_mul(fmt_diyfp x, fmt_diyfp y)
+{
+    uint64_t x_lo = x.f & 0xFFFFFFFF, x_hi = x.f >> 32;
+    uint64_t y_lo = y.f & 0xFFFFFFFF, y_hi = y.f >> 32;
+    uint64_t p0 = x_lo * y_lo, p1 = x_lo * y_hi, p2 = x_hi * y_lo, p3 = x_hi * y_hi;
+    uint64_t mid = (p0 >> 32) + (p1 & 0xFFFFFFFF) + (p2 & 0xFFFFFFFF) + ((uint64_t)1 << 31);
+    uint64_t h = p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32);
+    return (fmt_diyfp){h, x.e + y.e + 64};
+}
+
+static fmt_diyfp fmt_diyfp_normalize(fmt_diyfp x)
+{
+    while ((x.f >> 63) == 0)
+    {
+        x.f <<= 1;
+        x.e--;
+    }
+    return x;
+}
+
+static fmt_diyfp fmt_diyfp_normalize_to(fmt_diyfp x, int32_t e) { return (fmt_diyfp){x.f << (x.e - e), e}; }
+
+// normalized value w, and the boundaries m- and m+ halfway to its neighbors (all sharing the exponent of m+)
+// bits/mantissa_bits/bias describe the IEEE layout so that f32 gets its own (wider) boundaries
+static void fmt_compute_boundaries(uint64_t bits, int32_t mantissa_bits, int32_t bias, fmt_diyfp* w, fmt_diyfp* m_minus, fmt_diyfp* m_plus)
+{
+    uint64_t hidden = (uint64_t)1 << mantissa_bits;
+    uint64_t F = bits & (hidden - 1);
+    int32_t E = (int32_t)(bits >> mantissa_bits);
+    fmt_diyfp v = E == 0 ? (fmt_diyfp){F, 1 - bias} : (fmt_diyfp){F + hidden, E - bias};
+
+    // the gap below is half as large for exact powers of two (except the smallest normal)
+    uint8_t lower_closer = F == 0 && E > 1;
+    fmt_diyfp plus = {2 * v.f + 1, v.e - 1};
+    fmt_diyfp minus = lower_closer ? (fmt_diyfp){4 * v.f - 1, v.e - 2} : (fmt_diyfp){2 * v.f - 1, v.e - 1};
+
+    *m_plus = fmt_diyfp_normalize(plus);
+    *m_minus = fmt_diyfp_normalize_to(minus, m_plus->e);
+    *w = fmt_diyfp_normalize_to(v, m_plus->e);
+}
+
+// cached power c = 10^-k such that the exponent of (c * 2^e) lands in [FMT_ALPHA, FMT_GAMMA]
+static fmt_cached_power fmt_get_cached_power(int32_t e)
+{
+    int32_t f = FMT_ALPHA - e - 1;
+    int32_t k = (f * 78913) / (1 << 18) + (f > 0); // ceil(f * log10(2))
+    int32_t index = (-FMT_CACHED_POWERS_MIN_K + k + (FMT_CACHED_POWERS_STEP - 1)) / FMT_CACHED_POWERS_STEP;
+    return fmt_cached_powers[index];
+}
+
+// largest power of ten <= n (n < 10^10), and its number of digits
+static uint32_t fmt_largest_pow10(uint32_t n, uint32_t* pow10)
+{
+    if (n >= 1000000000) { *pow10 = 1000000000; return 10; }
+    if (n >= 100000000) { *pow10 = 100000000; return 9; }
+    if (n >= 10000000) { *pow10 = 10000000; return 8; }
+    if (n >= 1000000) { *pow10 = 1000000; return 7; }
+    if (n >= 100000) { *pow10 = 100000; return 6; }
+    if (n >= 10000) { *pow10 = 10000; return 5; }
+    if (n >= 1000) { *pow10 = 1000; return 4; }
+    if (n >= 100) { *pow10 = 100; return 3; }
+    if (n >= 10) { *pow10 = 10; return 2; }
+    *pow10 = 1;
+    return 1;
+}
+
+// nudge the last digit towards w while staying inside the rounding interval
+static void fmt_grisu2_round(uint8_t* digits, uint64_t len, uint64_t dist, uint64_t delta, uint64_t rest, uint64_t ten_k)
+{
+    while (rest < dist && delta - rest >= ten_k && (rest + ten_k < dist || dist - rest > rest + ten_k - dist))
+    {
+        digits[len - 1]--;
+        rest += ten_k;
+    }
+}
+
+// generate the digits of the shortest number in (M-, M+). value = digits * 10^decimal_exponent
+static uint64_t fmt_grisu2_digits(uint8_t* digits, int32_t* decimal_exponent, fmt_diyfp M_minus, fmt_diyfp w, fmt_diyfp M_plus)
+{
+    uint64_t delta = fmt_diyfp_sub(M_plus, M_minus).f;
+    uint64_t dist = fmt_diyfp_sub(M_plus, w).f;
+    int32_t shift = -M_plus.e;
+    uint64_t one = (uint64_t)1 << shift;
+    uint32_t p1 = (uint32_t)(M_plus.f >> shift); // integral part
+    uint64_t p2 = M_plus.f & (one - 1);          // fractional part
+    uint64_t len = 0;
+
+    uint32_t pow10;
+    uint32_t n = fmt_largest_pow10(p1, &pow10);
+    while (n > 0)
+    {
+        digits[len++] = '0' + p1 / pow10;
+        p1 %= pow10;
+        n--;
+        uint64_t rest = ((uint64_t)p1 << shift) + p2;
+        if (rest <= delta)
+        {
+            *decimal_exponent += n;
+            fmt_grisu2_round(digits, len, dist, delta, rest, (uint64_t)pow10 << shift);
+            return len;
+        }
+        pow10 /= 10;
+    }
+
+    int32_t m = 0;
+    for (;;)
+    {
+        p2 *= 10;
+        digits[len++] = '0' + (p2 >> shift);
+        p2 &= one - 1;
+        m++;
+        delta *= 10;
+        dist *= 10;
+        if (p2 <= delta) break;
+    }
+    *decimal_exponent -= m;
+    fmt_grisu2_round(digits, len, dist, delta, p2, one);
+    return len;
+}
+
+static uint64_t fmt_grisu2(uint8_t* digits, int32_t* decimal_exponent, uint64_t bits, int32_t mantissa_bits, int32_t bias)
+{
+    fmt_diyfp v, m_minus, m_plus;
+    fmt_compute_boundaries(bits, mantissa_bits, bias, &v, &m_minus, &m_plus);
+
+    fmt_cached_power cached = fmt_get_cached_power(m_plus.e);
+    fmt_diyfp c = {cached.f, cached.e};
+    fmt_diyfp w = fmt_diyfp_mul(v, c);
+    fmt_diyfp w_minus = fmt_diyfp_mul(m_minus, c);
+    fmt_diyfp w_plus = fmt_diyfp_mul(m_plus, c);
+
+    // shrink the interval by 1 ulp on either side to account for the error of the multiplication
+    fmt_diyfp M_minus = {w_minus.f + 1, w_minus.e};
+    fmt_diyfp M_plus = {w_plus.f - 1, w_plus.e};
+    *decimal_exponent = -cached.k;
+    return fmt_grisu2_digits(digits, decimal_exponent, M_minus, w, M_plus);
+}
+
+static uint64_t fmt_copy(uint8_t* dst, const char* src)
+{
+    uint64_t len = 0;
+    while (src[len] != '\0')
+    {
+        dst[len] = src[len];
+        len++;
+    }
+    return len;
+}
+
+// lay out digits * 10^decimal_exponent the same way python's float repr does
+static uint64_t fmt_layout(uint8_t* buf, uint8_t* digits, uint64_t len, int32_t decimal_exponent)
+{
+    int32_t point = (int32_t)len + decimal_exponent; // digits before the decimal point
+    int32_t exp10 = point - 1;
+    uint64_t i = 0;
+
+    if (exp10 >= -4 && exp10 < 16)
+    {
+        if (point <= 0)
+        {
+            // 0.000ddd
+            buf[i++] = '0';
+            buf[i++] = '.';
+            for (int32_t z = 0; z < -point; z++) buf[i++] = '0';
+            for (uint64_t d = 0; d < len; d++) buf[i++] = digits[d];
+        }
+        else if ((uint64_t)point < len)
+        {
+            // ddd.ddd
+            for (uint64_t d = 0; d < (uint64_t)point; d++) buf[i++] = digits[d];
+            buf[i++] = '.';
+            for (uint64_t d = point; d < len; d++) buf[i++] = digits[d];
+        }
+        else
+        {
+            // ddd000.0
+            for (uint64_t d = 0; d < len; d++) buf[i++] = digits[d];
+            for (uint64_t z = len; z < (uint64_t)point; z++) buf[i++] = '0';
+            buf[i++] = '.';
+            buf[i++] = '0';
+        }
+        return i;
+    }
+
+    // d.ddde+XX
+    buf[i++] = digits[0];
+    if (len > 1)
+    {
+        buf[i++] = '.';
+        for (uint64_t d = 1; d < len; d++) buf[i++] = digits[d];
+    }
+    buf[i++] = 'e';
+    buf[i++] = exp10 < 0 ? '-' : '+';
+    uint32_t e = exp10 < 0 ? -exp10 : exp10;
+    if (e >= 100)
+    {
+        buf[i++] = '0' + e / 100;
+        e %= 100;
+    }
+    buf[i++] = fmt_digit_pairs[e * 2];
+    buf[i++] = fmt_digit_pairs[e * 2 + 1];
+    return i;
+}
+
+// shared by f32 and f64, given the raw bits and IEEE layout
+static uint64_t fmt_float(uint8_t* buf, uint64_t bits, int32_t mantissa_bits, int32_t exponent_bits)
+{
+    uint64_t i = 0;
+    uint64_t magnitude = bits & (((uint64_t)1 << (mantissa_bits + exponent_bits)) - 1);
+    uint64_t exponent_max = ((uint64_t)1 << exponent_bits) - 1;
+    int32_t bias = (1 << (exponent_bits - 1)) - 1 + mantissa_bits;
+
+    if ((magnitude >> mantissa_bits) == exponent_max && (magnitude & (((uint64_t)1 << mantissa_bits) - 1)) != 0)
+        return fmt_copy(buf, "nan");
+    if (magnitude != bits) buf[i++] = '-';
+    if ((magnitude >> mantissa_bits) == exponent_max) return i + fmt_copy(buf + i, "inf");
+    if (magnitude == 0) return i + fmt_copy(buf + i, "0.0");
+
+    uint8_t digits[20];
+    int32_t decimal_exponent;
+    uint64_t len = fmt_grisu2(digits, &decimal_exponent, magnitude, mantissa_bits, bias);
+    return i + fmt_layout(buf + i, digits, len, decimal_exponent);
+}
+
+uint64_t __fmt_f64(uint8_t* buf, double d)
+{
+    union { double d; uint64_t u; } bits = {.d = d};
+    return fmt_float(buf, bits.u, 52, 11);
+}
+
+uint64_t __fmt_f32(uint8_t* buf, float f)
+{
+    union { float f; uint32_t u; } bits = {.f = f};
+    return fmt_float(buf, bits.u, 23, 8);
+}
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef FMT_H
+#define FMT_H
+
+/* libc-free number formatting shared by the hosted (shim.c, metal.c) and freestanding (metal.qbe) runtimes */
+/* each __fmt_* function writes into buf (which must hold at least FMT_*_MAX bytes) and returns the number of bytes written */
+
+#include <stdint.h>
+
+#define FMT_U64_MAX 20 // 18446744073709551615
+#define FMT_I64_MAX 20 // -9223372036854775808
+#define FMT_X64_MAX 18 // 0xFFFFFFFFFFFFFFFF
+#define FMT_F64_MAX 32 // -2.2250738585072014e-308 (24) rounded up
+
+uint64_t __fmt_u64(uint8_t* buf, uint64_t u);
+uint64_t __fmt_i64(uint8_t* buf, int64_t i);
+uint64_t __fmt_u64x(uint8_t* buf, uint64_t x);
+
+// floats are printed with the shortest digits that round-trip (Grisu2), in the same layout as python's repr:
+// fixed notation for decimal exponents in [-4, 16), otherwise scientific (e.g. 1e+16, 1.5e-07), plus nan/inf
+uint64_t __fmt_f64(uint8_t* buf, double d);
+uint64_t __fmt_f32(uint8_t* buf, float f);
+
+#endif
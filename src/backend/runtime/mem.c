@@ -0,0 +1,62 @@
+#ifndef MEM_C
+#define MEM_C
+
+#include "mem.h"
+
+// 8-byte accesses at any alignment (fine on x86_64, and tells the compiler not to assume alignment)
+typedef uint64_t __attribute__((may_alias, aligned(1))) mem_word;
+
+// copy whole words 4 at a time, then the remaining words, then the tail bytes
+void __memcpy(uint8_t* dest, uint8_t* src, uint64_t size)
+{
+    while (size >= 32)
+    {
+        mem_word a = ((mem_word*)src)[0], b = ((mem_word*)src)[1], c = ((mem_word*)src)[2], d = ((mem_word*)src)[3];
+        ((mem_word*)dest)[0] = a;
+        ((mem_word*)dest)[1] = b;
+        ((mem_word*)dest)[2] = c;
+        ((mem_word*)dest)[3] = d;
+        dest += 32;
+        src += 32;
+        size -= 32;
+    }
+    while (size >= 8)
+    {
+        *(mem_word*)dest = *(mem_word*)src;
+        dest += 8;
+        src += 8;
+        size -= 8;
+    }
+    while (size > 0)
+    {
+        *dest++ = *src++;
+        size--;
+    }
+}
+
+void __memset(uint8_t* dest, uint8_t value, uint64_t size)
+{
+    uint64_t word = value * (uint64_t)0x0101010101010101;
+    while (size >= 32)
+    {
+        ((mem_word*)dest)[0] = word;
+        ((mem_word*)dest)[1] = word;
+        ((mem_word*)dest)[2] = word;
+        ((mem_word*)dest)[3] = word;
+        dest += 32;
+        size -= 32;
+    }
+    while (size >= 8)
+    {
+        *(mem_word*)dest = word;
+        dest += 8;
+        size -= 8;
+    }
+    while (size > 0)
+    {
+        *dest++ = value;
+        size--;
+    }
+}
+
+#endif
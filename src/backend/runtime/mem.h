@@ -0,0 +1,11 @@
+#ifndef MEM_H
+#define MEM_H
+
+/* libc-free memory primitives for the freestanding runtime (the hosted shim forwards to libc) */
+
+#include <stdint.h>
+
+void __memcpy(uint8_t* dest, uint8_t* src, uint64_t size);
+void __memset(uint8_t* dest, uint8_t value, uint64_t size);
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef SYNC_C
+#define SYNC_C
+
+#include "sync.h"
+
+#define MUTEX_UNLOCKED 0
+#define MUTEX_LOCKED 1
+#define MUTEX_CONTENDED 2 // locked, and there may be threads sleeping on it
+
+static void mutex_lock_contended(uint32_t* mutex)
+{
+    // once anyone has slept on the mutex, keep it marked contended so unlock knows to wake
+    while (__atomic_exchange_n(mutex, MUTEX_CONTENDED, __ATOMIC_ACQUIRE) != MUTEX_UNLOCKED)
+        __futex_wait(mutex, MUTEX_CONTENDED);
+}
+
+void __mutex_lock(uint32_t* mutex)
+{
+    uint32_t expected = MUTEX_UNLOCKED;
+    if (__atomic_compare_exchange_n(mutex, &expected, MUTEX_LOCKED, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) return;
+    mutex_lock_contended(mutex);
+}
+
+uint8_t __mutex_trylock(uint32_t* mutex)
+{
+    uint32_t expected = MUTEX_UNLOCKED;
+    return __atomic_compare_exchange_n(mutex, &expected, MUTEX_LOCKED, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+void __mutex_unlock(uint32_t* mutex)
+{
+    if (__atomic_exchange_n(mutex, MUTEX_UNLOCKED, __ATOMIC_RELEASE) == MUTEX_CONTENDED) __futex_wake(mutex, 1);
+}
+
+void __cond_wait(uint32_t* cond, uint32_t* mutex)
+{
+    uint32_t seq = __atomic_load_n(cond, __ATOMIC_RELAXED);
+    __mutex_unlock(mutex);
+    __futex_wait(cond, seq);
+    mutex_lock_contended(mutex);
+}
+
+void __cond_signal(uint32_t* cond)
+{
+    __atomic_fetch_add(cond, 1, __ATOMIC_RELEASE);
+    __futex_wake(cond, 1);
+}
+
+void __cond_broadcast(uint32_t* cond)
+{
+    __atomic_fetch_add(cond, 1, __ATOMIC_RELEASE);
+    __futex_wake(cond, 0x7FFFFFFF);
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef SYNC_H
+#define SYNC_H
+
+/* futex based mutex and condition variable, shared by the hosted and freestanding runtimes */
+/*
+ * Both are a single zero-initialized w (uint32_t), so compiled code can embed them anywhere.
+ * The mutex is the three-state (unlocked, locked, locked with waiters) design from Drepper's
+ * "Futexes Are Tricky", so uncontended lock/unlock never enter the kernel. The condition
+ * variable is a sequence number that waiters sleep on; spurious wakeups are possible, so
+ * __cond_wait should be called in a loop that rechecks the condition.
+ *
+ * The runtime including this provides __futex_wait/__futex_wake (shim.c, metal.c, thread.c).
+ */
+
+#include <stdint.h>
+
+// sleep while *addr == expected (may return spuriously), and wake up to count sleepers on addr
+void __futex_wait(uint32_t* addr, uint32_t expected);
+void __futex_wake(uint32_t* addr, uint32_t count);
+
+void __mutex_lock(uint32_t* mutex);
+uint8_t __mutex_trylock(uint32_t* mutex); // 1 if the lock was acquired
+void __mutex_unlock(uint32_t* mutex);
+
+void __cond_wait(uint32_t* cond, uint32_t* mutex);
+void __cond_signal(uint32_t* cond);
+void __cond_broadcast(uint32_t* cond);
+
+#endif
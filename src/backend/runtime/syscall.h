@@ -0,0 +1,74 @@
+#ifndef SYSCALL_H
+#define SYSCALL_H
+
+/* raw linux syscalls for the freestanding runtime (x86_64 only, matching ../qbe/freestanding/syscalls.x86_64) */
+/* return values follow the kernel convention: -errno on failure */
+
+#include <stdint.h>
+
+#define SYS_read 0
+#define SYS_write 1
+#define SYS_open 2
+#define SYS_close 3
+#define SYS_stat 4
+#define SYS_fstat 5
+#define SYS_lseek 8
+#define SYS_mmap 9
+#define SYS_mprotect 10
+#define SYS_munmap 11
+#define SYS_mremap 25
+#define SYS_clone 56
+#define SYS_exit 60
+#define SYS_unlink 87
+#define SYS_arch_prctl 158
+#define SYS_futex 202
+#define SYS_sched_getaffinity 204
+#define SYS_clock_gettime 228
+
+#define O_RDONLY 0
+#define O_WRONLY 1
+#define O_RDWR 2
+#define O_CREAT 0100
+#define O_TRUNC 01000
+#define O_APPEND 02000
+
+#define PROT_NONE 0x0
+#define PROT_READ 0x1
+#define PROT_WRITE 0x2
+#define MAP_SHARED 0x01
+#define MAP_PRIVATE 0x02
+#define MAP_ANONYMOUS 0x20
+#define MREMAP_MAYMOVE 1
+#define MREMAP_FIXED 2
+#define CLOCK_MONOTONIC 1
+#define FUTEX_WAIT 0
+#define FUTEX_WAIT_PRIVATE 128
+#define FUTEX_WAKE_PRIVATE 129
+#define CLONE_VM 0x100
+#define CLONE_FS 0x200
+#define CLONE_FILES 0x400
+#define CLONE_SIGHAND 0x800
+#define CLONE_THREAD 0x10000
+#define CLONE_SYSVSEM 0x40000
+#define CLONE_SETTLS 0x80000
+#define CLONE_PARENT_SETTID 0x100000
+#define CLONE_CHILD_CLEARTID 0x200000
+#define ARCH_SET_FS 0x1002
+
+static inline int64_t __syscall6(int64_t n, int64_t a, int64_t b, int64_t c, int64_t d, int64_t e, int64_t f)
+{
+    int64_t ret;
+    register int64_t r10 asm("r10") = d;
+    register int64_t r8 asm("r8") = e;
+    register int64_t r9 asm("r9") = f;
+    asm volatile("syscall" : "=a"(ret) : "a"(n), "D"(a), "S"(b), "d"(c), "r"(r10), "r"(r8), "r"(r9) : "rcx", "r11", "memory");
+    return ret;
+}
+static inline int64_t __syscall3(int64_t n, int64_t a, int64_t b, int64_t c) { return __syscall6(n, a, b, c, 0, 0, 0); }
+
+#define EINTR 4
+
+// errors are returned as -4095..-1, which also applies to syscalls that return pointers (mmap)
+static inline uint8_t __syscall_failed(int64_t ret) { return (uint64_t)ret > (uint64_t)-4096; }
+
+#endif
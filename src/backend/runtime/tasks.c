@@ -0,0 +1,330 @@
+#ifndef TASKS_C
+#define TASKS_C
+
+#include "tasks.h"
+#include "sync.h"
+#include "thread.h"
+
+void* __malloc(uint64_t size);
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TASKS_PAUSE() __builtin_ia32_pause()
+#else
+#define TASKS_PAUSE()
+#endif
+#define TASKS_SPINS 2048 // failed attempts to find work before going to sleep
+
+// a group counts the tasks spawned by one task (or one __par_for) that haven't finished yet.
+// The top bit is set while the owner sleeps in tasks_wait, so the last task to finish knows to wake it
+#define TASKS_WAITING 0x80000000u
+#define TASKS_PENDING 0x7FFFFFFFu
+typedef struct {
+    uint32_t state;
+} tasks_group;
+
+#define TASKS_KIND_SPAWN 0
+#define TASKS_KIND_RANGE 1
+typedef struct {
+    uint64_t kind;
+    void* fn;
+    void* ctx;
+    int64_t lo, hi, grain; // TASKS_KIND_RANGE only
+    tasks_group* parent;   // group to notify when this task finishes
+} tasks_task;
+
+#define TASKS_ALIGN 64 // cache line size
+typedef struct {
+    int64_t top __attribute__((aligned(TASKS_ALIGN)));    // thieves take from here
+    int64_t bottom __attribute__((aligned(TASKS_ALIGN))); // the owner pushes and pops here
+    tasks_task buffer[TASKS_DEQUE_SIZE];
+    tasks_group* group; // group that tasks spawned on this worker are added to
+    tasks_group root;   // group for spawns made outside of any task
+    uint64_t rng;       // for picking steal victims
+    uint64_t index;
+} tasks_worker;
+
+static tasks_worker* tasks_workers[TASKS_MAX_WORKERS];
+static uint64_t tasks_nworkers = 0;
+static uint64_t tasks_requested = 0; // from __sched_init
+static uint8_t tasks_ready = 0;
+static uint32_t tasks_init_lock = 0;
+
+// idle workers sleep on tasks_epoch, and __spawn bumps it when tasks_sleepers is nonzero
+static uint32_t tasks_epoch = 0;
+static uint32_t tasks_sleepers = 0;
+
+static void tasks_copy(tasks_task* dst, tasks_task* src)
+{
+    dst->kind = src->kind;
+    dst->fn = src->fn;
+    dst->ctx = src->ctx;
+    dst->lo = src->lo;
+    dst->hi = src->hi;
+    dst->grain = src->grain;
+    dst->parent = src->parent;
+}
+
+
+////// Chase-Lev deque (Le, Pop, Cohen, Nardelli, "Correct and Efficient Work-Stealing for Weak Memory Models", 2013) //////
+static uint8_t tasks_deque_push(tasks_worker* w, tasks_task* task)
+{
+    int64_t b = __atomic_load_n(&w->bottom, __ATOMIC_RELAXED);
+    int64_t t = __atomic_load_n(&w->top, __ATOMIC_ACQUIRE);
+    if (b - t >= TASKS_DEQUE_SIZE) return 0;
+    tasks_copy(&w->buffer[b & (TASKS_DEQUE_SIZE - 1)], task);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELAXED);
+    return 1;
+}
+
+static uint8_t tasks_deque_pop(tasks_worker* w, tasks_task* task)
+{
+    int64_t b = __atomic_load_n(&w->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&w->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t t = __atomic_load_n(&w->top, __ATOMIC_RELAXED);
+    if (t > b)
+    {
+        // empty
+        __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    tasks_copy(task, &w->buffer[b & (TASKS_DEQUE_SIZE - 1)]);
+    if (t < b) return 1;
+
+    // last task: race any thieves for it
+    uint8_t won = __atomic_compare_exchange_n(&w->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+    __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELAXED);
+    return won;
+}
+
+static uint8_t tasks_deque_steal(tasks_worker* w, tasks_task* task)
+{
+    int64_t t = __atomic_load_n(&w->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t b = __atomic_load_n(&w->bottom, __ATOMIC_ACQUIRE);
+    if (t >= b) return 0;
+    // the slot can't be reused until top moves past it, so the copy is only kept if the cas succeeds
+    tasks_copy(task, &w->buffer[t & (TASKS_DEQUE_SIZE - 1)]);
+    return __atomic_compare_exchange_n(&w->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+
+////// scheduling //////
+static void tasks_run(tasks_worker* w, tasks_task* task);
+
+// own deque first (most recently pushed, so likely still in cache), then steal from random victims
+static uint8_t tasks_find(tasks_worker* w, tasks_task* task)
+{
+    if (tasks_deque_pop(w, task)) return 1;
+    for (uint64_t i = 0; i < tasks_nworkers; i++)
+    {
+        w->rng ^= w->rng << 13;
+        w->rng ^= w->rng >> 7;
+        w->rng ^= w->rng << 17;
+        tasks_worker* victim = tasks_workers[w->rng % tasks_nworkers];
+        if (victim != w && tasks_deque_steal(victim, task)) return 1;
+    }
+    return 0;
+}
+
+static void tasks_notify()
+{
+    // pairs with the increment of tasks_sleepers in tasks_worker_main: either the sleeper sees the new task, or we see the sleeper
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&tasks_sleepers, __ATOMIC_RELAXED) == 0) return;
+    __atomic_fetch_add(&tasks_epoch, 1, __ATOMIC_RELEASE);
+    __futex_wake(&tasks_epoch, 1);
+}
+
+static void tasks_push(tasks_worker* w, tasks_task* task)
+{
+    __atomic_fetch_add(&task->parent->state, 1, __ATOMIC_RELAXED);
+    if (!tasks_deque_push(w, task))
+    {
+        // deque is full: there's plenty of parallelism already
+        tasks_run(w, task);
+        return;
+    }
+    tasks_notify();
+}
+
+static void tasks_finish(tasks_group* group)
+{
+    uint32_t prev = __atomic_fetch_sub(&group->state, 1, __ATOMIC_ACQ_REL);
+    if ((prev & TASKS_PENDING) == 1 && (prev & TASKS_WAITING)) __futex_wake(&group->state, 1);
+}
+
+// wait for every task in the group to finish, running other tasks in the meantime
+static void tasks_wait(tasks_worker* w, tasks_group* group)
+{
+    tasks_task task;
+    uint32_t spins = 0;
+    while ((__atomic_load_n(&group->state, __ATOMIC_ACQUIRE) & TASKS_PENDING) != 0)
+    {
+        if (tasks_find(w, &task))
+        {
+            tasks_run(w, &task);
+            spins = 0;
+            continue;
+        }
+        if (++spins < TASKS_SPINS)
+        {
+            TASKS_PAUSE();
+            continue;
+        }
+
+        // nothing left to help with: the remaining tasks are running elsewhere, so sleep until the last one finishes
+        uint32_t state = __atomic_fetch_or(&group->state, TASKS_WAITING, __ATOMIC_ACQ_REL) | TASKS_WAITING;
+        if ((state & TASKS_PENDING) != 0) __futex_wait(&group->state, state);
+        __atomic_fetch_and(&group->state, ~TASKS_WAITING, __ATOMIC_RELAXED);
+        spins = 0;
+    }
+}
+
+// run [lo, hi), pushing the upper half of the range for thieves until what's left fits in one grain
+static void tasks_range(tasks_worker* w, int64_t lo, int64_t hi, int64_t grain, void (*fn)(void*, int64_t, int64_t), void* ctx)
+{
+    while (hi - lo > grain)
+    {
+        int64_t mid = lo + (hi - lo) / 2;
+        tasks_task task = {TASKS_KIND_RANGE, (void*)fn, ctx, mid, hi, grain, w->group};
+        tasks_push(w, &task);
+        hi = mid;
+    }
+    fn(ctx, lo, hi);
+}
+
+static void tasks_run(tasks_worker* w, tasks_task* task)
+{
+    // anything the task spawns belongs to its own group, which is synced before it counts as finished
+    tasks_group group = {0};
+    tasks_group* prev = w->group;
+    w->group = &group;
+    if (task->kind == TASKS_KIND_SPAWN) ((void (*)(void*))task->fn)(task->ctx);
+    else tasks_range(w, task->lo, task->hi, task->grain, (void (*)(void*, int64_t, int64_t))task->fn, task->ctx);
+    tasks_wait(w, &group);
+    w->group = prev;
+    tasks_finish(task->parent);
+}
+
+static void* tasks_worker_main(void* arg)
+{
+    tasks_worker* w = (tasks_worker*)arg;
+    *__thread_local() = w;
+    tasks_task task;
+    for (;;)
+    {
+        for (uint32_t spins = 0; spins < TASKS_SPINS; spins++)
+        {
+            if (tasks_find(w, &task))
+            {
+                tasks_run(w, &task);
+                spins = 0;
+            }
+            else TASKS_PAUSE();
+        }
+
+        uint32_t epoch = __atomic_load_n(&tasks_epoch, __ATOMIC_ACQUIRE);
+        __atomic_fetch_add(&tasks_sleepers, 1, __ATOMIC_SEQ_CST);
+        if (tasks_find(w, &task))
+        {
+            __atomic_fetch_sub(&tasks_sleepers, 1, __ATOMIC_RELAXED);
+            tasks_run(w, &task);
+            continue;
+        }
+        __futex_wait(&tasks_epoch, epoch);
+        __atomic_fetch_sub(&tasks_sleepers, 1, __ATOMIC_RELAXED);
+    }
+    return 0;
+}
+
+static void tasks_start()
+{
+    __mutex_lock(&tasks_init_lock);
+    if (!__atomic_load_n(&tasks_ready, __ATOMIC_ACQUIRE))
+    {
+        uint64_t n = tasks_requested != 0 ? tasks_requested : __ncpus();
+        if (n > TASKS_MAX_WORKERS) n = TASKS_MAX_WORKERS;
+        for (uint64_t i = 0; i < n; i++)
+        {
+            // __malloc only aligns to 16, so over allocate to put top and bottom on their own cache lines.
+            // Workers live for the rest of the program, so the original pointer isn't kept for a __free
+            uint8_t* block = (uint8_t*)__malloc(sizeof(tasks_worker) + TASKS_ALIGN - 1);
+            if (block == 0) break;
+            tasks_worker* w = (tasks_worker*)(((uint64_t)block + TASKS_ALIGN - 1) & ~(uint64_t)(TASKS_ALIGN - 1));
+            w->top = 0;
+            w->bottom = 0;
+            w->root.state = 0;
+            w->group = &w->root;
+            w->rng = 0x9E3779B97F4A7C15ull * (i + 1);
+            w->index = i;
+            tasks_workers[tasks_nworkers++] = w;
+        }
+        // the starting thread is worker 0, and the rest get background threads
+        if (tasks_nworkers > 0) *__thread_local() = tasks_workers[0];
+        for (uint64_t i = 1; i < tasks_nworkers; i++) __thread_spawn(tasks_worker_main, tasks_workers[i]);
+        __atomic_store_n(&tasks_ready, 1, __ATOMIC_RELEASE);
+    }
+    __mutex_unlock(&tasks_init_lock);
+}
+
+// the calling thread's worker, or NULL if it isn't one (tasks then run serially)
+static tasks_worker* tasks_self()
+{
+    if (!__atomic_load_n(&tasks_ready, __ATOMIC_ACQUIRE)) tasks_start();
+    return (tasks_worker*)*__thread_local();
+}
+
+
+////// entry points //////
+void __sched_init(uint64_t workers)
+{
+    if (__atomic_load_n(&tasks_ready, __ATOMIC_ACQUIRE)) return;
+    tasks_requested = workers;
+    tasks_start();
+}
+
+void __spawn(void (*fn)(void* ctx), void* ctx)
+{
+    tasks_worker* w = tasks_self();
+    if (w == 0)
+    {
+        fn(ctx);
+        return;
+    }
+    tasks_task task = {TASKS_KIND_SPAWN, (void*)fn, ctx, 0, 0, 0, w->group};
+    tasks_push(w, &task);
+}
+
+void __sync()
+{
+    tasks_worker* w = tasks_self();
+    if (w != 0) tasks_wait(w, w->group);
+}
+
+void __par_for(int64_t begin, int64_t end, int64_t grain, void (*fn)(void* ctx, int64_t lo, int64_t hi), void* ctx)
+{
+    if (end <= begin) return;
+    tasks_worker* w = tasks_self();
+    if (grain <= 0)
+    {
+        // ~8 pieces per worker leaves room to rebalance uneven iterations
+        grain = (end - begin) / (int64_t)(8 * (tasks_nworkers > 0 ? tasks_nworkers : 1));
+        if (grain < 1) grain = 1;
+    }
+    if (w == 0)
+    {
+        for (int64_t lo = begin; lo < end; lo += grain) fn(ctx, lo, end - lo > grain ? lo + grain : end);
+        return;
+    }
+
+    tasks_group group = {0};
+    tasks_group* prev = w->group;
+    w->group = &group;
+    tasks_range(w, begin, end, grain, fn, ctx);
+    tasks_wait(w, &group);
+    w->group = prev;
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef TASKS_H
+#define TASKS_H
+
+/* work-stealing task scheduler, shared by the hosted and freestanding runtimes */
+/*
+ * __spawn(fn, ctx) queues fn(ctx) to run in parallel with the caller. __sync() waits until every
+ * task spawned by the current task (or by the caller, outside of any task) has finished, and runs
+ * queued tasks itself while it waits. Tasks that finish without calling __sync are synced implicitly.
+ *
+ * __par_for(begin, end, grain, fn, ctx) calls fn(ctx, lo, hi) on disjoint subranges covering
+ * [begin, end), each at most grain long (0 picks a grain from the range and worker count), and
+ * returns once all of them are done. Ranges are split in half recursively, so idle workers steal
+ * large pieces and the owner works through the rest in order.
+ *
+ * Each worker owns a fixed size Chase-Lev deque: the owner pushes and pops at the bottom, thieves
+ * steal from the top. When a deque is full, __spawn runs the task inline instead. Idle workers
+ * sleep on a futex and are woken by __spawn.
+ *
+ * The scheduler starts on first use with __ncpus() workers (the calling thread plus background
+ * threads), or with the count given to an earlier __sched_init call. Threads other than the one
+ * that started it can call __par_for/__spawn, but their tasks run serially on that thread.
+ */
+
+#include <stdint.h>
+
+#define TASKS_MAX_WORKERS 256
+#define TASKS_DEQUE_SIZE 4096 // per worker, must be a power of two
+
+void __sched_init(uint64_t workers);
+void __spawn(void (*fn)(void* ctx), void* ctx);
+void __sync();
+void __par_for(int64_t begin, int64_t end, int64_t grain, void (*fn)(void* ctx, int64_t lo, int64_t hi), void* ctx);
+
+#endif
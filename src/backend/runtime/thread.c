@@ -0,0 +1,121 @@
+#ifndef THREAD_C
+#define THREAD_C
+
+#include "thread.h"
+#include "sync.h"
+#include "syscall.h"
+
+#define THREAD_GUARD_SIZE 4096
+
+// lives at the top of the thread's own stack mapping (or is static for the main thread)
+typedef struct thread {
+    struct thread* self; // fs:0 points here, so the current thread can be read with one load
+    void* local;         // slot returned by __thread_local
+    void* (*fn)(void*);
+    void* arg;
+    void* result;
+    uint8_t* map;      // start of the mapping (guard page included)
+    uint64_t map_size;
+    uint32_t tid;      // set by the kernel at spawn, and cleared (plus a futex wake) when the thread exits
+} thread;
+
+void __futex_wait(uint32_t* addr, uint32_t expected) { __syscall6(SYS_futex, (int64_t)addr, FUTEX_WAIT_PRIVATE, expected, 0, 0, 0); }
+void __futex_wake(uint32_t* addr, uint32_t count) { __syscall6(SYS_futex, (int64_t)addr, FUTEX_WAKE_PRIVATE, count, 0, 0, 0); }
+
+// the main thread isn't created by clone, so it gets its control block here on first use.
+// This always happens on the main thread, since it's the only thread until __thread_spawn has run
+static thread thread_main;
+static uint8_t thread_main_ready = 0;
+static void thread_init_main()
+{
+    thread_main.self = &thread_main;
+    __syscall3(SYS_arch_prctl, ARCH_SET_FS, (int64_t)&thread_main, 0);
+    thread_main_ready = 1;
+}
+
+void** __thread_local()
+{
+    if (!thread_main_ready) thread_init_main();
+    thread* t;
+    asm volatile("mov %%fs:0, %0" : "=r"(t));
+    return &t->local;
+}
+
+uint64_t __ncpus()
+{
+    uint64_t mask[16]; // up to 1024 cpus
+    int64_t n = __syscall3(SYS_sched_getaffinity, 0, sizeof(mask), (int64_t)mask);
+    if (n <= 0) return 1;
+    uint64_t count = 0;
+    for (int64_t i = 0; i < n / 8; i++)
+        for (uint64_t m = mask[i]; m != 0; m &= m - 1) count++;
+    return count > 0 ? count : 1;
+}
+
+// first (and only) frame on a new thread's stack
+static __attribute__((noreturn, used)) void thread_entry(thread* t)
+{
+    t->result = t->fn(t->arg);
+    // exit just this thread (not exit_group). The kernel then clears t->tid and wakes any joiner
+    for (;;) __syscall3(SYS_exit, 0, 0, 0);
+}
+
+void* __thread_spawn(void* (*fn)(void*), void* arg)
+{
+    if (!thread_main_ready) thread_init_main();
+    uint64_t map_size = THREAD_STACK_SIZE + THREAD_GUARD_SIZE;
+    int64_t map = __syscall6(SYS_mmap, 0, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (__syscall_failed(map)) return 0;
+    __syscall3(SYS_mprotect, map, THREAD_GUARD_SIZE, PROT_NONE);
+
+    // the stack grows down from just below the thread struct
+    thread* t = (thread*)(((uint64_t)map + map_size - sizeof(thread)) & ~(uint64_t)15);
+    t->self = t;
+    t->local = 0;
+    t->fn = fn;
+    t->arg = arg;
+    t->result = 0;
+    t->map = (uint8_t*)map;
+    t->map_size = map_size;
+    uint8_t* stack = (uint8_t*)t;
+
+    uint64_t flags = CLONE_VM | CLONE_FS | CLONE_FILES | CLONE_SIGHAND | CLONE_THREAD | CLONE_SYSVSEM | CLONE_SETTLS | CLONE_PARENT_SETTID | CLONE_CHILD_CLEARTID;
+    int64_t ret;
+    register int64_t r10 asm("r10") = (int64_t)&t->tid; // child_tid
+    register int64_t r8 asm("r8") = (int64_t)t;         // tls (fs base)
+    register int64_t r12 asm("r12") = (int64_t)t;       // callee saved, so the child still has it after the syscall
+    register int64_t r13 asm("r13") = (int64_t)thread_entry;
+    asm volatile(
+        "syscall\n"
+        "test %%rax, %%rax\n"
+        "jnz 1f\n"
+        // child: now running on the new (16-byte aligned) stack
+        "xor %%ebp, %%ebp\n"
+        "mov %%r12, %%rdi\n"
+        "call *%%r13\n"
+        "1:\n"
+        : "=a"(ret)
+        : "a"(SYS_clone), "D"(flags), "S"(stack), "d"(&t->tid), "r"(r10), "r"(r8), "r"(r12), "r"(r13)
+        : "rcx", "r11", "memory");
+
+    if (ret < 0)
+    {
+        __syscall3(SYS_munmap, map, map_size, 0);
+        return 0;
+    }
+    return t;
+}
+
+void* __thread_join(void* handle)
+{
+    thread* t = (thread*)handle;
+    uint32_t tid;
+    // the kernel's wake on thread exit is a shared (non-private) futex wake, so wait the same way
+    while ((tid = __atomic_load_n(&t->tid, __ATOMIC_ACQUIRE)) != 0)
+        __syscall6(SYS_futex, (int64_t)&t->tid, FUTEX_WAIT, tid, 0, 0, 0);
+    void* result = t->result;
+    __syscall3(SYS_munmap, (int64_t)t->map, t->map_size, 0);
+    return result;
+}
+
+#endif
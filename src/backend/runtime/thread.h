@@ -0,0 +1,27 @@
+#ifndef THREAD_H
+#define THREAD_H
+
+/* threads for the freestanding runtime, with the same ABI as the hosted (pthreads) versions in ../qbe/shim.c */
+/*
+ * __thread_spawn runs fn(arg) on a new thread and returns a handle for it (NULL on failure).
+ * __thread_join waits for the thread to finish, releases it, and returns fn's result.
+ * Every spawned thread must be joined exactly once.
+ * __thread_local returns the address of a single pointer-sized slot private to the calling thread
+ * (initially NULL), which the runtime uses to find per-thread state such as the current worker.
+ * __ncpus returns the number of cpus the process may run on.
+ *
+ * Freestanding threads are raw clone(2) threads sharing the address space, each with its own
+ * THREAD_STACK_SIZE mmap'd stack (with a guard page below it). The fs register points at each
+ * thread's control block, which is how __thread_local finds its slot.
+ */
+
+#include <stdint.h>
+
+#define THREAD_STACK_SIZE (1 << 20)
+
+void* __thread_spawn(void* (*fn)(void*), void* arg);
+void* __thread_join(void* thread);
+void** __thread_local();
+uint64_t __ncpus();
+
+#endif
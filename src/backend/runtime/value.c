@@ -0,0 +1,720 @@
+#ifndef VALUE_C
+#define VALUE_C
+
+#include "value.h"
+#include "arena.h"
+#include "fmt.h"
+
+void __write(uint8_t* s, uint64_t len);
+void __exit(uint64_t code);
+uint64_t __getlv(uint8_t** dst);
+uint64_t __time();
+uint64_t __cycles();
+void* __realloc(void* ptr, uint64_t size);
+
+#define VAL_TAG(v) ((v) & VAL_TAG_MASK)
+#define VAL_IS_INT(v) (VAL_TAG(v) == VAL_INT)
+#define VAL_IS_BOOL(v) (VAL_TAG(v) == VAL_BOOL)
+#define VAL_GET_INT(v) ((int64_t)(v) >> VAL_TAG_BITS)
+#define VAL_GET_BOOL(v) ((uint8_t)((v) >> VAL_TAG_BITS))
+#define VAL_MAKE_INT(i) (((uint64_t)(i) << VAL_TAG_BITS) | VAL_INT)
+#define VAL_MAKE_BOOL(b) ((b) ? VAL_TRUE : VAL_FALSE)
+
+typedef struct { uint64_t kind; uint64_t len; uint8_t* data; } val_string;
+typedef struct { uint64_t kind; double d; } val_float;
+typedef struct { uint64_t kind; uint64_t len; val* items; } val_array;
+typedef struct { uint64_t kind; val first, second, last; uint64_t brackets; } val_range;
+typedef struct { uint64_t kind; void* fn; void* env; val src; } val_closure;
+typedef struct { uint64_t kind; val target; int64_t index; } val_iter;
+
+static uint64_t val_kind(val v) { return VAL_TAG(v) == VAL_OBJ ? *(uint64_t*)v : 0; }
+
+
+////// allocation //////
+static void* val_arena = 0;
+
+static void* val_alloc(uint64_t size)
+{
+    if (val_arena == 0) val_arena = __arena_new(0);
+    void* ptr = val_arena != 0 ? __arena_alloc(val_arena, size) : 0;
+    if (ptr == 0) __val_fail((uint8_t*)"out of memory");
+    return ptr;
+}
+
+static void val_copy(uint8_t* dst, uint8_t* src, uint64_t n)
+{
+    for (uint64_t i = 0; i < n; i++) dst[i] = src[i];
+}
+
+val __val_float(double d)
+{
+    val_float* f = (val_float*)val_alloc(sizeof(val_float));
+    f->kind = VAL_KIND_FLOAT;
+    f->d = d;
+    return (val)f;
+}
+
+val __val_string(uint8_t* data, uint64_t len)
+{
+    val_string* s = (val_string*)val_alloc(sizeof(val_string) + len + 1);
+    s->kind = VAL_KIND_STRING;
+    s->len = len;
+    s->data = (uint8_t*)(s + 1);
+    val_copy(s->data, data, len);
+    s->data[len] = 0;
+    return (val)s;
+}
+
+static val_array* val_new_array(uint64_t n)
+{
+    val_array* a = (val_array*)val_alloc(sizeof(val_array) + n * sizeof(val));
+    a->kind = VAL_KIND_ARRAY;
+    a->len = n;
+    a->items = (val*)(a + 1);
+    return a;
+}
+
+val __val_array(uint64_t n, val* items)
+{
+    val_array* a = val_new_array(n);
+    for (uint64_t i = 0; i < n; i++) a->items[i] = items[i];
+    return (val)a;
+}
+
+val __val_range(val first, val second, val last, uint64_t brackets)
+{
+    // [a,b..c] may also arrive with the [a b] pair as a single array value
+    if (second == VAL_UNDEFINED && val_kind(first) == VAL_KIND_ARRAY && ((val_array*)first)->len == 2)
+    {
+        second = ((val_array*)first)->items[1];
+        first = ((val_array*)first)->items[0];
+    }
+    val_range* r = (val_range*)val_alloc(sizeof(val_range));
+    r->kind = VAL_KIND_RANGE;
+    r->first = first;
+    r->second = second;
+    r->last = last == VAL_VOID ? VAL_UNDEFINED : last;
+    r->brackets = brackets;
+    return (val)r;
+}
+
+val __val_closure(void* fn, void* env, val src)
+{
+    val_closure* c = (val_closure*)val_alloc(sizeof(val_closure));
+    c->kind = VAL_KIND_CLOSURE;
+    c->fn = fn;
+    c->env = env;
+    c->src = src;
+    return (val)c;
+}
+
+void* __val_frame(void* parent, uint64_t slots)
+{
+    val* frame = (val*)val_alloc(slots * sizeof(val));
+    frame[0] = (val)parent;
+    for (uint64_t i = 1; i < slots; i++) frame[i] = VAL_VOID;
+    return frame;
+}
+
+
+////// errors //////
+static uint64_t val_cstrlen(uint8_t* s)
+{
+    uint64_t n = 0;
+    while (s[n]) n++;
+    return n;
+}
+
+void __val_fail(uint8_t* msg)
+{
+    __write((uint8_t*)"Error: ", 7);
+    __write(msg, val_cstrlen(msg));
+    __write((uint8_t*)"\n", 1);
+    __exit(1);
+}
+
+
+////// operators //////
+// numbers are either ints or floats. Returns 0 if v is neither
+static uint8_t val_number(val v, double* d)
+{
+    if (VAL_IS_INT(v)) *d = (double)VAL_GET_INT(v);
+    else if (val_kind(v) == VAL_KIND_FLOAT) *d = ((val_float*)v)->d;
+    else return 0;
+    return 1;
+}
+
+static double val_floor(double d)
+{
+    if (!(d > -9007199254740992.0 && d < 9007199254740992.0)) return d; // already integral (or nan/inf)
+    double t = (double)(int64_t)d;
+    return t > d ? t - 1 : t;
+}
+
+#define VAL_BINOP_START                                                                       \
+    if (l == VAL_UNDEFINED || r == VAL_UNDEFINED) return VAL_UNDEFINED;
+#define VAL_BINOP_FAIL(name) __val_fail((uint8_t*)"unsupported operand types for " name)
+
+// ints are multiplied as unsigned words, so that overflow wraps at 61 bits once re-tagged (signed overflow is undefined)
+#define VAL_INT_MUL(l, r) VAL_MAKE_INT((uint64_t)VAL_GET_INT(l) * (uint64_t)VAL_GET_INT(r))
+
+val __val_add(val l, val r)
+{
+    VAL_BINOP_START
+    double ld, rd;
+    if (VAL_IS_INT(l) && VAL_IS_INT(r)) return l + r - VAL_INT;
+    if (val_kind(l) == VAL_KIND_ARRAY && val_kind(r) == VAL_KIND_ARRAY)
+    {
+        val_array* a = (val_array*)l;
+        val_array* b = (val_array*)r;
+        val_array* c = (val_array*)__val_array(a->len + b->len, a->items);
+        for (uint64_t i = 0; i < b->len; i++) c->items[a->len + i] = b->items[i];
+        return (val)c;
+    }
+    if (val_number(l, &ld) && val_number(r, &rd)) return __val_float(ld + rd);
+    VAL_BINOP_FAIL("+");
+    return VAL_UNDEFINED;
+}
+
+val __val_sub(val l, val r)
+{
+    VAL_BINOP_START
+    double ld, rd;
+    if (VAL_IS_INT(l) && VAL_IS_INT(r)) return l - r + VAL_INT;
+    if (val_number(l, &ld) && val_number(r, &rd)) return __val_float(ld - rd);
+    VAL_BINOP_FAIL("-");
+    return VAL_UNDEFINED;
+}
+
+val __val_mul(val l, val r)
+{
+    VAL_BINOP_START
+    double ld, rd;
+    if (VAL_IS_INT(l) && VAL_IS_INT(r)) return VAL_INT_MUL(l, r);
+    if (val_number(l, &ld) && val_number(r, &rd)) return __val_float(ld * rd);
+    VAL_BINOP_FAIL("*");
+    return VAL_UNDEFINED;
+}
+
+val __val_div(val l, val r)
+{
+    VAL_BINOP_START
+    double ld, rd;
+    if (VAL_IS_INT(l) && VAL_IS_INT(r))
+    {
+        int64_t a = VAL_GET_INT(l), b = VAL_GET_INT(r);
+        if (b == 0) return VAL_UNDEFINED;
+        if (a % b == 0) return VAL_MAKE_INT(a / b);
+        return __val_float((double)a / (double)b);
+    }
+    if (val_number(l, &ld) && val_number(r, &rd))
+    {
+        if (rd == 0) return VAL_UNDEFINED;
+        return __val_float(ld / rd);
+    }
+    VAL_BINOP_FAIL("/");
+    return VAL_UNDEFINED;
+}
+
+val __val_mod(val l, val r)
+{
+    VAL_BINOP_START
+    double ld, rd;
+    if (VAL_IS_INT(l) && VAL_IS_INT(r))
+    {
+        int64_t a = VAL_GET_INT(l), b = VAL_GET_INT(r);
+        if (b == 0) __val_fail((uint8_t*)"integer modulo by zero");
+        int64_t m = a % b;
+        if (m != 0 && (m < 0) != (b < 0)) m += b; // floored, like python
+        return VAL_MAKE_INT(m);
+    }
+    if (val_number(l, &ld) && val_number(r, &rd))
+    {
+        if (rd == 0) __val_fail((uint8_t*)"float modulo by zero");
+        return __val_float(ld - val_floor(ld / rd) * rd);
+    }
+    VAL_BINOP_FAIL("%");
+    return VAL_UNDEFINED;
+}
+
+static double val_powi(double base, int64_t e)
+{
+    uint64_t n = e < 0 ? -(uint64_t)e : (uint64_t)e;
+    double result = 1;
+    while (n)
+    {
+        if (n & 1) result *= base;
+        base *= base;
+        n >>= 1;
+    }
+    return e < 0 ? 1 / result : result;
+}
+
+val __val_pow(val l, val r)
+{
+    VAL_BINOP_START
+    double ld;
+    if (VAL_IS_INT(l) && VAL_IS_INT(r))
+    {
+        int64_t e = VAL_GET_INT(r);
+        if (e < 0) return __val_float(val_powi((double)VAL_GET_INT(l), e));
+        uint64_t base = (uint64_t)VAL_GET_INT(l), result = 1; // wraps like __val_mul
+        while (e)
+        {
+            if (e & 1) result *= base;
+            base *= base;
+            e >>= 1;
+        }
+        return VAL_MAKE_INT(result);
+    }
+    if (val_number(l, &ld) && VAL_IS_INT(r)) return __val_float(val_powi(ld, VAL_GET_INT(r)));
+    VAL_BINOP_FAIL("^ (only integer exponents are supported)");
+    return VAL_UNDEFINED;
+}
+
+#define VAL_COMPARE(fn_name, op, name)                                                        \
+    val fn_name(val l, val r)                                                                 \
+    {                                                                                         \
+        VAL_BINOP_START                                                                 \
+        double ld, rd;                                                                        \
+        if (VAL_IS_INT(l) && VAL_IS_INT(r)) return VAL_MAKE_BOOL(VAL_GET_INT(l) op VAL_GET_INT(r)); \
+        if (val_number(l, &ld) && val_number(r, &rd)) return VAL_MAKE_BOOL(ld op rd);         \
+        VAL_BINOP_FAIL(name);                                                                 \
+        return VAL_UNDEFINED;                                                                 \
+    }
+VAL_COMPARE(__val_lt, <, "<?")
+VAL_COMPARE(__val_le, <=, "<=?")
+VAL_COMPARE(__val_gt, >, ">?")
+VAL_COMPARE(__val_ge, >=, ">=?")
+
+val __val_eq(val l, val r)
+{
+    VAL_BINOP_START
+    if (VAL_TAG(l) != VAL_OBJ || VAL_TAG(r) != VAL_OBJ)
+    {
+        // ints and bools are equal exactly when their words are, but only compare like with like
+        if (VAL_TAG(l) == VAL_TAG(r) && (VAL_IS_INT(l) || VAL_IS_BOOL(l))) return VAL_MAKE_BOOL(l == r);
+        VAL_BINOP_FAIL("=?");
+    }
+    uint64_t kind = val_kind(l);
+    if (kind != val_kind(r)) VAL_BINOP_FAIL("=?");
+    if (kind == VAL_KIND_FLOAT) return VAL_MAKE_BOOL(((val_float*)l)->d == ((val_float*)r)->d);
+    if (kind == VAL_KIND_STRING)
+    {
+        val_string* a = (val_string*)l;
+        val_string* b = (val_string*)r;
+        if (a->len != b->len) return VAL_FALSE;
+        for (uint64_t i = 0; i < a->len; i++)
+            if (a->data[i] != b->data[i]) return VAL_FALSE;
+        return VAL_TRUE;
+    }
+    VAL_BINOP_FAIL("=?");
+    return VAL_UNDEFINED;
+}
+
+// ints are bitwise, bools are logical
+#define VAL_LOGICAL(fn_name, int_expr, bool_expr, name)                                       \
+    val fn_name(val l, val r)                                                                 \
+    {                                                                                         \
+        VAL_BINOP_START                                                                 \
+        if (VAL_IS_INT(l) && VAL_IS_INT(r))                                                   \
+        {                                                                                     \
+            int64_t a = VAL_GET_INT(l), b = VAL_GET_INT(r);                                   \
+            return VAL_MAKE_INT(int_expr);                                                    \
+        }                                                                                     \
+        if (VAL_IS_BOOL(l) && VAL_IS_BOOL(r))                                                 \
+        {                                                                                     \
+            uint8_t a = VAL_GET_BOOL(l), b = VAL_GET_BOOL(r);                                 \
+            return VAL_MAKE_BOOL(bool_expr);                                                  \
+        }                                                                                     \
+        VAL_BINOP_FAIL(name);                                                                 \
+        return VAL_UNDEFINED;                                                                 \
+    }
+VAL_LOGICAL(__val_and, a & b, a && b, "and")
+VAL_LOGICAL(__val_or, a | b, a || b, "or")
+VAL_LOGICAL(__val_xor, a ^ b, a != b, "xor")
+VAL_LOGICAL(__val_nand, ~(a & b), !(a && b), "nand")
+VAL_LOGICAL(__val_nor, ~(a | b), !(a || b), "nor")
+VAL_LOGICAL(__val_xnor, ~(a ^ b), a == b, "xnor")
+
+// counts of 61 or more shift every bit out of an int (leaving 0, or the sign for >>). Negative counts are an error, as in python
+val __val_shl(val l, val r)
+{
+    VAL_BINOP_START
+    if (VAL_IS_INT(l) && VAL_IS_INT(r))
+    {
+        int64_t n = VAL_GET_INT(r);
+        if (n < 0) __val_fail((uint8_t*)"negative shift count");
+        if (n >= 61) return VAL_MAKE_INT(0);
+        return VAL_MAKE_INT((uint64_t)VAL_GET_INT(l) << n);
+    }
+    VAL_BINOP_FAIL("<<");
+    return VAL_UNDEFINED;
+}
+
+val __val_shr(val l, val r)
+{
+    VAL_BINOP_START
+    if (VAL_IS_INT(l) && VAL_IS_INT(r))
+    {
+        int64_t a = VAL_GET_INT(l), n = VAL_GET_INT(r);
+        if (n < 0) __val_fail((uint8_t*)"negative shift count");
+        if (n >= 61) return VAL_MAKE_INT(a < 0 ? -1 : 0);
+        return VAL_MAKE_INT(a >> n);
+    }
+    VAL_BINOP_FAIL(">>");
+    return VAL_UNDEFINED;
+}
+
+val __val_not(val v)
+{
+    if (v == VAL_UNDEFINED) return VAL_UNDEFINED;
+    if (VAL_IS_INT(v)) return VAL_MAKE_INT(~VAL_GET_INT(v));
+    if (VAL_IS_BOOL(v)) return VAL_MAKE_BOOL(!VAL_GET_BOOL(v));
+    __val_fail((uint8_t*)"unsupported operand type for not");
+    return VAL_UNDEFINED;
+}
+
+val __val_neg(val v)
+{
+    if (v == VAL_UNDEFINED) return VAL_UNDEFINED;
+    if (VAL_IS_INT(v)) return VAL_MAKE_INT(-VAL_GET_INT(v));
+    if (val_kind(v) == VAL_KIND_FLOAT) return __val_float(-((val_float*)v)->d);
+    __val_fail((uint8_t*)"unsupported operand type for -");
+    return VAL_UNDEFINED;
+}
+
+val __val_pos(val v)
+{
+    if (v == VAL_UNDEFINED || VAL_IS_INT(v) || val_kind(v) == VAL_KIND_FLOAT) return v;
+    __val_fail((uint8_t*)"unsupported operand type for +");
+    return VAL_UNDEFINED;
+}
+
+
+////// broadcasting //////
+static val (*const val_binops[VAL_OP_COUNT])(val, val) = {
+    __val_add, __val_sub, __val_mul, __val_div, __val_mod, __val_pow,
+    __val_lt, __val_le, __val_gt, __val_ge, __val_eq,
+    __val_and, __val_or, __val_xor, __val_nand, __val_nor, __val_xnor,
+    __val_shl, __val_shr,
+};
+
+// number of nested array levels (0 for scalars), going by the first element of each level
+static uint64_t val_rank(val v)
+{
+    uint64_t rank = 0;
+    while (val_kind(v) == VAL_KIND_ARRAY)
+    {
+        rank++;
+        val_array* a = (val_array*)v;
+        if (a->len == 0) break;
+        v = a->items[0];
+    }
+    return rank;
+}
+
+static uint8_t val_all_ints(val* items, uint64_t n)
+{
+    uint64_t tags = 0;
+    for (uint64_t i = 0; i < n; i++) tags |= (items[i] ^ VAL_INT) & VAL_TAG_MASK;
+    return tags == 0;
+}
+
+// one loop per operator over the tagged words of int arrays, without branches so the compiler can vectorize them.
+// l and r step through lp/rp when ls/rs are set, otherwise lp[0]/rp[0] is repeated
+#define VAL_INT_LOOP(expr)                                                                    \
+    if (ls && rs)                                                                             \
+        for (uint64_t i = 0; i < n; i++) { val l = lp[i], r = rp[i]; out[i] = (expr); }       \
+    else if (ls)                                                                              \
+    {                                                                                         \
+        val r = rp[0];                                                                        \
+        for (uint64_t i = 0; i < n; i++) { val l = lp[i]; out[i] = (expr); }                  \
+    }                                                                                         \
+    else                                                                                      \
+    {                                                                                         \
+        val l = lp[0];                                                                        \
+        for (uint64_t i = 0; i < n; i++) { val r = rp[i]; out[i] = (expr); }                  \
+    }                                                                                         \
+    return 1;
+
+// the same results as the scalar operators on ints. Returns 0 for operators that don't have a kernel
+static uint8_t val_int_kernel(uint64_t op, val* lp, uint64_t ls, val* rp, uint64_t rs, val* out, uint64_t n)
+{
+    switch (op)
+    {
+    case VAL_OP_ADD: VAL_INT_LOOP(l + r - VAL_INT)
+    case VAL_OP_SUB: VAL_INT_LOOP(l - r + VAL_INT)
+    case VAL_OP_MUL: VAL_INT_LOOP(VAL_INT_MUL(l, r))
+    case VAL_OP_LT: VAL_INT_LOOP(VAL_MAKE_BOOL(VAL_GET_INT(l) < VAL_GET_INT(r)))
+    case VAL_OP_LE: VAL_INT_LOOP(VAL_MAKE_BOOL(VAL_GET_INT(l) <= VAL_GET_INT(r)))
+    case VAL_OP_GT: VAL_INT_LOOP(VAL_MAKE_BOOL(VAL_GET_INT(l) > VAL_GET_INT(r)))
+    case VAL_OP_GE: VAL_INT_LOOP(VAL_MAKE_BOOL(VAL_GET_INT(l) >= VAL_GET_INT(r)))
+    case VAL_OP_EQ: VAL_INT_LOOP(VAL_MAKE_BOOL(l == r))
+    case VAL_OP_AND: VAL_INT_LOOP(l & r)
+    case VAL_OP_OR: VAL_INT_LOOP(l | r)
+    case VAL_OP_XOR: VAL_INT_LOOP(VAL_MAKE_INT(VAL_GET_INT(l) ^ VAL_GET_INT(r)))
+    case VAL_OP_NAND: VAL_INT_LOOP(VAL_MAKE_INT(~(VAL_GET_INT(l) & VAL_GET_INT(r))))
+    case VAL_OP_NOR: VAL_INT_LOOP(VAL_MAKE_INT(~(VAL_GET_INT(l) | VAL_GET_INT(r))))
+    case VAL_OP_XNOR: VAL_INT_LOOP(VAL_MAKE_INT(~(VAL_GET_INT(l) ^ VAL_GET_INT(r))))
+    }
+    return 0;
+}
+
+val __val_broadcast(uint64_t op, val l, val r)
+{
+    if (op >= VAL_OP_COUNT) __val_fail((uint8_t*)"unknown broadcast operator");
+    uint64_t lrank = val_rank(l), rrank = val_rank(r);
+    if (lrank == 0 && rrank == 0) return val_binops[op](l, r);
+
+    // a lower rank side (or an array of length 1) is repeated against each element of the other side
+    val_array* a = (val_array*)l;
+    val_array* b = (val_array*)r;
+    val* lp = lrank < rrank ? &l : a->items;
+    val* rp = rrank < lrank ? &r : b->items;
+    uint64_t ls = lrank >= rrank, rs = rrank >= lrank, n;
+    if (lrank < rrank) n = b->len;
+    else if (rrank < lrank) n = a->len;
+    else if (a->len == b->len) n = a->len;
+    else if (a->len == 1) n = b->len, ls = 0;
+    else if (b->len == 1) n = a->len, rs = 0;
+    else
+    {
+        __val_fail((uint8_t*)"cannot broadcast arrays of different lengths");
+        return VAL_UNDEFINED;
+    }
+
+    val_array* out = val_new_array(n);
+    if (lrank <= 1 && rrank <= 1 && val_all_ints(lp, ls ? n : 1) && val_all_ints(rp, rs ? n : 1) &&
+        val_int_kernel(op, lp, ls, rp, rs, out->items, n))
+        return (val)out;
+
+    // anything else (floats, mixed or nested arrays, undefined) an element at a time
+    for (uint64_t i = 0; i < n; i++) out->items[i] = __val_broadcast(op, lp[ls * i], rp[rs * i]);
+    return (val)out;
+}
+
+
+////// control flow //////
+uint64_t __val_truthy(val v)
+{
+    if (VAL_IS_BOOL(v)) return VAL_GET_BOOL(v);
+    if (VAL_IS_INT(v)) return VAL_GET_INT(v) != 0;
+    __val_fail((uint8_t*)"condition is not a bool");
+    return 0;
+}
+
+val __val_call(val f, uint64_t argc, val* argv)
+{
+    if (val_kind(f) != VAL_KIND_CLOSURE) __val_fail((uint8_t*)"called value is not a function");
+    val_closure* c = (val_closure*)f;
+    return ((val(*)(void*, uint64_t, val*))c->fn)(c->env, argc, argv);
+}
+
+val __val_express(val v)
+{
+    if (val_kind(v) == VAL_KIND_CLOSURE) return __val_call(v, 0, 0);
+    return v;
+}
+
+val __val_keep(val prev, val v) { return v == VAL_VOID ? prev : v; }
+
+val __val_iter(val v)
+{
+    uint64_t kind = val_kind(v);
+    if (kind != VAL_KIND_ARRAY && kind != VAL_KIND_RANGE) __val_fail((uint8_t*)"value is not iterable");
+    if (kind == VAL_KIND_RANGE)
+    {
+        val_range* r = (val_range*)v;
+        if (!VAL_IS_INT(r->first) || (r->second != VAL_UNDEFINED && !VAL_IS_INT(r->second)) ||
+            (r->last != VAL_UNDEFINED && !VAL_IS_INT(r->last)))
+            __val_fail((uint8_t*)"only integer ranges can be iterated");
+    }
+    val_iter* it = (val_iter*)val_alloc(sizeof(val_iter));
+    it->kind = VAL_KIND_ITER;
+    it->target = v;
+    it->index = 0;
+    return (val)it;
+}
+
+val __val_next(val iter, val* item)
+{
+    val_iter* it = (val_iter*)iter;
+    int64_t i = it->index++;
+    if (val_kind(it->target) == VAL_KIND_ARRAY)
+    {
+        val_array* a = (val_array*)it->target;
+        if ((uint64_t)i >= a->len)
+        {
+            *item = VAL_UNDEFINED;
+            return VAL_FALSE;
+        }
+        *item = a->items[i];
+        return VAL_TRUE;
+    }
+
+    val_range* r = (val_range*)it->target;
+    int64_t first = VAL_GET_INT(r->first);
+    int64_t step = r->second == VAL_UNDEFINED ? 1 : VAL_GET_INT(r->second) - first;
+    int64_t value = first + (i + (r->brackets & VAL_RANGE_OPEN_LEFT ? 1 : 0)) * step;
+    if (r->last != VAL_UNDEFINED && value > VAL_GET_INT(r->last) + (r->brackets & VAL_RANGE_CLOSED_RIGHT ? 1 : 0) - 1)
+    {
+        *item = VAL_UNDEFINED;
+        return VAL_FALSE;
+    }
+    *item = VAL_MAKE_INT(value);
+    return VAL_TRUE;
+}
+
+
+////// strings and io //////
+// stringified values are either written straight to the output, or collected in a scratch buffer
+static uint8_t* val_scratch = 0;
+static uint64_t val_scratch_len = 0;
+static uint64_t val_scratch_cap = 0;
+static uint8_t val_to_scratch = 0;
+
+static void val_put(uint8_t* data, uint64_t len)
+{
+    if (!val_to_scratch)
+    {
+        __write(data, len);
+        return;
+    }
+    if (val_scratch_len + len > val_scratch_cap)
+    {
+        uint64_t cap = val_scratch_cap == 0 ? 256 : val_scratch_cap;
+        while (cap < val_scratch_len + len) cap *= 2;
+        uint8_t* buf = (uint8_t*)__realloc(val_scratch, cap);
+        if (buf == 0) __val_fail((uint8_t*)"out of memory");
+        val_scratch = buf;
+        val_scratch_cap = cap;
+    }
+    val_copy(val_scratch + val_scratch_len, data, len);
+    val_scratch_len += len;
+}
+
+static void val_puts(char* s) { val_put((uint8_t*)s, val_cstrlen((uint8_t*)s)); }
+
+// repr is the form the top level result is printed in: strings are quoted with whitespace escaped
+static void val_emit(val v, uint8_t repr);
+
+static void val_emit(val v, uint8_t repr)
+{
+    uint8_t buf[FMT_F64_MAX];
+    switch (VAL_TAG(v))
+    {
+    case VAL_INT: val_put(buf, __fmt_i64(buf, VAL_GET_INT(v))); return;
+    case VAL_BOOL: val_puts(VAL_GET_BOOL(v) ? "true" : "false"); return;
+    case VAL_UNDEFINED: val_puts("undefined"); return;
+    case VAL_VOID: val_puts("void"); return;
+    }
+
+    switch (val_kind(v))
+    {
+    case VAL_KIND_STRING:
+    {
+        val_string* s = (val_string*)v;
+        if (!repr)
+        {
+            val_put(s->data, s->len);
+            return;
+        }
+        val_put((uint8_t*)"\"", 1);
+        for (uint64_t i = 0; i < s->len; i++)
+        {
+            switch (s->data[i])
+            {
+            case '\t': val_puts("\\t"); break;
+            case '\r': val_puts("\\r"); break;
+            case '\f': val_puts("\\f"); break;
+            case '\v': val_puts("\\v"); break;
+            case '\n': val_puts("\\n"); break;
+            default: val_put(&s->data[i], 1);
+            }
+        }
+        val_put((uint8_t*)"\"", 1);
+        return;
+    }
+    case VAL_KIND_FLOAT: val_put(buf, __fmt_f64(buf, ((val_float*)v)->d)); return;
+    case VAL_KIND_ARRAY:
+    {
+        val_array* a = (val_array*)v;
+        val_put((uint8_t*)"[", 1);
+        for (uint64_t i = 0; i < a->len; i++)
+        {
+            if (i > 0) val_put((uint8_t*)" ", 1);
+            val_emit(a->items[i], repr);
+        }
+        val_put((uint8_t*)"]", 1);
+        return;
+    }
+    case VAL_KIND_RANGE:
+    {
+        // printl shows a stepped start as a,b while the repr shows it as the array [a b]
+        val_range* r = (val_range*)v;
+        val_put((uint8_t*)(r->brackets & VAL_RANGE_OPEN_LEFT ? "(" : "["), 1);
+        if (r->second != VAL_UNDEFINED)
+        {
+            val_put((uint8_t*)(repr ? "[" : ""), repr);
+            val_emit(r->first, repr);
+            val_put((uint8_t*)(repr ? " " : ","), 1);
+            val_emit(r->second, repr);
+            val_put((uint8_t*)"]", repr);
+        }
+        else val_emit(r->first, repr);
+        val_puts("..");
+        val_emit(r->last, repr);
+        val_put((uint8_t*)(r->brackets & VAL_RANGE_CLOSED_RIGHT ? "]" : ")"), 1);
+        return;
+    }
+    case VAL_KIND_CLOSURE: val_emit(((val_closure*)v)->src, 0); return;
+    case VAL_KIND_ITER: val_puts("<iterator>"); return;
+    }
+    __val_fail((uint8_t*)"cannot stringify value");
+}
+
+static val val_scratch_string(uint64_t n, val* parts)
+{
+    val_to_scratch = 1;
+    val_scratch_len = 0;
+    for (uint64_t i = 0; i < n; i++) val_emit(parts[i], 0);
+    val_to_scratch = 0;
+    return __val_string(val_scratch, val_scratch_len);
+}
+
+val __val_str(val v)
+{
+    if (val_kind(v) == VAL_KIND_STRING) return v;
+    return val_scratch_string(1, &v);
+}
+
+val __val_concat(uint64_t n, val* parts) { return val_scratch_string(n, parts); }
+
+void __val_print(val v) { val_emit(v, 0); }
+
+void __val_printl(val v)
+{
+    val_emit(v, 0);
+    __write((uint8_t*)"\n", 1);
+}
+
+void __val_result(val v)
+{
+    if (v == VAL_VOID) return;
+    val_emit(v, 1);
+    __write((uint8_t*)"\n", 1);
+}
+
+val __val_readl()
+{
+    uint8_t* line;
+    uint64_t len = __getlv(&line);
+    if (len == (uint64_t)-1) len = 0;
+    return __val_string(line, len);
+}
+
+val __val_time() { return VAL_MAKE_INT(__time()); }
+val __val_cycles() { return VAL_MAKE_INT(__cycles()); }
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef VALUE_H
+#define VALUE_H
+
+/* dynamically typed dewy values, used by code generated by the QBE backend (../qbe/qbe.py) */
+/*
+ * Every value is a single l word. The low 3 bits are a tag:
+ *   VAL_OBJ       pointer to an object (at least 8-aligned) whose first word is one of VAL_KIND_*
+ *   VAL_INT       61-bit signed integer in the upper bits (arithmetic wraps at 61 bits)
+ *   VAL_BOOL      bit 3 holds the value
+ *   VAL_UNDEFINED, VAL_VOID are singletons (the tag is the whole word)
+ * so ints, bools, undefined and void never allocate, and the compiler can emit constants for them
+ * directly. String literals are static objects emitted into the program's data section.
+ *
+ * Objects built at runtime (strings, floats, arrays, ranges, closures, iterators, closure frames)
+ * come from a single arena owned by the runtime. There is no garbage collector yet, so they live
+ * until the program exits.
+ *
+ * Operators follow the python backend: binary ops on undefined give undefined, ints and floats mix,
+ * Int / Int gives an Int when the division is exact, and % is floored. Mismatched types abort the
+ * program with a message through __val_fail.
+ *
+ * Closures are called as fn(env, argc, argv), where env is the frame of the function that created
+ * the closure, and argv holds argc positional argument values. They return a value (void if nothing
+ * is expressed). A frame is an array of words whose slot 0 points to the enclosing frame.
+ */
+
+#include <stdint.h>
+
+typedef uint64_t val;
+
+#define VAL_TAG_BITS 3
+#define VAL_TAG_MASK 7
+#define VAL_OBJ 0
+#define VAL_INT 1
+#define VAL_BOOL 2
+#define VAL_UNDEFINED 3
+#define VAL_VOID 4
+
+#define VAL_TRUE ((1 << VAL_TAG_BITS) | VAL_BOOL)
+#define VAL_FALSE VAL_BOOL
+#define VAL_INT_MIN (-((int64_t)1 << 60))
+#define VAL_INT_MAX (((int64_t)1 << 60) - 1)
+
+#define VAL_KIND_STRING 1  // {kind, len, uint8_t* data}
+#define VAL_KIND_FLOAT 2   // {kind, double}
+#define VAL_KIND_ARRAY 3   // {kind, len, val* items}
+#define VAL_KIND_RANGE 4   // {kind, first, second (undefined without a step), last (undefined if unbounded), brackets}
+#define VAL_KIND_CLOSURE 5 // {kind, fn, env, src (string shown when printed)}
+#define VAL_KIND_ITER 6    // {kind, target, index}
+
+// range brackets, matching the python backend's ( [ ) ] handling
+#define VAL_RANGE_OPEN_LEFT 1   // (a..
+#define VAL_RANGE_CLOSED_RIGHT 2 // ..b]
+
+// constructors
+val __val_float(double d);
+val __val_string(uint8_t* data, uint64_t len);
+val __val_array(uint64_t n, val* items);
+val __val_range(val first, val second, val last, uint64_t brackets);
+val __val_closure(void* fn, void* env, val src);
+void* __val_frame(void* parent, uint64_t slots); // slot 0 is parent, the rest start as void
+
+// operators
+val __val_add(val l, val r);
+val __val_sub(val l, val r);
+val __val_mul(val l, val r);
+val __val_div(val l, val r);
+val __val_mod(val l, val r);
+val __val_pow(val l, val r);
+val __val_lt(val l, val r);
+val __val_le(val l, val r);
+val __val_gt(val l, val r);
+val __val_ge(val l, val r);
+val __val_eq(val l, val r);
+val __val_and(val l, val r);
+val __val_or(val l, val r);
+val __val_xor(val l, val r);
+val __val_nand(val l, val r);
+val __val_nor(val l, val r);
+val __val_xnor(val l, val r);
+val __val_shl(val l, val r);
+val __val_shr(val l, val r);
+val __val_not(val v);
+val __val_neg(val v);
+val __val_pos(val v);
+
+// broadcast operators (e.g. `.+`) apply a binary operator between each pair of elements of two arrays, or of an array
+// and a scalar, as the python backend's broadcast_binary does. op picks the operator, in the order of the binary
+// operators above (the qbe backend's binary_runtime_fns)
+#define VAL_OP_ADD 0
+#define VAL_OP_SUB 1
+#define VAL_OP_MUL 2
+#define VAL_OP_DIV 3
+#define VAL_OP_MOD 4
+#define VAL_OP_POW 5
+#define VAL_OP_LT 6
+#define VAL_OP_LE 7
+#define VAL_OP_GT 8
+#define VAL_OP_GE 9
+#define VAL_OP_EQ 10
+#define VAL_OP_AND 11
+#define VAL_OP_OR 12
+#define VAL_OP_XOR 13
+#define VAL_OP_NAND 14
+#define VAL_OP_NOR 15
+#define VAL_OP_XNOR 16
+#define VAL_OP_SHL 17
+#define VAL_OP_SHR 18
+#define VAL_OP_COUNT 19
+val __val_broadcast(uint64_t op, val l, val r);
+
+// control flow
+uint64_t __val_truthy(val v);        // condition of an if/loop: 1 or 0
+val __val_call(val f, uint64_t argc, val* argv);
+val __val_express(val v);            // a bare reference: closures are called with no arguments, anything else is itself
+val __val_keep(val prev, val v);     // v if it's not void, otherwise prev (the expressed value of a group)
+val __val_iter(val v);               // iterator over an array or range
+val __val_next(val iter, val* item); // bool for whether an item was produced. *item is undefined when exhausted
+void __val_fail(uint8_t* msg);       // print an error and exit(1)
+
+// strings and io
+val __val_str(val v);                      // stringify as printl would
+val __val_concat(uint64_t n, val* parts);  // stringify each part and join them (interpolated strings)
+void __val_print(val v);
+void __val_printl(val v);
+void __val_result(val v); // print the value of the whole program (in repr form) unless it's void
+val __val_readl();
+val __val_time();
+val __val_cycles();
+
+#endif
@@ -71,17 +71,23 @@ class Scope:
     parent: 'Scope | None' = None
     # callables: dict[str, AST | None] = field(default_factory=dict) #TODO: maybe replace str->AST with str->signature (where signature might be constructed based on the func structure)
     vars: 'dict[str, Scope._var]' = field(default_factory=dict)
+    # optional array-backed frame: names resolved ahead of time to a slot index, each slot mirroring vars[name] (or None if unbound)
+    layout: 'dict[str, int] | None' = None
+    slots: 'list[Scope._var | None] | None' = None
 
     @overload
     def get(self, name:str, throw:TypingLiteral[True]=True, search_parents:bool=True) -> 'Scope._var': ...
     @overload
     def get(self, name:str, throw:TypingLiteral[False], search_parents:bool=True) -> 'Scope._var|None': ...
     def get(self, name:str, throw:bool=True, search_parents:bool=True) -> 'Scope._var|None':
-        for s in self:
-            if name in s.vars:
-                return s.vars[name]
+        s = self
+        while s is not None:
+            var = s.vars.get(name)
+            if var is not None:
+                return var
             if not search_parents:
                 break
+            s = s.parent
 
         if throw:
             raise KeyError(f'variable "{name}" not found in scope')
@@ -91,13 +97,13 @@ class Scope:
         assert len(DeclarationType.__members__) == 2, f'expected only 2 declaration types: let, const. found {DeclarationType.__members__}'
 
         # var is already declared in current scope
-        if name in self.vars:
-            var = self.vars[name]
+        var = self.vars.get(name)
+        if var is not None:
             assert var.decltype != DeclarationType.CONST, f"Attempted to assign to constant variable: {name=}{var=}. {value=}"
             var.value = value
             return
 
-        var = self.get(name, throw=False)
+        var = self.parent.get(name, throw=False) if self.parent is not None else None
 
         # var is not declared in any scope
         if var is None:
@@ -116,7 +122,10 @@ class Scope:
             var = self.vars[name]
             assert var.decltype != DeclarationType.CONST, f"Attempted to {decltype.name.lower()} declare a value that is const in this current scope. {name=}{var=}. {value=}"
 
-        self.vars[name] = Scope._var(decltype, type, value)
+        var = Scope._var(decltype, type, value)
+        self.vars[name] = var
+        if self.layout is not None and (slot := self.layout.get(name)) is not None:
+            self.slots[slot] = var
 
     def let(self, name:str, value:AST, type:Type):
         self.declare(name, value, type, DeclarationType.LET)
@@ -158,7 +167,25 @@ class Scope:
                     Group([]),
                     Type(String)
                 )
-            )
+            ),
+            # monotonic time in nanoseconds
+            'time': Scope._var(
+                DeclarationType.CONST,
+                Type(PrototypeBuiltin),
+                PrototypeBuiltin(
+                    Group([]),
+                    Type(Int)
+                )
+            ),
+            # cpu timestamp counter (rdtsc) on backends that have one, otherwise same as time
+            'cycles': Scope._var(
+                DeclarationType.CONST,
+                Type(PrototypeBuiltin),
+                PrototypeBuiltin(
+                    Group([]),
+                    Type(Int)
+                )
+            ),
         })
 
 
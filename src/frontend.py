@@ -11,19 +11,24 @@ def main():
     arg_parser = ArgumentParser(description='Dewy Compiler')
 
     # positional argument for the file to compile
-    arg_parser.add_argument('file', nargs='?', help='.dewy file to run. If not provided, will enter REPL mode using the python backend')
+    arg_parser.add_argument('file', nargs='?', help='.dewy file to run (- to read it from stdin). If not provided, will enter REPL mode using the python backend')
 
     # mutually exclusive flags for specifying the backend to use
     group = arg_parser.add_mutually_exclusive_group()
     group.add_argument('-i', action='store_true', help='(DEFAULT) Run in interpreter mode with the python backend')
-    group.add_argument('-c', action='store_true', help='Run in compiler mode with the QBE backend (not implemented yet)')
-    group.add_argument('--backend', type=str, help=f'Specify a backend compiler/interpreter by name to use. Backends will include: {backend_names} (however currently only python is available).')
+    group.add_argument('-c', action='store_true', help='Run in compiler mode with the QBE backend (needs qbe and a C compiler on the PATH)')
+    group.add_argument('--backend', type=str, help=f'Specify a backend compiler/interpreter by name to use. Backends will include: {backend_names} (currently python and qbe are available).')
 
     arg_parser.add_argument('-v', '--version', action='version', version=f'Dewy {get_version()}', help='Print version information and exit')
     arg_parser.add_argument('-p', '--disable-rich-print', action='store_true', help='Disable using rich for printing stack traces')
     arg_parser.add_argument('args', nargs=REMAINDER, help='Arguments after the file are passed directly to program')
     arg_parser.add_argument('--verbose', action='store_true', help='Print verbose output')
     arg_parser.add_argument('--tokens', action='store_true', help='Print tokens for the input expression')
+    arg_parser.add_argument('--no-cache', action='store_true', help='Always rebuild (or reparse, for the python backend), rather than reusing a cached build of the same source')
+    arg_parser.add_argument('--no-fold', action='store_true', help='Run the program as written, without folding constant expressions or removing branches that are never taken (for debugging)')
+    arg_parser.add_argument('--profile', action='store_true', help='Print the time spent in each stage of the pipeline, and (python backend) in each type of AST node and at each place in the source. The profile is also written as speedscope JSON (see --profile-output)')
+    arg_parser.add_argument('--profile-output', type=Path, default=Path('dewy.speedscope.json'), metavar='PATH', help='File to write the --profile JSON to (default dewy.speedscope.json)')
+    arg_parser.add_argument('--closures', action='store_true', help='Compile each expression into python closures before running it, rather than walking the AST (python backend only)')
 
 
     args = arg_parser.parse_args()
@@ -31,6 +36,8 @@ def main():
     # if file is not provided, ensure that -c and --backend are not provided
     if not args.file and (args.c or args.backend):
         arg_parser.error('Cannot enter REPL mode when -c or --backend is provided')
+    if not args.file and args.profile:
+        arg_parser.error('--profile needs a file to run')
 
     # use rich for pretty traceback printing
     #TODO: maybe add a util or something for trying to import rich and replacing print in all files
@@ -41,7 +48,7 @@ def main():
         except:
             print('rich unavailable for import. using built-in printing')
 
-    options = Options(args.tokens, args.verbose)
+    options = Options(args.tokens, args.verbose, cache=not args.no_cache, closures=args.closures, fold=not args.no_fold, profile=args.profile_output if args.profile else None)
 
     # if no file is provided, enter REPL mode
     if args.file is None:
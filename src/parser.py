@@ -1,7 +1,8 @@
-from typing import Generator, Sequence, cast, Callable as TypingCallable
+from typing import Generator, Iterable, Sequence, cast, Callable as TypingCallable
 from enum import Enum, auto
 from dataclasses import dataclass
 from itertools import groupby, chain as iterchain
+from math import inf
 
 from .syntax import (
     AST,
@@ -30,7 +31,10 @@ from .syntax import (
     DeclareGeneric, Parameterize,
 )
 from .tokenizer import (
+    tokenize, top_level_spans,
+    unary_prefix_operators, unary_postfix_operators, binary_operators,
     Token,
+    WhiteSpace_t,
     Block_t,
     Operator_t,
     ShiftOperator_t,
@@ -49,11 +53,12 @@ from .tokenizer import (
     Keyword_t,
 )
 from .postok import (
+    post_process,
     RangeJuxtapose_t,
     EllipsisJuxtapose_t,
     TypeParamJuxtapose_t,
     BackticksJuxtapose_t,
-    get_next_chain,
+    get_next_chain, get_chains,
     Chain,
     is_op, is_binop, is_unary_prefix_op, is_unary_postfix_op,
     Flow_t,
@@ -87,8 +92,7 @@ def parse_generator(tokens: list[Token]) -> Generator[AST, None, None]:
     Parse all tokens into a sequence of ASTs
     """
 
-    while len(tokens) > 0:
-        chain, tokens = get_next_chain(tokens)
+    for chain in get_chains(tokens):
         yield parse_chain(chain)
 
 
@@ -105,6 +109,92 @@ def parse(tokens: list[Token]) -> AST:
 
     return ast
 
+
+# the only operators that can end a top level expression on their own, i.e. that don't continue onto the next token
+ending_operators = unary_postfix_operators - unary_prefix_operators - binary_operators
+
+# tokens that may continue an expression across whitespace
+continuing_tokens = (Operator_t, ShiftOperator_t, Comma_t, Keyword_t, DotDot_t, DotDotDot_t, Backticks_t)
+
+
+def could_split_between(left: type[Token], left_src: str, right: type[Token]) -> bool:
+    """whether whitespace between two top level tokens may separate two expressions (checked again by parsing the left side)"""
+    if issubclass(left, continuing_tokens) and not (left is Operator_t and left_src in ending_operators):
+        return False
+    return not issubclass(right, continuing_tokens) or right is Keyword_t
+
+
+def parse_lines(lines: Iterable[str]) -> Generator[AST, None, None]:
+    """
+    Parse source that arrives a line at a time (e.g. piped over stdin), yielding each top level expression as soon as the
+    lines that make it up have been read, instead of waiting for the whole source. Yields the same ASTs as parse_generator
+    would for the whole source.
+
+    The source is split at newlines between two top level tokens where an expression can end, and where everything
+    before the split parses on its own. Blocks, strings, etc. spanning several lines are waited on until they close.
+    A type parameter (`<...>`) is only recognized if it closes in the lines read so far.
+    """
+    buffer = ''       # lines read but not yet parsed
+    row = 0           # row of the start of the buffer in the whole source
+    spans = []        # (start, stop, token class) of the top level tokens scanned so far in the buffer
+    scanned = 0       # end of the last scanned token
+    checked = 0       # number of spans already considered as split points
+    retry_at = 0      # buffer length to reach before rescanning a token that couldn't be completed
+
+    for line in lines:
+        buffer += line
+        if len(buffer) < retry_at:
+            continue
+
+        # scan any new tokens. The last token could still continue onto the next line
+        for start, stop, cls in top_level_spans(buffer, scanned):
+            if stop == len(buffer):
+                break
+            spans.append((start, stop, cls))
+            scanned = stop
+        else:
+            # the next token didn't finish (e.g. a block left open). Back off so large ones aren't rescanned every line
+            retry_at = len(buffer) + (len(buffer) - scanned) // 2
+
+        # try splitting at each newline that separates two tokens
+        while checked < len(spans):
+            start, stop, cls = spans[checked]
+            ws = buffer[start:stop]
+            if cls is not WhiteSpace_t or '\n' not in ws or ws.startswith('/{'):
+                checked += 1
+                continue
+            left = next((span for span in reversed(spans[:checked]) if span[2] is not WhiteSpace_t), None)
+            right = next((span for span in spans[checked+1:] if span[2] is not WhiteSpace_t), None)
+            if right is None:
+                break  # wait for the next token
+            checked += 1
+            if left is None or not could_split_between(left[2], buffer[left[0]:left[1]], right[2]):
+                continue
+
+            split = start + ws.index('\n') + 1
+            try:
+                tokens = tokenize(buffer[:split], first_row=row)
+                post_process(tokens)
+                chains = [*get_chains(tokens)]
+            except Exception:
+                continue  # the expression continues past this line, e.g. a flow with its clause on the next line
+
+            for chain in chains:
+                yield parse_chain(chain)
+
+            # keep the rest of the buffer
+            row += buffer.count('\n', 0, split)
+            buffer = buffer[split:]
+            spans = [(max(start - split, 0), stop - split, cls) for start, stop, cls in spans[checked-1:]]
+            scanned -= split
+            retry_at = 0
+            checked = 0
+
+    # everything left once the source ends
+    tokens = tokenize(buffer, first_row=row)
+    post_process(tokens)
+    yield from parse_generator(tokens)
+
 @dataclass
 class qint:
     """
@@ -301,6 +391,84 @@ def operator_associativity(op: Operator_t | int) -> Associativity|set[Associativ
 
 
 def parse_chain(chain: Chain[Token]) -> AST:
+    """
+    Parse a chain in a single pass. The operators are arranged into a tree by precedence climbing over the same
+    precedence/associativity tables that `parse_chain_by_splitting` uses, giving the same splits without rescanning
+    the chain for each sub-expression.
+
+    Wherever a split would be ambiguous or invalid (qint precedences, chained un-associable operators, chains of
+    only unary operators), that sub-chain is handed to `parse_chain_by_splitting`, so errors come out the same.
+    """
+    assert isinstance(chain, Chain), f"ERROR: parse chain must be called on Chain[Token], got {type(chain)}"
+
+    if len(chain) == 0:
+        return void
+    if len(chain) == 1:
+        return parse_single(chain[0])
+
+    idxs = [i for i, token in enumerate(chain) if is_op(token)]
+    if len(idxs) == 0:
+        return parse_chain_by_splitting(chain)
+    ops = [chain[i] for i in idxs]
+    assocs = [operator_associativity(op) for op in ops]
+    ranks = [operator_precedence(op) for op in ops]
+
+    # unary operators are only split on when nothing else is left. qints are ordered by their lowest value
+    keys = [inf if assoc is Associativity.unary else min(rank.values) if isinstance(rank, qint) else rank for assoc, rank in zip(assocs, ranks)]
+
+    # left/right child of each operator, i.e. the lowest precedence operator on either side of it within its sub-chain
+    left = [-1] * len(ops)
+    right = [-1] * len(ops)
+    stack: list[int] = []
+    for k, key in enumerate(keys):
+        child = -1
+        while stack and (keys[stack[-1]] > key or keys[stack[-1]] == key and assocs[k] is not Associativity.right):
+            child = stack.pop()
+        left[k] = child
+        if stack:
+            right[stack[-1]] = k
+        stack.append(k)
+
+    def is_unsplittable(k: int) -> bool:
+        """whether split_by_lowest_precedence wouldn't be able to cleanly split the sub-chain rooted at operator k"""
+        children = [c for c in (left[k], right[k]) if c != -1]
+        if keys[k] is inf:
+            return len(children) > 0
+        if isinstance(ranks[k], qint):
+            return any(keys[c] <= max(ranks[k].values) for c in children)
+        return any(keys[c] == keys[k] and (assocs[k] is Associativity.fail or isinstance(ranks[c], qint)) for c in children)
+
+    def parse_operand(start: int, stop: int) -> AST:
+        if stop - start == 0:
+            return void
+        if stop - start == 1:
+            return parse_single(chain[start])
+        return parse_chain_by_splitting(Chain(chain[start:stop]))
+
+    def parse_subchain(k: int, start: int, stop: int) -> AST:
+        if is_unsplittable(k):
+            return parse_chain_by_splitting(Chain(chain[start:stop]))
+
+        i = idxs[k]
+        l = parse_subchain(left[k], start, i) if left[k] != -1 else parse_operand(start, i)
+        r = parse_subchain(right[k], i + 1, stop) if right[k] != -1 else parse_operand(i + 1, stop)
+
+        assert not (l is void and r is void), f"Internal Error: both left and right returned void during parse chain, implying both left and right side of operator were empty, i.e. chain was invalid: {Chain(chain[start:stop])}"
+
+        if l is void:
+            return build_unary_prefix_expr(chain[i], r)
+        if r is void:
+            return build_unary_postfix_expr(l, chain[i])
+        return build_bin_expr(l, chain[i], r)
+
+    return parse_subchain(stack[0], 0, len(chain))
+
+
+def parse_chain_by_splitting(chain: Chain[Token]) -> AST:
+    """
+    Parse a chain by recursively splitting at the lowest precedence operator, rescanning each sub-chain.
+    Reference implementation for `parse_chain`, which falls back to it for sub-chains that can't be cleanly split
+    """
     assert isinstance(chain, Chain), f"ERROR: parse chain must be called on Chain[Token], got {type(chain)}"
 
     if len(chain) == 0:
@@ -315,7 +483,7 @@ def parse_chain(chain: Chain[Token]) -> AST:
         ... #TODO: handle ambiguous precedence error by making a QAST
         return build_quantum_expr(e.ops, e.ranks, e.assocs, e.tokens)
 
-    left, right = parse_chain(left), parse_chain(right)
+    left, right = parse_chain_by_splitting(left), parse_chain_by_splitting(right)
 
     assert not (left is void and right is void), f"Internal Error: both left and right returned void during parse chain, implying both left and right side of operator were empty, i.e. chain was invalid: {chain}"
 
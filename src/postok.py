@@ -1,5 +1,5 @@
 from .tokenizer import (
-    tokenize, tprint, full_traverse_tokens,
+    tokenize, tprint,
     unary_prefix_operators,
     unary_postfix_operators,
     binary_operators,
@@ -254,95 +254,52 @@ class ShouldBreakFlowTracker(ShouldBreakTracker):
                 raise ValueError("should not be seeing if/loop/lazy here. Everything should be bundled up into a flow")
 
 
-def invert_whitespace(tokens: list[Token]) -> None:
-    """
-    removes all whitespace tokens, and insert juxtapose tokens between adjacent pairs (i.e. not separated by whitespace)
-
-    Args:
-        tokens (list[Token]): list of tokens to modify. This is modified in place.
-    """
-
-    # juxtapose singleton token so we aren't wasting memory
-    jux = Juxtapose_t(None)
-
-    i = 0
-    while i < len(tokens):
-        # delete whitespace if it comes up
-        if isinstance(tokens[i], WhiteSpace_t):
-            tokens.pop(i)
-            continue
-
-        # recursively handle inverting whitespace for blocks
-        if isinstance(tokens[i], (Block_t, TypeParam_t)):
-            invert_whitespace(tokens[i].body)
-        elif isinstance(tokens[i], String_t):
-            for child in tokens[i].body:
-                if isinstance(child, Block_t):
-                    invert_whitespace(child.body)
-
-        # insert juxtapose if no whitespace between tokens
-        if i + 1 < len(tokens) and not isinstance(tokens[i + 1], WhiteSpace_t):
-            tokens.insert(i + 1, jux)
-            i += 1
-        i += 1
-
-    # finally, remove juxtapose tokens next to operators that are not whitespace sensitive
-    i = 1
-    while i < len(tokens) - 1:
-        left, middle, right = tokens[i-1:i+2]
-        #TODO: somewhere around here, need to fix how @ isn't juxtaposable but should be on the left depending on lots of stuff...
-        if isinstance(middle, Juxtapose_t) \
-        and (isinstance(left, non_jux_ops) or isinstance(right, non_jux_ops))\
-        and not isinstance(left, jux_atoms) and not isinstance(right, jux_atoms):
-            tokens.pop(i)
-            continue
-        i += 1
-
+# the chain helpers take the index in tokens to start from, and return the index after what they consumed
 
-def _get_next_prefixes(tokens: list[Token]) -> tuple[list[Token], list[Token]]:
+def _get_next_prefixes(tokens: list[Token], i: int) -> tuple[list[Token], int]:
     prefixes = []
-    while len(tokens) > 0 and is_unary_prefix_op(tokens[0]):
-        prefixes.append(tokens.pop(0))
+    while i < len(tokens) and is_unary_prefix_op(tokens[i]):
+        prefixes.append(tokens[i])
+        i += 1
 
-    return prefixes, tokens
+    return prefixes, i
 
 
-def _get_next_postfixes(tokens: list[Token]) -> tuple[list[Token], list[Token]]:
+def _get_next_postfixes(tokens: list[Token], i: int) -> tuple[list[Token], int]:
     postfixes = []
-    while len(tokens) > 0 and is_unary_postfix_op(tokens[0], exclude_semicolon=True):
-        postfixes.append(tokens.pop(0))
+    while i < len(tokens) and is_unary_postfix_op(tokens[i], exclude_semicolon=True):
+        postfixes.append(tokens[i])
+        i += 1
 
-    return postfixes, tokens
+    return postfixes, i
 
 
-def _get_next_atom(tokens: list[Token]) -> tuple[Token, list[Token]]:
-    if len(tokens) == 0:
-        raise ValueError(f"ERROR: expected atom, got {tokens=}")
+def _get_next_atom(tokens: list[Token], i: int) -> tuple[Token, int]:
+    if i == len(tokens):
+        raise ValueError(f"ERROR: expected atom, got tokens={tokens[i:]}")
 
     # TODO: this is going to be unnecessary as expressions will have been bundled up into single tokens
-    if isinstance(tokens[0], Keyword_t):
-        return _get_next_keyword_expr(tokens)
+    if isinstance(tokens[i], Keyword_t):
+        return _get_next_keyword_expr(tokens, i)
 
-    if isinstance(tokens[0], atom_tokens):
-        return tokens[0], tokens[1:]
+    if isinstance(tokens[i], atom_tokens):
+        return tokens[i], i + 1
 
-    raise ValueError(f"ERROR: expected atom, got {tokens[0]=}")
+    raise ValueError(f"ERROR: expected atom, got tokens[0]={tokens[i]!r}")
 
 
-def _get_next_chunk(tokens: list[Token]) -> tuple[list[Token], list[Token]]:
+def _get_next_chunk(tokens: list[Token], i: int) -> tuple[list[Token], int]:
     chunk = []
-    t, tokens = _get_next_prefixes(tokens)
+    t, i = _get_next_prefixes(tokens, i)
     chunk.extend(t)
 
-    t, tokens = _get_next_atom(tokens)
-    if t is None:
-        raise ValueError(f"ERROR: expected atom, got {tokens[0]=}")
+    t, i = _get_next_atom(tokens, i)
     chunk.append(t)
 
-    t, tokens = _get_next_postfixes(tokens)
+    t, i = _get_next_postfixes(tokens, i)
     chunk.extend(t)
 
-    return chunk, tokens
+    return chunk, i
 
 
 def is_unary_prefix_op(token: Token) -> bool:
@@ -381,25 +338,25 @@ def is_opchain_starter(token: Token) -> bool:
     return isinstance(token, Operator_t) and token.op in opchain_starters
 
 
-def _get_next_keyword_expr(tokens: list[Token]) -> tuple[Token, list[Token]]:
+def _get_next_keyword_expr(tokens: list[Token], i: int) -> tuple[Token, int]:
     """package up the next keyword expression into a single token"""
-    if len(tokens) == 0:
-        raise ValueError(f"ERROR: expected keyword expression, got {tokens=}")
-    t, tokens = tokens[0], tokens[1:]
+    if i == len(tokens):
+        raise ValueError(f"ERROR: expected keyword expression, got tokens={tokens[i:]}")
+    t, i = tokens[i], i + 1
 
     if not isinstance(t, Keyword_t):
         raise ValueError(f"ERROR: expected keyword expression, got {t=}")
 
     match t:
         case Keyword_t(src='if' | 'loop' | 'lazy'):
-            cond, tokens = get_next_chain(tokens)
-            clause, tokens = get_next_chain(tokens, tracker=ShouldBreakFlowTracker())
-            return Flow_t(t, cond, clause), tokens
+            cond, i = _get_next_chain(tokens, i)
+            clause, i = _get_next_chain(tokens, i, tracker=ShouldBreakFlowTracker())
+            return Flow_t(t, cond, clause), i
         case Keyword_t(src='closing_else'):
-            clause, tokens = get_next_chain(tokens, tracker=ShouldBreakFlowTracker())
-            return Flow_t(None, None, clause), tokens
+            clause, i = _get_next_chain(tokens, i, tracker=ShouldBreakFlowTracker())
+            return Flow_t(None, None, clause), i
         case Keyword_t(src='do'):
-            clause, tokens = get_next_chain(tokens)
+            clause, i = _get_next_chain(tokens, i)
             # assert next token is a do_keyward
             # depending on the keyward, get a condition, or condition+clause
             pdb.set_trace()
@@ -412,8 +369,8 @@ def _get_next_keyword_expr(tokens: list[Token]) -> tuple[Token, list[Token]]:
             pdb.set_trace()
             ...
         case Keyword_t(src='let' | 'const' | 'local_const' | 'fixed_type'):
-            expr, tokens = get_next_chain(tokens)
-            return Declare_t(t, expr), tokens
+            expr, i = _get_next_chain(tokens, i)
+            return Declare_t(t, expr), i
 
 
     raise NotImplementedError("TODO: handle keyword based expressions")
@@ -441,6 +398,20 @@ def get_next_chain(tokens: list[Token], *, tracker: ShouldBreakTracker = None, o
     Returns:
         next, rest (list[Token], list[Token]): the next chain of tokens, and the remaining tokens
     """
+    chain, i = _get_next_chain(tokens, 0, tracker=tracker, op_blacklist=op_blacklist)
+    return chain, tokens[i:]
+
+
+def get_chains(tokens: list[Token]) -> Generator[Chain[Token], None, None]:
+    """split a whole list of tokens into consecutive chains (without copying the rest of the list for each one)"""
+    i = 0
+    while i < len(tokens):
+        chain, i = _get_next_chain(tokens, i)
+        yield chain
+
+
+def _get_next_chain(tokens: list[Token], i: int, *, tracker: ShouldBreakTracker = None, op_blacklist: set[Token] = None) -> tuple[Chain[Token], int]:
+    """get_next_chain starting from tokens[i]. Returns the chain and the index after it"""
 
     if op_blacklist is None:
         op_blacklist = set()
@@ -448,177 +419,264 @@ def get_next_chain(tokens: list[Token], *, tracker: ShouldBreakTracker = None, o
     chain = []
 
     # grab the first chunk and let the tracker view it
-    chunk, tokens = _get_next_chunk(tokens)
+    chunk, i = _get_next_chunk(tokens, i)
     chain.extend(chunk)
     if tracker is not None:
         tracker.view(chunk)
 
-    while len(tokens) > 0 and is_binop(tokens[0]) and (tracker is None or not tracker.op_breaks_chain(tokens[0])) and tokens[0] not in op_blacklist:
+    while i < len(tokens) and is_binop(tokens[i]) and (tracker is None or not tracker.op_breaks_chain(tokens[i])) and tokens[i] not in op_blacklist:
         # get the operator, and continuing chunk, then let the tracker view it
-        chain.append(tokens.pop(0))
-        chunk, tokens = _get_next_chunk(tokens)
+        chain.append(tokens[i])
+        chunk, i = _get_next_chunk(tokens, i + 1)
         chain.extend(chunk)
         if tracker is not None:
             tracker.view(chunk)
 
     # if there's a semicolon, it ends the chain
-    if len(tokens) > 0 and isinstance(tokens[0], Operator_t) and tokens[0].op == ';':
-        chain.append(tokens.pop(0))
+    if i < len(tokens) and isinstance(tokens[i], Operator_t) and tokens[i].op == ';':
+        chain.append(tokens[i])
+        i += 1
 
-    return Chain(chain), tokens
+    return Chain(chain), i
 
 
-def narrow_juxtapose(tokens: list[Token]) -> None:
+def post_process(tokens: list[Token]) -> None:
+    """
+    post process the tokens to make them ready for parsing. This is modified in place.
+
+    - whitespace is removed, and juxtapose tokens are inserted between tokens that were touching (except next to
+      operators that aren't whitespace sensitive)
+    - flows (if/loop/lazy, and any else after them) are bundled into single Flow_t tokens
+    - op chains (a binary op followed by unary prefix ops), broadcast ops (.<op>) and combined assignments (<op>=)
+      are each combined into a single token
+    - juxtaposes next to ranges, ellipses, type params and backticks are narrowed to the specific juxtapose for them
     """
-    range juxtapose:
-    convert [<token>, <jux>, <..>] into [<token>, <range_jux>, <..>]
-    convert [<..>, <jux>, <token>] into [<..>, <range_jux>, <token>]
-    if .. doesn't connect to anything on the left or right, connect it to undefined
 
-    ellipsis juxtapose:
-    convert [<...>, <jux>, <token>] into [<...>, <ellipsis_jux>, <token>]
+    # remove whitespace, insert juxtapose tokens, and find any instances of <else> without a flow keyword after
+    tokens[:] = _separate_tokens(tokens)
+
+    if len(tokens) == 0:
+        return
+
+    # bundle up conditionals into single token expressions
+    tokens[:] = _bundle_conditionals(tokens)
+
+    # combine operators (opchains, broadcasts, combined assignments) and convert juxtaposes to more specific types
+    _FinalPass().run(tokens)
 
-    type param juxtapose:
-    convert [<token>, <jux>, <type_param>] into [<token>, <type_param_jux>, <type_param>]
-    convert [<type_param>, <jux>, <token>] into [<type_param>, <type_param_jux>, <token>]
-    """
-    range_jux = RangeJuxtapose_t(None)
-    ellipsis_jux = EllipsisJuxtapose_t(None)
-    backticks_jux = BackticksJuxtapose_t(None)
-    type_param_jux = TypeParamJuxtapose_t(None)
-    undefined = Undefined_t(None)
-    for i, token, stream in (gen := full_traverse_tokens(tokens)):
-        left_is_jux = i > 0 and isinstance(stream[i-1], Juxtapose_t)
-        right_is_jux = i + 1 < len(stream) and isinstance(stream[i+1], Juxtapose_t)
-
-        # handle range jux
-        if isinstance(token, DotDot_t):
-            if i + 1 < len(stream):
-                if isinstance(stream[i+1], Juxtapose_t):
-                    stream[i+1] = range_jux
-                else:
-                    stream[i+1:i+1] = [range_jux, undefined]
-            if i > 0:
-                if isinstance(stream[i-1], Juxtapose_t):
-                    stream[i-1] = range_jux
-                else:
-                    stream[i:i] = [undefined, range_jux]
-                    gen.send(i+3)
-
-        # handle ellipsis jux
-        elif isinstance(token, DotDotDot_t):
-            # ellipsis can be optionally juxtaposed, but when it is juxtaposed, it may only be juxtaposed on one side
-            if left_is_jux and right_is_jux:
-                raise ValueError(f"ERROR: ellipsis operator {token} must be juxtaposed on either zero or one side. Got ...{stream[i-2:i+3]}...")
-            if left_is_jux:
-                stream[i-1] = ellipsis_jux
-            if right_is_jux:
-                stream[i+1] = ellipsis_jux
-
-        # handle type param jux
-        elif isinstance(token, TypeParam_t):
-            if left_is_jux:
-                stream[i-1] = type_param_jux
-            elif right_is_jux:
-                stream[i+1] = type_param_jux
-
-        # handle backticks jux
-        elif isinstance(token, Backticks_t):
-            # only left or right can be juxtaposed, but not both, and not neither
-            if (left_is_jux and right_is_jux) or (not left_is_jux and not right_is_jux):
-                raise ValueError(f"ERROR: backticks operator {token} must be juxtaposed on a exactly one side. Got ...{stream[i-2:i+3]}...")
-
-            if left_is_jux:
-                stream[i-1] = backticks_jux
-            elif right_is_jux:
-                stream[i+1] = backticks_jux
-
-
-
-def convert_bare_else(tokens: list[Token]) -> None:
-    """
-    convert any instances of `else` without a flow keyword after, and convert to `else` `if` `true`
-    """
-    for i, token, stream in (gen := full_traverse_tokens(tokens)):
-        if isinstance(token, Operator_t) and token.op == 'else':
-            if i+1 < len(stream) and isinstance(stream[i+1], Keyword_t) and stream[i+1].src in ('if', 'loop', 'lazy'):
-                continue
-            # stream[i+1:i+1] = [Keyword_t('if'), Boolean_t('true')]
-            stream.insert(i+1, Keyword_t('closing_else'))
 
+# tokens that hold lists of other tokens
+container_tokens = (Block_t, TypeParam_t, String_t, Flow_t, Declare_t)
+flow_keywords = ('if', 'loop', 'lazy')
 
-def bundle_conditionals(tokens: list[Token]) -> None:
+
+def _separate_tokens(tokens: list[Token]) -> list[Token]:
     """
-    Convert sequences of tokens that represent conditionals (if, loop, etc.) into a single expression token
+    first pass over a list (and its blocks): drop whitespace, juxtapose the tokens that were touching, and mark each
+    `else` without a flow keyword after it with a closing_else keyword
     """
-    for i, token, stream in (gen := full_traverse_tokens(tokens)):
-        if isinstance(token, Keyword_t) and token.src in ('if', 'loop', 'lazy'):
-            flow_chain, tokens = get_next_chain(stream[i:])
-            stream[i] = flow_chain[0]
-            stream[i+1:] = [*flow_chain[1:], *tokens]
-
-
-def make_chain_operators(tokens: list[Token]) -> None:
-    """Convert consecutive operator tokens into a single opchain token"""
-    for i, token, stream in (gen := full_traverse_tokens(tokens)):
-        if is_opchain_starter(token):
-            j = 1
-            while i+j < len(stream) and is_unary_prefix_op(stream[i+j]):
-                j += 1
-            if j > 1:
-                # convert the prefix operators into a single token
-                stream[i:i+j] = [OpChain_t([stream[i+k] for k in range(j)])]
-                gen.send(i+j)
-                continue
+    jux = Juxtapose_t(None)
+    result = []
+    after_whitespace = True
+
+    def append(token: Token):
+        if result and isinstance(result[-1], Operator_t) and result[-1].op == 'else' \
+        and not (isinstance(token, Keyword_t) and token.src in flow_keywords):
+            result.append(Keyword_t('closing_else'))
+        result.append(token)
+
+    for token in tokens:
+        if isinstance(token, WhiteSpace_t):
+            after_whitespace = True
+            continue
 
-def make_broadcast_operators(tokens: list[Token]) -> None:
-    """Convert any . operator next to a binary operator or opchain into a broadcast operator"""
-    for i, token, stream in (gen := full_traverse_tokens(tokens)):
-        if isinstance(token, Operator_t) and token.op == '.':
-            if len(stream) > i+1 and is_binop(stream[i+1]) or isinstance(stream[i+1], OpChain_t):
-                stream[i:i+2] = [BroadcastOp_t(token, stream[i+1])]
-                gen.send(i+2)
-
-def make_combined_assignment_operators(tokens: list[Token]) -> None:
-    """Convert any combined assignment operators into a single token"""
-    for i, token, stream in (gen := full_traverse_tokens(tokens)):
-        if is_binop(token) or isinstance(token, OpChain_t) or isinstance(token, BroadcastOp_t):
-            if i+1 < len(stream) and isinstance(stream[i+1], Operator_t) and stream[i+1].op == '=':
-                stream[i:i+2] = [CombinedAssignmentOp_t(token, stream[i+1])]
-                gen.send(i+2)
+        # recursively handle blocks
+        if isinstance(token, (Block_t, TypeParam_t)):
+            token.body = _separate_tokens(token.body)
+        elif isinstance(token, String_t):
+            for child in token.body:
+                if isinstance(child, Block_t):
+                    child.body = _separate_tokens(child.body)
 
-def post_process(tokens: list[Token]) -> None:
-    """post process the tokens to make them ready for parsing"""
+        # juxtapose tokens that weren't separated by whitespace, except next to operators that are not whitespace sensitive
+        if result and not after_whitespace:
+            left = result[-1]
+            if not (isinstance(left, non_jux_ops) or isinstance(token, non_jux_ops)) \
+            or isinstance(left, jux_atoms) or isinstance(token, jux_atoms):
+                append(jux)
+        append(token)
+        after_whitespace = False
 
-    # remove whitespace, and insert juxtapose tokens
-    invert_whitespace(tokens)
+    if result and isinstance(result[-1], Operator_t) and result[-1].op == 'else':
+        result.append(Keyword_t('closing_else'))
 
-    if len(tokens) == 0:
-        return
+    return result
 
-    # find any instances of <else> without a flow keyword after, and convert to <else> <if> <true>
-    convert_bare_else(tokens)
 
-    # bundle up conditionals into single token expressions
-    bundle_conditionals(tokens)
+def _bundle_conditionals(tokens: list[Token]) -> list[Token]:
+    """bundle each flow keyword and the rest of its chain into a Flow_t, in a list (and any lists inside of its tokens)"""
+    result = []
+    i = 0
+    while i < len(tokens):
+        token = tokens[i]
+        if isinstance(token, Keyword_t) and token.src in flow_keywords:
+            # the flow's own contents are left as is. The rest of its chain is handled like any other tokens
+            flow_chain, i = _get_next_chain(tokens, i)
+            result.append(flow_chain[0])
+            for token in flow_chain[1:]:
+                _bundle_children(token)
+                result.append(token)
+            continue
 
-    # combine operator chains into a single operator token
-    make_chain_operators(tokens)
+        _bundle_children(token)
+        result.append(token)
+        i += 1
 
-    # convert any . operator next to a binary operator or opchain (e.g. .+ .^/-) into a broadcast operator
-    make_broadcast_operators(tokens)
+    return result
 
-    # convert any combined assignment operators (e.g. += -= etc.) into a single token
-    make_combined_assignment_operators(tokens)
 
-    # convert juxtapose tokens to more specific types if possible
-    narrow_juxtapose(tokens)
+def _bundle_children(token: Token):
+    if isinstance(token, container_tokens):
+        for children in token:
+            children[:] = _bundle_conditionals(children)
 
 
-    # make the actual list of chains
+class _FinalPass:
+    """
+    last pass: combine op chains, then broadcast ops, then combined assignments, and narrow juxtaposes, applied in that
+    order to each list, with each step building a new list
+    """
+
+    def __init__(self):
+        self.range_jux = RangeJuxtapose_t(None)
+        self.ellipsis_jux = EllipsisJuxtapose_t(None)
+        self.backticks_jux = BackticksJuxtapose_t(None)
+        self.type_param_jux = TypeParamJuxtapose_t(None)
+        self.undefined = Undefined_t(None)
+
+    def run(self, tokens: list[Token]) -> None:
+        for token in tokens:
+            if isinstance(token, container_tokens):
+                for children in token:
+                    self.run(children)
+
+        tokens[:] = self.narrow_juxtapose(self.combine_assignments(self.broadcast_ops(self.chain_ops(tokens))))
+
+    @staticmethod
+    def chain_ops(tokens: list[Token]) -> list[Token]:
+        result = []
+        i = 0
+        while i < len(tokens):
+            token = tokens[i]
+            if is_opchain_starter(token):
+                j = i + 1
+                while j < len(tokens) and is_unary_prefix_op(tokens[j]):
+                    j += 1
+                if j > i + 1:
+                    result.append(OpChain_t(tokens[i:j]))
+                    i = j
+                    continue
+            result.append(token)
+            i += 1
+        return result
+
+    @staticmethod
+    def broadcast_ops(tokens: list[Token]) -> list[Token]:
+        result = []
+        i = 0
+        while i < len(tokens):
+            token = tokens[i]
+            if isinstance(token, Operator_t) and token.op == '.' and i + 1 < len(tokens) and is_binop(tokens[i+1]):
+                result.append(BroadcastOp_t(token, tokens[i+1]))
+                i += 2
+                continue
+            result.append(token)
+            i += 1
+        return result
+
+    @staticmethod
+    def combine_assignments(tokens: list[Token]) -> list[Token]:
+        result = []
+        i = 0
+        while i < len(tokens):
+            token = tokens[i]
+            if (is_binop(token) or isinstance(token, (OpChain_t, BroadcastOp_t))) \
+            and i + 1 < len(tokens) and isinstance(tokens[i+1], Operator_t) and tokens[i+1].op == '=':
+                result.append(CombinedAssignmentOp_t(token, tokens[i+1]))
+                i += 2
+                continue
+            result.append(token)
+            i += 1
+        return result
+
+    def narrow_juxtapose(self, tokens: list[Token]) -> list[Token]:
+        """
+        range juxtapose:
+        convert [<token>, <jux>, <..>] into [<token>, <range_jux>, <..>]
+        convert [<..>, <jux>, <token>] into [<..>, <range_jux>, <token>]
+        if .. doesn't connect to anything on the left or right, connect it to undefined
+
+        ellipsis juxtapose:
+        convert [<...>, <jux>, <token>] into [<...>, <ellipsis_jux>, <token>]
+
+        type param juxtapose:
+        convert [<token>, <jux>, <type_param>] into [<token>, <type_param_jux>, <type_param>]
+        convert [<type_param>, <jux>, <token>] into [<type_param>, <type_param_jux>, <token>]
+        """
+        result = []
+        replace_next = None  # replacement for the next token, set when a token narrows the juxtapose to its right
+        for i, token in enumerate(tokens):
+            if replace_next is not None:
+                token, replace_next = replace_next, None
+            left_is_jux = len(result) > 0 and isinstance(result[-1], Juxtapose_t)
+            right_is_jux = i + 1 < len(tokens) and isinstance(tokens[i+1], Juxtapose_t)
+
+            # handle range jux
+            if isinstance(token, DotDot_t):
+                if len(result) > 0:
+                    if left_is_jux:
+                        result[-1] = self.range_jux
+                    else:
+                        result.extend([self.undefined, self.range_jux])
+                result.append(token)
+                if i + 1 < len(tokens):
+                    if right_is_jux:
+                        replace_next = self.range_jux
+                    else:
+                        result.extend([self.range_jux, self.undefined])
+                continue
 
-    # based on types, replace jux with jux_mul or jux_call
-    # TODO: actually this probably would need to be done during parsing, since we can't get a type for a complex/compound expression...
+            # handle ellipsis jux
+            elif isinstance(token, DotDotDot_t):
+                # ellipsis can be optionally juxtaposed, but when it is juxtaposed, it may only be juxtaposed on one side
+                if left_is_jux and right_is_jux:
+                    raise ValueError(f"ERROR: ellipsis operator {token} must be juxtaposed on either zero or one side. Got ...{[*result[-2:], *tokens[i:i+3]]}...")
+                if left_is_jux:
+                    result[-1] = self.ellipsis_jux
+                if right_is_jux:
+                    replace_next = self.ellipsis_jux
+
+            # handle type param jux
+            elif isinstance(token, TypeParam_t):
+                if left_is_jux:
+                    result[-1] = self.type_param_jux
+                elif right_is_jux:
+                    replace_next = self.type_param_jux
+
+            # handle backticks jux
+            elif isinstance(token, Backticks_t):
+                # only left or right can be juxtaposed, but not both, and not neither
+                if (left_is_jux and right_is_jux) or (not left_is_jux and not right_is_jux):
+                    raise ValueError(f"ERROR: backticks operator {token} must be juxtaposed on a exactly one side. Got ...{[*result[-2:], *tokens[i:i+3]]}...")
+
+                if left_is_jux:
+                    result[-1] = self.backticks_jux
+                elif right_is_jux:
+                    replace_next = self.backticks_jux
+
+            result.append(token)
+
+        return result
 
 
 def test():
@@ -21,13 +21,14 @@ from .syntax import (
     And, Or, Xor, Nand, Nor, Xnor,
     Not, UnaryPos, UnaryNeg, UnaryMul, UnaryDiv, AtHandle,
     CycleLeft, CycleRight, Suppress,
-    BroadcastOp,
+    BinOp, UnaryPrefixOp, BroadcastOp,
     DeclarationType,
     DeclareGeneric, Parameterize,
 )
 from .parser import QJux
 
-from typing import Callable as TypingCallable
+from typing import Callable as TypingCallable, Literal
+from functools import cache
 from dataclasses import field
 import pdb
 
@@ -283,3 +284,155 @@ def normalize_function_args(signature: AST) -> Signature:
     return Signature(pkwargs, pargs, kwargs)
 
 
+
+
+############################ Constant folding ############################
+# An optional pass over post parsed ASTs (see Options.fold) that does work the backends would otherwise redo every time
+# the code runs: operators over literal operands are computed once, uses of `const` names declared with a literal are
+# replaced by the literal, and flow branches whose conditions are literal bools are resolved.
+
+# folded Ints are limited to what the qbe backend's tagged ints can represent (61-bit), so that every backend agrees with the fold
+min_folded_int, max_folded_int = -(1 << 60), (1 << 60) - 1
+
+def is_literal(ast: AST) -> bool:
+    return type(ast) in (Int, Bool, String) and (type(ast) is not Int or (type(ast.val) is int and min_folded_int <= ast.val <= max_folded_int))
+
+
+def fold_constants(ast: AST, consts: dict[str, AST] | None = None) -> AST:
+    """
+    Fold the constant parts of a post parsed AST.
+
+    Args:
+        ast: AST - the (top level) expression to fold
+        consts: dict[str, AST] - literal values of the consts declared before ast at the top level. Updated with the ones
+            ast declares, so that a program arriving one top level expression at a time can share them
+    """
+    if consts is None:
+        consts = {}
+    return fold_sequence([ast], consts)[0]
+
+
+def fold_sequence(items: list[AST], consts: dict[str, AST]) -> list[AST]:
+    """fold the expressions of a group/block in order, adding each const they declare to consts for the later ones"""
+    for i, item in enumerate(items):
+        # const uses aren't replaced in anything that (re)binds the same name, e.g. a shadowing declaration or function argument
+        if consts and (bound := bound_names(item)) & consts.keys():
+            for name in bound:
+                consts.pop(name, None)
+        items[i] = item = fold(item, consts)
+
+        match item:
+            case Declare(decltype=DeclarationType.CONST, target=Assign(left=Identifier(name), right=value)) if is_literal(value):
+                consts[name] = value
+    return items
+
+
+def bound_names(ast: AST) -> set[str]:
+    """names of all identifiers in ast that aren't just being expressed (i.e. ones that may be declared, assigned, etc.)"""
+    names = set()
+    def collect(ast: AST):
+        if isinstance(ast, Express):
+            return
+        if isinstance(ast, Identifier):
+            names.add(ast.name)
+            return
+        for child in ast.__iter_asts__():
+            collect(child)
+    collect(ast)
+    return names
+
+
+def fold(ast: AST, consts: dict[str, AST]) -> AST:
+    """fold ast and its children, returning the AST to replace it with"""
+    # checked by exact type, since isinstance on the (abstract) AST classes is slow for every node of a big program
+    cls = type(ast)
+    if cls is Express:
+        return consts.get(ast.id.name, ast)
+    if cls is Group or cls is Block:
+        # consts declared inside don't leak out, since a group may be a function body, etc.
+        fold_sequence(ast.items, {**consts})
+        if cls is Group and len(ast.items) == 1 and is_literal(ast.items[0]):
+            return ast.items[0]
+        return ast
+    if cls is Flow:
+        # the branches themselves are resolved together by fold_flow
+        for branch in ast.branches:
+            fold_children(branch, consts)
+        return fold_flow(ast)
+    if cls is BroadcastOp:
+        # the op is applied elementwise, so only its operands can be folded
+        fold_children(ast.op, consts)
+        return ast
+
+    fold_children(ast, consts)
+    match operator_kind(cls):
+        case 'binary' if is_literal(ast.left) and is_literal(ast.right):
+            return fold_binop(ast, ast.left, ast.right)
+        case 'unary' if is_literal(ast.operand):
+            return fold_unary(ast, ast.operand)
+    if cls is If and type(ast.condition) is Bool:
+        # evaluated in its own scope, as the if's body would be
+        return Block([ast.body]) if ast.condition.val else void
+    return ast
+
+
+@cache
+def operator_kind(cls: type[AST]) -> Literal['binary', 'unary'] | None:
+    if issubclass(cls, BinOp):
+        return 'binary'
+    if issubclass(cls, UnaryPrefixOp):
+        return 'unary'
+    return None
+
+
+def fold_children(ast: AST, consts: dict[str, AST]) -> None:
+    for _, child in (gen := ast.__iter_members__()):
+        if isinstance(child, AST) and (folded := fold(child, consts)) is not child:
+            gen.send(folded)
+
+
+def fold_binop(op: BinOp, left: AST, right: AST) -> AST:
+    # don't compute results that couldn't be represented anyway
+    if isinstance(op, (Pow, LeftShift)) and type(right.val) is int and right.val > 61:
+        return op
+
+    # folded with the python backend's own dispatch, so that folding doesn't change what any operator does
+    from .backend.python import dispatch_binary
+    try:
+        result = dispatch_binary(op, left, right)
+    except Exception:
+        return op # e.g. ops not defined over these types. Left alone to raise the error at runtime
+    return result if is_literal(result) else op
+
+
+def fold_unary(op: UnaryPrefixOp, operand: AST) -> AST:
+    from .backend.python import dispatch_unary
+    try:
+        result = dispatch_unary(op, operand)
+    except Exception:
+        return op
+    return result if is_literal(result) else op
+
+
+def fold_flow(flow: Flow) -> AST:
+    """drop the branches that are never entered, and any after a branch that always is"""
+    branches = []
+    for branch in flow.branches:
+        match branch:
+            case If(condition=Bool(val=False)) | Loop(condition=Bool(val=False)):
+                continue
+            case If(condition=Bool(val=True), body=body):
+                branches.append(Default(body))
+                break
+            case Default():
+                branches.append(branch)
+                break
+            case _:
+                branches.append(branch)
+
+    if len(branches) == 0:
+        return void
+    if isinstance(branches[0], Default):
+        return Block([branches[0].body])
+    flow.branches = branches
+    return flow
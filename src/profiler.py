@@ -0,0 +1,237 @@
+"""
+Profiling for `--profile`: the wall time and allocations of each stage of the pipeline, and (for the python backend) the
+number of evaluations and time spent in each type of AST node, and at each place in the source
+
+The results are printed as tables to stderr, and written as a speedscope (https://www.speedscope.app) JSON file, with
+one profile of the stages and one of the evaluation, where each frame is an AST node type at a location in the source.
+
+Node timings come from wrapping `evaluate` while the program runs, so they include the overhead of the wrapper, and
+only cover the parts of the program that are walked by `evaluate` (not code compiled with --closures).
+"""
+
+from contextlib import contextmanager
+from dataclasses import dataclass, field
+from pathlib import Path
+from time import perf_counter
+from types import ModuleType
+from typing import Iterator
+import gc
+import json
+import sys
+
+from .syntax import AST
+from .utils import CoordString
+
+
+Loc = tuple[int, int] | None
+
+
+@dataclass(slots=True)
+class StageTiming:
+    name: str
+    start: float      # seconds since the profiler was made
+    seconds: float
+    blocks: int       # net memory blocks allocated over the stage (sys.getallocatedblocks)
+    collections: int  # garbage collections run during the stage
+
+
+@dataclass(slots=True)
+class NodeTiming:
+    count: int = 0
+    total: float = 0.0  # including the time spent evaluating child nodes (nested evaluations of the same type count once)
+    self: float = 0.0   # excluding the time spent evaluating child nodes
+
+
+@dataclass(slots=True)
+class CallTree:
+    """evaluations of an AST node type at a location, under the chain of evaluations that led to it"""
+    count: int = 0
+    self: float = 0.0
+    children: dict[tuple[type[AST], Loc], 'CallTree'] = field(default_factory=dict)
+
+    def walk(self, path: tuple[tuple[type[AST], Loc], ...] = ()) -> Iterator[tuple[tuple[tuple[type[AST], Loc], ...], 'CallTree']]:
+        """every node below this one, with the path of (type, location) keys leading to it"""
+        for key, child in self.children.items():
+            child_path = (*path, key)
+            yield child_path, child
+            yield from child.walk(child_path)
+
+
+def source_loc(ast: AST) -> Loc:
+    """(row, col) of the first identifier or string from the source found in ast, if any"""
+    for name in ast._fields:
+        value = getattr(ast, name)
+        for item in (value if isinstance(value, list) else (value,)):
+            if isinstance(item, CoordString):
+                if len(item) > 0:
+                    return item.loc(0)
+            elif isinstance(item, AST) and (loc := source_loc(item)) is not None:
+                return loc
+    return None
+
+
+def gc_collections() -> int:
+    return sum(gen['collections'] for gen in gc.get_stats())
+
+
+class Profiler:
+    def __init__(self, path: str = '<string>'):
+        self.path = path  # source file the locations refer to
+        self.t0 = perf_counter()
+        self.stages: list[StageTiming] = []
+        self.tree = CallTree()
+        self._totals: dict[type[AST], list] = {}  # type -> [evaluations on the stack, total time]
+        self._locs: dict[int, tuple[AST, Loc]] = {}  # keeps each cached node alive, so its id isn't reused
+
+    @contextmanager
+    def stage(self, name: str) -> Iterator[None]:
+        blocks, collections = sys.getallocatedblocks(), gc_collections()
+        start = perf_counter()
+        try:
+            yield
+        finally:
+            end = perf_counter()
+            self.stages.append(StageTiming(
+                name, start - self.t0, end - start, sys.getallocatedblocks() - blocks, gc_collections() - collections
+            ))
+
+    def location(self, ast: AST) -> Loc:
+        if (cached := self._locs.get(id(ast))) is not None:
+            return cached[1]
+        loc = source_loc(ast)
+        # nodes of the program keep their dispatched eval function. Values made while running are mostly seen once
+        if getattr(ast, '_eval_fn', None) is not None:
+            self._locs[id(ast)] = (ast, loc)
+        return loc
+
+    @contextmanager
+    def instrument(self, module: ModuleType) -> Iterator[None]:
+        """time every call to module.evaluate (which eval functions look up as a global, so nested calls are timed too)"""
+        evaluate = module.evaluate
+        totals = self._totals
+        current = self.tree
+
+        def profiled_evaluate(ast: AST, scope):
+            nonlocal current
+            ast_type = type(ast)
+            if (total := totals.get(ast_type)) is None:
+                total = totals[ast_type] = [0, 0.0]
+            parent = current
+            key = (ast_type, self.location(ast))
+            if (node := parent.children.get(key)) is None:
+                node = parent.children[key] = CallTree()
+
+            current = node
+            total[0] += 1
+            t0 = perf_counter()
+            try:
+                return evaluate(ast, scope)
+            finally:
+                dt = perf_counter() - t0
+                current = parent
+                total[0] -= 1
+                if total[0] == 0:
+                    total[1] += dt
+                node.count += 1
+                node.self += dt
+                parent.self -= dt
+
+        # the wrapper adds a frame to every evaluation
+        limit = sys.getrecursionlimit()
+        module.evaluate = profiled_evaluate
+        sys.setrecursionlimit(limit * 2)
+        try:
+            yield
+        finally:
+            module.evaluate = evaluate
+            sys.setrecursionlimit(limit)
+            self.tree.self = 0.0  # the root only collects (negated) time of the top level evaluations
+
+    def node_timings(self) -> dict[type[AST], NodeTiming]:
+        timings = {ast_type: NodeTiming(total=total) for ast_type, (_, total) in self._totals.items()}
+        for path, node in self.tree.walk():
+            timing = timings[path[-1][0]]
+            timing.count += node.count
+            timing.self += node.self
+        return timings
+
+    def hot_spots(self) -> dict[tuple[Loc, type[AST]], NodeTiming]:
+        """evaluations of each node type at each location in the source, regardless of how they were reached"""
+        spots: dict[tuple[Loc, type[AST]], NodeTiming] = {}
+        for path, node in self.tree.walk():
+            ast_type, loc = path[-1]
+            if (spot := spots.get((loc, ast_type))) is None:
+                spot = spots[(loc, ast_type)] = NodeTiming()
+            spot.count += node.count
+            spot.self += node.self
+        return spots
+
+    def format_loc(self, loc: Loc) -> str:
+        return f'{self.path}:?' if loc is None else f'{self.path}:{loc[0] + 1}:{loc[1] + 1}'
+
+    def report(self, limit: int = 15) -> str:
+        """human readable tables of the stages, the node types, and the hot spots in the source (the `limit` slowest of each)"""
+        lines = [f'{"stage":20} {"time":>10} {"net blocks":>12} {"gcs":>6}']
+        for s in self.stages:
+            lines.append(f'{s.name:20} {s.seconds*1000:8.2f}ms {s.blocks:+12} {s.collections:6}')
+
+        nodes = sorted(self.node_timings().items(), key=lambda item: item[1].self, reverse=True)
+        if nodes:
+            lines += ['', f'{"node type":20} {"count":>10} {"total":>10} {"self":>10}']
+            for ast_type, t in nodes[:limit]:
+                lines.append(f'{ast_type.__name__:20} {t.count:10} {t.total*1000:8.2f}ms {t.self*1000:8.2f}ms')
+
+        spots = sorted(self.hot_spots().items(), key=lambda item: item[1].self, reverse=True)
+        if spots:
+            lines += ['', f'{"hot spot":30} {"node type":20} {"count":>10} {"self":>10}']
+            for (loc, ast_type), t in spots[:limit]:
+                lines.append(f'{self.format_loc(loc):30} {ast_type.__name__:20} {t.count:10} {t.self*1000:8.2f}ms')
+
+        return '\n'.join(lines)
+
+    def speedscope(self) -> dict:
+        """the profile in speedscope's file format (https://github.com/jlfwong/speedscope/wiki/Importing-from-custom-sources)"""
+        frames: list[dict] = []
+        frame_ids: dict[tuple, int] = {}
+
+        def frame(key: tuple, **info) -> int:
+            if key not in frame_ids:
+                frame_ids[key] = len(frames)
+                frames.append(info)
+            return frame_ids[key]
+
+        events = []
+        for s in self.stages:
+            i = frame(('stage', s.name), name=s.name)
+            events.append({'type': 'O', 'frame': i, 'at': s.start})
+            events.append({'type': 'C', 'frame': i, 'at': s.start + s.seconds})
+        end = max((s.start + s.seconds for s in self.stages), default=0.0)
+        profiles = [{'type': 'evented', 'name': 'stages', 'unit': 'seconds', 'startValue': 0.0, 'endValue': end, 'events': events}]
+
+        # each distinct chain of evaluations is one sample, weighted by the time spent in its last node
+        samples, weights = [], []
+        for path, node in self.tree.walk():
+            samples.append([
+                frame((ast_type, loc), name=ast_type.__name__, file=self.path, **({} if loc is None else {'line': loc[0] + 1, 'col': loc[1] + 1}))
+                for ast_type, loc in path
+            ])
+            weights.append(max(node.self, 0.0))
+        if samples:
+            profiles.append({
+                'type': 'sampled', 'name': 'evaluate', 'unit': 'seconds',
+                'startValue': 0.0, 'endValue': sum(weights), 'samples': samples, 'weights': weights
+            })
+
+        return {
+            '$schema': 'https://www.speedscope.app/file-format-schema.json',
+            'name': self.path,
+            'exporter': 'dewy --profile',
+            'shared': {'frames': frames},
+            'profiles': profiles,
+        }
+
+    def finish(self, output: Path):
+        """print the report to stderr, and write the speedscope profile to output"""
+        print(self.report(), file=sys.stderr)
+        output.write_text(json.dumps(self.speedscope()) + '\n')
+        print(f'profile written to {output} (open it at https://www.speedscope.app)', file=sys.stderr)
@@ -1,7 +1,8 @@
 from abc import ABC, abstractmethod, ABCMeta
-from typing import get_args, get_origin, Generator, Any, Literal, Union, dataclass_transform, Callable as TypingCallable
+from typing import get_args, get_origin, Generator, Any, Literal, Union, ClassVar, dataclass_transform, Callable as TypingCallable
 from types import UnionType
 from dataclasses import dataclass, field, fields
+from copy import deepcopy
 from enum import Enum, auto
 # from fractions import Fraction
 
@@ -10,16 +11,30 @@ from .tokenizer import Operator_t, escape_whitespace  # TODO: move into utils
 import pdb
 
 
-@dataclass_transform()
-class AST(ABC):
-    def __init_subclass__(cls: type['AST'], **kwargs):
+class ASTMeta(ABCMeta):
+    def __new__(mcls, name: str, bases: tuple[type, ...], namespace: dict[str, Any], **kwargs):
         """
         - automatically applies the dataclass decorator with repr=False to AST subclasses
+        - AST subclasses are slotted (no per-instance __dict__), which keeps each node small
         """
-        super().__init_subclass__(**kwargs)
+        cls = super().__new__(mcls, name, bases, namespace, **kwargs)
+
+        # classes that already declare their slots are AST itself, or the slotted copy made by dataclass below
+        if '__slots__' in namespace:
+            return cls
+
+        # Apply the dataclass decorator with repr=False to the subclass. slots=True has to make a new class to add the
+        # slots to, so that is the class the subclass's name is bound to
+        cls = dataclass(repr=False, slots=True)(cls)
+        cls._fields = tuple(f.name for f in fields(cls))
+        return cls
 
-        # Apply the dataclass decorator with repr=False to the subclass
-        dataclass(repr=False)(cls)
+
+@dataclass_transform()
+class AST(ABC, metaclass=ASTMeta):
+    # caches set on nodes at runtime by the python backend (unset until then)
+    __slots__ = ('_eval_fn', '_dispatch')
+    _fields: ClassVar[tuple[str, ...]] = () # names of the dataclass fields, in order
 
     # TODO: add property to all ASTs for function complete/locked/etc. meaning it and all children are settled
     @abstractmethod
@@ -81,7 +96,8 @@ class AST(ABC):
         Allows replacing the current AST with a new one during iteration via .send()
         NOTE: Does not recurse into child ASTs
         """
-        for key, value in self.__dict__.items():
+        for key in self._fields:
+            value = getattr(self, key)
             # any direct children are ASTs
             if isinstance(value, AST):
                 replacement = yield key, value
@@ -111,6 +127,18 @@ class AST(ABC):
                 _ = yield key, value
                 assert _ is None, f'ILLEGAL: attempted to replace non-AST value "{key}" during __iter_members__ for ast {self}'
 
+    def __deepcopy__(self, memo: dict[int, Any]) -> 'AST':
+        """copy just the fields directly (the generic copy of slotted objects takes several extra stack frames per node)"""
+        copy = self.__class__.__new__(self.__class__)
+        memo[id(self)] = copy
+        for key in self._fields:
+            setattr(copy, key, deepcopy(getattr(self, key), memo))
+        return copy
+
+    def __getstate__(self) -> tuple[None, dict[str, Any]]:
+        """pickle just the fields (not the caches a backend may have set on the node)"""
+        return None, {key: getattr(self, key) for key in self._fields}
+
     def __iter__(self) -> Generator['AST', None, None]:
         """DEPRECATED: Use __iter_asts__ instead"""
         raise DeprecationWarning(f'__iter__ is deprecated. Use __iter_asts__ instead')
@@ -196,6 +224,7 @@ class PrototypeAST(AST, ABC):
 
 class Delimited(ABC):
     """used to track which ASTs are printed with their own delimiter so they can be juxtaposed without extra parentheses"""
+    __slots__ = ()
 
 class TypeParam(AST, Delimited):
     items: list[AST]
@@ -226,7 +255,7 @@ class Undefined(AST):
     """undefined singleton"""
     def __new__(cls):
         if not hasattr(cls, 'instance'):
-            cls.instance = super(Undefined, cls).__new__(cls)
+            cls.instance = object.__new__(cls)
         return cls.instance
 
     def __str__(self) -> str:
@@ -241,7 +270,7 @@ class Void(AST):
     """void singleton"""
     def __new__(cls):
         if not hasattr(cls, 'instance'):
-            cls.instance = super(Void, cls).__new__(cls)
+            cls.instance = object.__new__(cls)
         return cls.instance
 
     def __str__(self) -> str:
@@ -313,6 +342,21 @@ class Int(AST):
         return str(self.val)
 
 
+# shared instances of the booleans and small ints, for values made at runtime (values are never modified in place)
+true = Bool(True)
+false = Bool(False)
+small_ints = tuple(Int(i) for i in range(-128, 1024))
+
+def make_bool(val: bool) -> Bool:
+    return true if val else false
+
+def make_int(val: int) -> Int:
+    # some ops (e.g. `^` with a negative exponent) still give python floats, which aren't interned
+    if type(val) is int and -128 <= val < 1024:
+        return small_ints[val + 128]
+    return Int(val)
+
+
 class String(AST, Delimited):
     val: str
 
@@ -403,14 +447,14 @@ class Call(AST):
             return f'{self.f}{self.args}'
         return f'{self.f}({self.args})'
 
-from typing import cast
 class BinOp(AST, ABC):
     left: AST
     right: AST
+    # class attributes set by each subclass (not fields, since ASTs are slotted)
+    _op: ClassVar[str | None] = None
+    _space: ClassVar[bool] = True
 
     def __post_init__(self):
-        self._space = cast(bool, getattr(self, '_space', True))
-        self._op = cast(str, getattr(self, '_op', None))
         assert isinstance(self._op, str), f'BinOp subclass "{self.__class__.__name__}" must define an `_op` attribute'
 
     def __str__(self) -> str:
@@ -516,10 +560,10 @@ class MemberIn(BinOp):
 
 class UnaryPrefixOp(AST, ABC):
     operand: AST
+    _op: ClassVar[str | None] = None
+    _space: ClassVar[bool] = False
 
     def __post_init__(self):
-        self._space = cast(bool, getattr(self, '_space', False))
-        self._op = cast(str, getattr(self, '_op', None))
         assert isinstance(self._op, str), f'UnaryPrefixOp subclass "{self.__class__.__name__}" must define an `_op` attribute'
 
     def __str__(self) -> str:
@@ -555,9 +599,9 @@ class AtHandle(UnaryPrefixOp):
 
 class UnaryPostfixOp(AST, ABC):
     operand: AST
+    _op: ClassVar[str | None] = None
 
     def __post_init__(self):
-        self._op = cast(str, getattr(self, '_op', None))
         assert isinstance(self._op, str), f'UnaryPostfixOp subclass "{self.__class__.__name__}" must define an `_op` attribute'
 
     def __str__(self) -> str:
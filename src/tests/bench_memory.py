@@ -0,0 +1,130 @@
+"""
+Measure the memory used by the pipeline on large inputs: the size of the parsed AST (total, and per node), the peak
+memory while evaluating, and the peak RSS of a process that runs the whole input
+
+python -m src.tests.bench_memory [--scale X] [--output results.json]
+
+Each input runs in its own subprocess, so that the peak RSS of one input doesn't hide the others.
+"""
+
+from argparse import ArgumentParser
+from contextlib import redirect_stdout
+from io import StringIO
+from pathlib import Path
+import gc
+import json
+import resource
+import subprocess
+import sys
+import tracemalloc
+
+from ..tokenizer import tokenize
+from ..postok import post_process
+from ..parser import top_level_parse
+from ..postparse import post_parse
+from ..backend.python import Scope, insert_builtins, evaluate
+from .bench_pipeline import stress_sources
+from .programs import stdin_lines
+
+
+def memory_sources(scale: float) -> dict[str, str]:
+    def n(base: int) -> int:
+        return max(1, int(base * scale))
+
+    return {
+        'empty': '',
+        **stress_sources(scale),
+        # makes lots of short lived Int/Bool values at runtime
+        'loop_sum': f'x = 0\nloop i in [0..{n(20000)}) {{ x = x + i % 7 }}\nprintl"{{x}}"\n',
+        'nested_loop_sum': f'x = 0\nloop i in [0..{n(150)}) {{ loop j in [0..{n(150)}) {{ x = x + j }} }}\nprintl"{{x}}"\n',
+    }
+
+
+def parse(src: str):
+    tokens = tokenize(src)
+    post_process(tokens)
+    return post_parse(top_level_parse(tokens))
+
+
+def count_nodes(ast) -> int:
+    return 1 + sum(1 for _ in ast.__full_traversal_iter__())
+
+
+def run(ast) -> str | None:
+    """evaluate the AST, returning the error it raised if any"""
+    scope = Scope.default()
+    insert_builtins(scope)
+    stdin, sys.stdin = sys.stdin, StringIO(stdin_lines)
+    try:
+        with redirect_stdout(StringIO()):
+            evaluate(ast, scope)
+    except Exception as e:
+        return f'{type(e).__name__}: {str(e)[:200]}'
+    finally:
+        sys.stdin = stdin
+    return None
+
+
+def measure(src: str) -> dict:
+    """memory used by parsing and evaluating src (run in a fresh process)"""
+    # build the tables that are cached on first use, so they aren't counted
+    run(parse('x = [1 2]\nloop i in [0..2) { x = x + 1 }\nprintl"{x}"\n'))
+
+    gc.collect()
+    tracemalloc.start()
+    ast = parse(src)
+    gc.collect()
+    ast_bytes, _ = tracemalloc.get_traced_memory()
+    ast_blocks = sum(stat.count for stat in tracemalloc.take_snapshot().statistics('filename'))
+    nodes = count_nodes(ast)
+
+    tracemalloc.reset_peak()
+    error = run(ast)
+    _, eval_peak = tracemalloc.get_traced_memory()
+    tracemalloc.stop()
+
+    return {
+        'nodes': nodes,
+        'ast_bytes': ast_bytes,
+        'ast_blocks': ast_blocks,
+        'bytes_per_node': ast_bytes / nodes,
+        'eval_peak_bytes': eval_peak - ast_bytes,
+        'max_rss_kb': resource.getrusage(resource.RUSAGE_SELF).ru_maxrss,
+        'error': error,
+    }
+
+
+def main():
+    parser = ArgumentParser(description='measure the memory used by the dewy pipeline on large inputs, writing the results as JSON')
+    parser.add_argument('--scale', type=float, default=1.0, help='multiplier for the size of the generated inputs')
+    parser.add_argument('--output', type=Path, help='file to write the JSON to (default stdout)')
+    parser.add_argument('--input', help='run a single input in this process (used by the subprocesses)')
+    args = parser.parse_args()
+
+    sources = memory_sources(args.scale)
+    if args.input is not None:
+        print(json.dumps(measure(sources[args.input])))
+        return
+
+    results = {}
+    for name in sources:
+        proc = subprocess.run(
+            [sys.executable, '-m', __spec__.name, '--scale', str(args.scale), '--input', name],
+            capture_output=True, text=True, stdin=subprocess.DEVNULL
+        )
+        if proc.returncode != 0:
+            results[name] = {'error': proc.stderr.strip().splitlines()[-1:]}
+            continue
+        results[name] = r = json.loads(proc.stdout)
+        print(f'{name:20} {r["nodes"]:8} nodes {r["bytes_per_node"]:7.1f} B/node  ast {r["ast_bytes"]/1e6:7.2f} MB  '
+              f'eval peak {r["eval_peak_bytes"]/1e6:7.2f} MB  rss {r["max_rss_kb"]/1e3:7.1f} MB', file=sys.stderr)
+
+    out = json.dumps({'python': sys.version.split()[0], 'scale': args.scale, 'results': results}, indent=2)
+    if args.output is not None:
+        args.output.write_text(out + '\n')
+    else:
+        print(out)
+
+
+if __name__ == '__main__':
+    main()
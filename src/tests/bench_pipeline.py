@@ -0,0 +1,203 @@
+"""
+Benchmark each stage of the pipeline separately (tokenize, post_process, top_level_parse, post_parse, fold_constants, evaluation,
+qbe codegen)
+on the examples and on generated stress inputs, writing the timings as JSON
+
+python -m src.tests.bench_pipeline [--repeats N] [--scale X] [--corpus examples|stress] [--output results.json] [--baseline old.json]
+
+Each stage is timed on the output of the previous one, and the best time out of the repeats is kept. When a stage fails
+(or runs past --timeout), the error is recorded for that stage and the later stages are skipped for that input.
+"""
+
+from argparse import ArgumentParser
+from contextlib import redirect_stdout
+from copy import deepcopy
+from io import StringIO
+from pathlib import Path
+from time import perf_counter
+from typing import Any, Callable
+import json
+import platform
+import signal
+import sys
+
+from ..tokenizer import tokenize
+from ..postok import post_process
+from ..parser import top_level_parse
+from ..postparse import post_parse, fold_constants
+from ..backend import get_version
+from ..backend.python import Scope, insert_builtins, evaluate
+from ..backend.qbe.qbe import top_level_compile
+from .programs import example_root, stdin_lines, unimplemented
+import pdb
+
+
+stages = ['tokenize', 'post_process', 'top_level_parse', 'post_parse', 'fold_constants', 'evaluate', 'qbe_codegen']
+
+
+class StageTimeout(Exception): ...
+
+
+def stress_sources(scale: float) -> dict[str, str]:
+    """generated programs that each push one part of the pipeline"""
+    def n(base: int) -> int:
+        return max(1, int(base * scale))
+
+    return {
+        # nesting is limited by python's recursion limit in the parser
+        'deep_nesting': 'x = ' + '(' * n(90) + '1' + ')' * n(90) + '\nprintl"{x}"\n',
+        'deep_blocks': '{' * n(90) + 'printl"hi"' + '}' * n(90) + '\n',
+        'long_opchain': 'x = ' + ' + '.join(str(i) for i in range(n(200))) + '\nprintl"{x}"\n',
+        'mixed_opchain': 'x = ' + ' '.join(f'{i} {"+-*"[i % 3]}' for i in range(1, n(300))) + ' 1\nprintl"{x}"\n',
+        'huge_array': f'A = [{" ".join(str(i) for i in range(n(5000)))}]\nprintl"{{A}}"\n',
+        'many_interpolations': 'a = 1\nprintl"' + '{a} ' * n(2000) + '"\n',
+        'many_statements': 'x = 0\n' + 'x = x + 1\n' * n(2000) + 'printl"{x}"\n',
+    }
+
+
+def example_sources() -> dict[str, str]:
+    return {path.name: path.read_text() for path in sorted(example_root.glob('*.dewy'))}
+
+
+def run_evaluate(ast):
+    scope = Scope.default()
+    insert_builtins(scope)
+    stdin, sys.stdin = sys.stdin, StringIO(stdin_lines)
+    try:
+        with redirect_stdout(StringIO()):
+            return evaluate(ast, scope)
+    finally:
+        sys.stdin = stdin
+
+
+def run_qbe_codegen(ast):
+    return str(top_level_compile(ast))
+
+
+def run_pipeline(src: str, timeout: float) -> tuple[dict[str, float], dict[str, str] | None]:
+    """time each stage once. Returns the time of each stage that finished, and the stage that failed (if any)"""
+    times: dict[str, float] = {}
+
+    def timed(stage: str, fn: Callable[[], Any]) -> Any:
+        signal.setitimer(signal.ITIMER_REAL, timeout)
+        try:
+            t0 = perf_counter()
+            result = fn()
+            times[stage] = perf_counter() - t0
+            return result
+        finally:
+            signal.setitimer(signal.ITIMER_REAL, 0)
+
+    stage = 'tokenize'
+    try:
+        tokens = timed('tokenize', lambda: tokenize(src))
+        stage = 'post_process'
+        timed('post_process', lambda: post_process(tokens))
+        stage = 'top_level_parse'
+        ast = timed('top_level_parse', lambda: top_level_parse(tokens))
+        stage = 'post_parse'
+        ast = timed('post_parse', lambda: post_parse(ast))
+        stage = 'fold_constants'
+        ast = timed('fold_constants', lambda: fold_constants(ast))
+
+        # evaluation may modify the AST (e.g. closures capturing scopes), so codegen gets its own copy
+        codegen_ast = deepcopy(ast)
+        stage = 'evaluate'
+        timed('evaluate', lambda: run_evaluate(ast))
+        stage = 'qbe_codegen'
+        timed('qbe_codegen', lambda: run_qbe_codegen(codegen_ast))
+    except Exception as e:
+        return times, {'stage': stage, 'error': f'{type(e).__name__}: {str(e)[:200]}'}
+
+    return times, None
+
+
+def bench_source(src: str, repeats: int, timeout: float) -> dict:
+    best: dict[str, float] = {}
+    error = None
+    for _ in range(repeats):
+        times, error = run_pipeline(src, timeout)
+        for stage, t in times.items():
+            best[stage] = min(best.get(stage, float('inf')), t)
+        if error is not None and error['error'].startswith(StageTimeout.__name__):
+            break  # don't wait out the timeout again
+
+    return {
+        'chars': len(src),
+        'lines': src.count('\n') + 1,
+        'seconds': {stage: best.get(stage) for stage in stages},
+        'error': error,
+    }
+
+
+def bench_pipeline(corpora: list[str], repeats: int, scale: float, timeout: float) -> dict:
+    sources: dict[str, dict[str, str]] = {}
+    if 'examples' in corpora:
+        sources['examples'] = example_sources()
+    if 'stress' in corpora:
+        sources['stress'] = stress_sources(scale)
+
+    results = {corpus: {name: bench_source(src, repeats, timeout) for name, src in srcs.items()} for corpus, srcs in sources.items()}
+
+    # totals only count the inputs that made it through each stage
+    totals = {
+        corpus: {stage: sum(r['seconds'][stage] or 0 for r in corpus_results.values()) for stage in stages}
+        for corpus, corpus_results in results.items()
+    }
+
+    return {
+        'version': get_version(),
+        'python': platform.python_version(),
+        'platform': platform.platform(),
+        'repeats': repeats,
+        'scale': scale,
+        'stages': stages,
+        'totals': totals,
+        'results': results,
+    }
+
+
+def compare(report: dict, baseline: dict) -> str:
+    """table of each stage's total time against a previous report (>1 means faster than the baseline)"""
+    lines = [f'{"":10} {"stage":16} {"baseline":>10} {"current":>10} {"speedup":>8}']
+    for corpus, totals in report['totals'].items():
+        for stage in stages:
+            old = baseline.get('totals', {}).get(corpus, {}).get(stage)
+            new = totals[stage]
+            if not old or not new:
+                continue
+            lines.append(f'{corpus:10} {stage:16} {old*1000:8.1f}ms {new*1000:8.1f}ms {old/new:7.2f}x')
+    return '\n'.join(lines)
+
+
+def main():
+    parser = ArgumentParser(description='time each stage of the dewy pipeline, writing the results as JSON')
+    parser.add_argument('--repeats', type=int, default=3, help='number of times to run each input (the best time is kept)')
+    parser.add_argument('--scale', type=float, default=1.0, help='multiplier for the size of the generated stress inputs')
+    parser.add_argument('--corpus', choices=['examples', 'stress'], action='append', help='which inputs to run (default both)')
+    parser.add_argument('--timeout', type=float, default=10.0, help='seconds before a single stage is abandoned')
+    parser.add_argument('--output', type=Path, help='file to write the JSON to (default stdout)')
+    parser.add_argument('--baseline', type=Path, help='previous JSON output to compare the totals against (printed to stderr)')
+    args = parser.parse_args()
+
+    def on_timeout(signum, frame):
+        raise StageTimeout(f'stage took longer than {args.timeout}s')
+    signal.signal(signal.SIGALRM, on_timeout)
+
+    # examples that reach unimplemented features would otherwise stop in the debugger
+    pdb.set_trace = unimplemented
+
+    report = bench_pipeline(args.corpus or ['examples', 'stress'], args.repeats, args.scale, args.timeout)
+
+    out = json.dumps(report, indent=2)
+    if args.output is not None:
+        args.output.write_text(out + '\n')
+    else:
+        print(out)
+
+    if args.baseline is not None:
+        print(compare(report, json.loads(args.baseline.read_text())), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,76 @@
+"""
+Benchmark the tokenizer on the examples, comparing the first-character dispatch table against trying every eat function at every position
+
+python -m src.tests.bench_tokenizer [repeats]
+"""
+
+from pathlib import Path
+from time import perf_counter
+import sys
+
+from .. import tokenizer
+from ..tokenizer import tokenize, get_contextual_eat_funcs, get_func_precedences
+
+
+class ExhaustiveTable(dict):
+    """stand-in for DispatchTable that offers every eat function at every character, as the tokenizer did originally"""
+
+    def __init__(self, funcs):
+        super().__init__()
+        self.entry = (funcs, get_func_precedences(funcs))
+
+    def __missing__(self, c):
+        return self.entry
+
+
+def exhaustive_dispatch_table(context):
+    return ExhaustiveTable(get_contextual_eat_funcs(context))
+
+
+def tokenize_all(sources: dict[Path, str]) -> dict[Path, str]:
+    """repr of the tokens (or the exception) for each source, so that two tokenizer variants can be compared"""
+    results = {}
+    for path, src in sources.items():
+        try:
+            results[path] = repr(tokenize(src))
+        except Exception as e:
+            results[path] = f'{type(e).__name__}: {e}'
+    return results
+
+
+def time_tokenize_all(sources: dict[Path, str], repeats: int) -> float:
+    """best time out of repeats to tokenize every source"""
+    best = float('inf')
+    for _ in range(repeats):
+        t0 = perf_counter()
+        tokenize_all(sources)
+        best = min(best, perf_counter() - t0)
+    return best
+
+
+def bench_tokenizer(repeats: int = 5):
+    example_root = Path(__file__).parent.parent.parent / 'examples'
+    sources = {path: path.read_text() for path in sorted(example_root.glob('*.dewy'))}
+    n_chars = sum(len(src) for src in sources.values())
+
+    dispatch_table = tokenizer.get_dispatch_table
+    try:
+        tokenizer.get_dispatch_table = exhaustive_dispatch_table
+        expected = tokenize_all(sources)
+        exhaustive_time = time_tokenize_all(sources, repeats)
+    finally:
+        tokenizer.get_dispatch_table = dispatch_table
+
+    actual = tokenize_all(sources)
+    mismatches = [path.name for path in sources if actual[path] != expected[path]]
+    assert not mismatches, f'dispatch table tokenized differently from the exhaustive search: {mismatches}'
+    dispatch_time = time_tokenize_all(sources, repeats)
+
+    print(f'tokenized {len(sources)} examples ({n_chars} chars), best of {repeats}')
+    print(f'  exhaustive: {exhaustive_time*1000:8.1f} ms  ({n_chars/exhaustive_time:10.0f} chars/s)')
+    print(f'  dispatch:   {dispatch_time*1000:8.1f} ms  ({n_chars/dispatch_time:10.0f} chars/s)')
+    print(f'  speedup:    {exhaustive_time/dispatch_time:8.2f}x')
+
+
+if __name__ == '__main__':
+    bench_tokenizer(*map(int, sys.argv[1:]))
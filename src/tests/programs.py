@@ -0,0 +1,39 @@
+"""Helpers for the tests and benchmarks that run dewy programs"""
+
+from contextlib import redirect_stdout
+from io import StringIO
+from pathlib import Path
+import re
+import sys
+
+from ..backend.python import python_interpreter
+from ..utils import Options
+
+
+example_root = Path(__file__).parent.parent.parent / 'examples'
+
+# fed to programs that read from stdin (e.g. hello_name.dewy)
+stdin_lines = 'Bob\n5\n7\n3\n2\n1\n4\n6\n8\n9\n10\n'
+
+
+def unimplemented(*args, **kwargs):
+    """stand-in for pdb.set_trace, which the compiler calls where a feature isn't implemented yet"""
+    raise NotImplementedError('stopped at pdb.set_trace')
+
+
+def run_program(path: Path, **options) -> tuple[str, str | None]:
+    """
+    output of running the program with the python backend (with scope addresses blanked out), and the error it raised
+    if any. options are passed on to Options. The AST cache is off unless asked for, so tests don't fill ~/.cache/dewy
+    """
+    out, stdin = StringIO(), sys.stdin
+    sys.stdin = StringIO(stdin_lines)
+    try:
+        with redirect_stdout(out):
+            python_interpreter(path, [], Options(tokens=False, verbose=False, **{'cache': False, **options}))
+        error = None
+    except Exception as e:
+        error = f'{type(e).__name__}: {e}'
+    finally:
+        sys.stdin = stdin
+    return re.sub(r'0x[0-9a-f]+', '0x', out.getvalue()), error and re.sub(r'0x[0-9a-f]+', '0x', error)
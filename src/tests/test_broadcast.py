@@ -0,0 +1,87 @@
+from array import array
+from time import perf_counter
+from unittest.mock import patch
+from ..syntax import Array, Int, Bool, String, Add, Sub, Mul, Div, Mod, Pow, Less, Equal, And, LeftShift, undefined
+from ..backend import python
+from ..backend.python import TypedArray, Float, broadcast_binary
+
+
+def ints(*vals: int) -> Array:
+    return Array([Int(v) for v in vals])
+
+def floats(*vals: float) -> Array:
+    return Array([Float(v) for v in vals])
+
+
+def elementwise(op, left, right):
+    """broadcast without the packed kernels (every element goes through the regular dispatch)"""
+    with patch.object(python, 'broadcast_packed', lambda op, left, right: None):
+        return broadcast_binary(op, left, right)
+
+
+def plain(ast):
+    """the result as nested python values, so that a TypedArray and the equivalent Array compare equal"""
+    match ast:
+        case TypedArray(): return [plain(i) for i in ast.boxed()]
+        case Array(items): return [plain(i) for i in items]
+        case Int(val) | Float(val) | Bool(val) | String(val): return (type(ast).__name__, val)
+        case _: return ast
+
+
+def test_broadcast_matches_elementwise():
+    cases = [
+        (Add, ints(1, 2, 3), Int(1)),
+        (Sub, Int(2), ints(1, 2)),
+        (Mul, ints(1, 2, 3), ints(4, 5, 6)),
+        (Div, Int(4), ints(1, 2, 3)),         # Int / Int isn't always an Int, so isn't packed
+        (Div, floats(1.0, 2.0), Int(0)),      # undefined results
+        (Mod, ints(7, -7, 5), Int(3)),
+        (Pow, ints(1, 2, 3), ints(4, 5, 6)),
+        (Pow, floats(1.5, 2.0), Int(2)),
+        (Less, ints(1, 2, 3), Int(2)),
+        (Equal, floats(1.0, 2.0), floats(1.0, 3.0)),
+        (And, ints(6, 3), Int(5)),
+        (Add, floats(1.5, 2.5), ints(1, 2)),
+        (Mul, Array([Int(1), Float(2.5)]), Int(2)),    # mixed arrays are boxed
+        (Mul, ints(2**62, 1), Int(4)),                # past int64
+        (LeftShift, ints(1, 2), Int(70)),
+        (Add, ints(1, 2), Array([ints(10), ints(20), ints(30)])),
+        (Pow, Array([ints(1, 2, 3)]), Array([ints(4), ints(5), ints(6)])),
+        (Add, ints(5), ints(1, 2, 3)),               # length 1 arrays are repeated
+        (Add, ints(), Int(1)),
+        (Add, ints(1, 2), undefined),
+    ]
+    for op_cls, left, right in cases:
+        op = op_cls(left, right)
+        expected = plain(elementwise(op, left, right))
+        actual = plain(broadcast_binary(op, left, right))
+        assert actual == expected, f'broadcasting {op}\nexpected: {expected}\nactual:   {actual}'
+
+    # packed results feed into later broadcasts
+    doubled = broadcast_binary(Mul(ints(1, 2, 3), Int(2)), ints(1, 2, 3), Int(2))
+    assert isinstance(doubled, TypedArray) and doubled.data == array('q', [2, 4, 6])
+    assert plain(broadcast_binary(Add(doubled, doubled), doubled, doubled)) == [('Int', 4), ('Int', 8), ('Int', 12)]
+
+    try:
+        broadcast_binary(Add(ints(1, 2), ints(1, 2, 3)), ints(1, 2), ints(1, 2, 3))
+    except ValueError:
+        pass
+    else:
+        raise AssertionError('broadcasting arrays of different lengths should fail')
+
+
+def bench_broadcast(n: int = 100_000, repeats: int = 5):
+    arr = Array([Int(i) for i in range(n)])
+    op = Mul(arr, Int(3))
+    for name, fn in (('elementwise', elementwise), ('packed', broadcast_binary)):
+        best = float('inf')
+        for _ in range(repeats):
+            t0 = perf_counter()
+            fn(op, arr, Int(3))
+            best = min(best, perf_counter() - t0)
+        print(f'{name:12} {n} element array .* 3: {best*1000:7.1f} ms')
+
+
+if __name__ == '__main__':
+    test_broadcast_matches_elementwise()
+    bench_broadcast()
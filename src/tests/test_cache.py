@@ -0,0 +1,46 @@
+from contextlib import redirect_stdout
+from io import StringIO
+from pathlib import Path
+from tempfile import TemporaryDirectory
+from unittest.mock import patch
+import os
+from ..backend.python import python_interpreter
+from ..utils import Options
+
+
+def run(path: Path, cache: bool = True) -> str:
+    out = StringIO()
+    with redirect_stdout(out):
+        python_interpreter(path, [], Options(tokens=False, verbose=False, cache=cache))
+    return out.getvalue()
+
+
+def test_ast_cache():
+    with TemporaryDirectory() as tmp, patch.dict(os.environ, {'DEWY_CACHE_DIR': str(Path(tmp) / 'cache')}):
+        entries = lambda: sorted(p.name for p in (Path(tmp) / 'cache' / 'python').glob('*') if p.name != 'tmp')
+        path = Path(tmp) / 'prog.dewy'
+        path.write_text('x = 10\nf = y => x + y\nloop i in [0..3) printl(f(i))\n')
+
+        expected = run(path, cache=False)
+        assert entries() == [], 'the cache should be left alone with cache=False'
+        assert run(path) == expected
+        assert len(entries()) == 1
+        assert run(path) == expected, 'running from the cached AST gave different output'
+        assert len(entries()) == 1
+
+        # a changed source gets its own entry
+        path.write_text('printl"changed"\n')
+        assert run(path) == 'changed\n'
+        assert len(entries()) == 2
+
+        # a program that fails part way through isn't cached
+        path.write_text('printl"before"\nundefined_function()\n')
+        try:
+            run(path)
+        except Exception:
+            pass
+        assert len(entries()) == 2
+
+
+if __name__ == '__main__':
+    test_ast_cache()
@@ -0,0 +1,39 @@
+from pathlib import Path
+from tempfile import TemporaryDirectory
+from unittest.mock import patch
+from .programs import example_root, unimplemented, run_program
+import pdb
+
+
+@patch.object(pdb, 'set_trace', unimplemented)
+def test_closures_match_evaluate():
+    for path in sorted(example_root.glob('*.dewy')):
+        expected = run_program(path, closures=False)
+        actual = run_program(path, closures=True)
+        assert actual == expected, f'compiled closures behaved differently on {path.name}\nexpected: {expected}\nactual:   {actual}'
+
+
+# programs where names are bound in a different scope than their frame's slot (outer scopes, shadowing, consts)
+scoping_sources = {
+    'outer_assign': 'x = 0\ni = 0\nloop i <? 5 { x = x + i  i = i + 1 }\nprintl"{x}"\n',
+    'shadow': 'x = 1\n{ let x = 2  x = x + 1  printl"{x}" }\nprintl"{x}"\n',
+    'bind_later': 'x = 1\n{ printl"{x}"  let x = 5  printl"{x}" }\nprintl"{x}"\n',
+    'closure_outer': 'x = 1\nf = () => x + 1\n{ printl(f())  x = 10  printl(f()) }\n',
+    'const_assign': 'const c = 1\n{ c = 2 }\n',
+    'const_shadow': 'const c = 1\n{ let c = 2  c = 3  printl"{c}" }\nprintl"{c}"\n',
+}
+
+@patch.object(pdb, 'set_trace', unimplemented)
+def test_slots_match_scope_chain():
+    with TemporaryDirectory() as tmp:
+        for name, src in scoping_sources.items():
+            path = Path(tmp) / f'{name}.dewy'
+            path.write_text(src)
+            expected = run_program(path, closures=False)
+            actual = run_program(path, closures=True)
+            assert actual == expected, f'compiled closures scoped names differently in {name}\nexpected: {expected}\nactual:   {actual}'
+
+
+if __name__ == '__main__':
+    test_closures_match_evaluate()
+    test_slots_match_scope_chain()
@@ -1,5 +1,6 @@
 from pathlib import Path
 from ..backend.python import python_interpreter
+from ..utils import Options
 import pdb
 
 def test_examples():
@@ -26,7 +27,7 @@ def test_examples():
     for filename in current_test_cases:
         example_path = example_root / filename
         print(f'running {example_path.relative_to(example_root)}')
-        python_interpreter(example_path, [])
+        python_interpreter(example_path, [], Options(tokens=False, verbose=False, cache=False))
 
 if __name__ == '__main__':
     test_examples()
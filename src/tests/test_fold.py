@@ -0,0 +1,68 @@
+from pathlib import Path
+from tempfile import TemporaryDirectory
+from unittest.mock import patch
+from ..tokenizer import tokenize
+from ..postok import post_process
+from ..parser import top_level_parse
+from ..postparse import post_parse, fold_constants
+from .programs import example_root, unimplemented, run_program
+import pdb
+
+
+def folded(src: str) -> str:
+    tokens = tokenize(src)
+    post_process(tokens)
+    return str(fold_constants(post_parse(top_level_parse(tokens))))
+
+
+# programs with folding opportunities next to the cases that must be left alone
+fold_sources = {
+    'arithmetic': 'x = 2^10 * 3 - (7 % 4)\ny = x + 1\nprintl"{x} {y}"\n',
+    'errors': 'printl"{1 / 0}"\nx = 7 % 0\n',
+    'big_ints': 'x = 2^62 + 2^62\nprintl"{x}"\n',
+    'consts': 'const n = 2^4\nconst s = n * 2 - 1\nloop i in [0..20) { if i =? n printl"hit" else if i >? s printl"past" else printl"{i}" }\n',
+    'const_shadow': 'const c = 1\n{ let c = 2  c = 3  printl"{c}" }\nprintl"{c}"\n',
+    'const_arg': 'const x = 5\nf = x => x * 2\nprintl(f(3))\nprintl"{x}"\n',
+    'const_assign': 'const c = 1\nc = 2\n',
+    'dead_branches': 'const debug = false\nif debug printl"never" else if 1 <? 2 printl"always" else printl"also never"\n',
+    'scoped_branch': 'x = 1\nif true { let x = 2  printl"{x}" }\nprintl"{x}"\n',
+    'flows': 'x = 3\nif x >? 5 printl"big" else if false printl"never" else if true printl"small" else printl"never"\n',
+    # folded values passed as call arguments
+    'bool_args': 'printl(1 =? 1)\nprintl(not true)\n',
+    'const_arg_compare': 'const c = 1 + 2\nprintl(c =? 3)\n',
+}
+
+@patch.object(pdb, 'set_trace', unimplemented)
+def test_fold_matches_unfolded():
+    with TemporaryDirectory() as tmp:
+        for name, src in fold_sources.items():
+            (Path(tmp) / f'{name}.dewy').write_text(src)
+        for path in [*sorted(example_root.glob('*.dewy')), *sorted(Path(tmp).glob('*.dewy'))]:
+            expected = run_program(path, fold=False)
+            actual = run_program(path, fold=True)
+            assert actual == expected, f'folded program behaved differently on {path.name}\nexpected: {expected}\nactual:   {actual}'
+
+
+def test_folds():
+    cases = {
+        'x = 2^10 * 3': 'x = 3072',
+        'x = (1 + 2) * 3 =? 9': 'x = true',
+        'x = not (true and false)': 'x = true',
+        'x = 1 / 0': 'x = 1 / 0',
+        'x = 2^100': 'x = 2 ^ 100',
+        'x = 2^59 + 2^59': 'x = 576460752303423488 + 576460752303423488',
+        'x = [1 2] .+ (1 + 1)': 'x = [1 2] .+ 2',
+        'const c = 4\ny = c * 2': '(const c = 4 y = 8)',
+        'const c = 4\nc = 5\ny = c': '(const c = 4 c = 5 y = c)',
+        'if false 1 else if x 2 else 3': 'if x 2 else 3',
+        'if x 1 else if true 2 else 3': 'if x 1 else 2',
+        'if false 1': 'void',
+    }
+    for src, expected in cases.items():
+        actual = folded(src)
+        assert actual == expected, f'folding {src!r}\nexpected: {expected}\nactual:   {actual}'
+
+
+if __name__ == '__main__':
+    test_folds()
+    test_fold_matches_unfolded()
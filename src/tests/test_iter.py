@@ -0,0 +1,66 @@
+from itertools import islice
+from time import perf_counter
+from ..syntax import Range, Array, Dict, PointsTo, Int, String, Void, void
+from ..backend.python import Iter, Float
+
+
+def values(item, limit: int = 100) -> list:
+    """python values stepped through by iterating over item (at most limit of them)"""
+    it = Iter(item)
+    def gen():
+        while True:
+            cond, val = it._next()
+            if not cond:
+                return
+            yield val.val if hasattr(val, 'val') else val
+    return [*islice(gen(), limit)]
+
+
+def test_range_iteration():
+    cases = [
+        (Range(Int(0), Int(5), '[)'), [0, 1, 2, 3, 4]),
+        (Range(Int(0), Int(5), '[]'), [0, 1, 2, 3, 4, 5]),
+        (Range(Int(0), Int(5), '(]'), [1, 2, 3, 4, 5]),
+        (Range(Int(5), Int(0), '[]'), []),
+        (Range(Array([Int(0), Int(2)]), Int(10), '[]'), [0, 2, 4, 6, 8, 10]),
+        (Range(Array([Int(0), Int(2)]), Int(10), '[)'), [0, 2, 4, 6, 8]),
+        (Range(Array([Int(9), Int(8)]), Int(1), '[]'), [9, 8, 7, 6, 5, 4, 3, 2, 1]),
+        (Range(Array([Int(10), Int(7)]), Int(0), '()'), [7, 4, 1]),
+        (Range(Int(3), void, '[]'), [3, 4, 5, 6]),
+        (Range(Array([Int(0), Int(-3)]), void, '(]'), [-3, -6, -9]),
+        (Range(Float(0.5), Int(3), '[]'), [0.5, 1.5, 2.5]),
+        (Range(String('a'), String('e'), '[)'), ['a', 'b', 'c', 'd']),
+        (Range(Array([String('z'), String('x')]), String('t'), '[]'), ['z', 'x', 'v', 't']),
+    ]
+    for item, expected in cases:
+        # bounded ranges get room for an extra value, to check they stop
+        actual = values(item, limit=len(expected) + 1 if item.right is not void else len(expected))
+        assert actual == expected, f'iterating over {item} gave {actual}, expected {expected}'
+
+    assert isinstance(Iter(Range(Float(0.5), Int(3), '[]'))._next()[1], Float)
+
+
+def test_items_iteration():
+    arr = Array([Int(1), String('a'), Int(3)])
+    assert values(arr) == [1, 'a', 3]
+    d = Dict([PointsTo(String('a'), Int(1))])
+    assert values(d) == [d.items[0]]
+
+    # stays exhausted
+    it = Iter(Array([]))
+    assert it._next()[0] is False and it._next()[0] is False
+
+
+def bench_range_iteration(n: int = 1_000_000):
+    it = Iter(Range(Int(0), Int(n), '[)'))
+    t0 = perf_counter()
+    while it._next()[0]:
+        pass
+    t = perf_counter() - t0
+    print(f'{n} range steps: {t*1000:.1f} ms ({t/n*1e9:.0f} ns each)')
+
+
+if __name__ == '__main__':
+    test_range_iteration()
+    test_items_iteration()
+    bench_range_iteration()
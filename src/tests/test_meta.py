@@ -0,0 +1,45 @@
+from time import perf_counter
+import gc
+from ..syntax import Int, Identifier
+from ..backend.python import MetaNamespaceDict
+
+
+def test_meta_identity():
+    meta = MetaNamespaceDict()
+    a, b = Identifier('x'), Identifier('x')
+    meta[a].was_entered = True
+    assert meta[a].was_entered
+    assert meta[b].was_entered is None, 'ASTs that are equal but not identical should not share metadata'
+
+    # metadata must not carry over to a new AST that would have reused the id of one that was freed
+    meta[Int(1)].props = 'stale'
+    gc.collect()
+    for i in range(1000):
+        assert meta[Int(i)].props is None, 'a new AST picked up the metadata of a freed one'
+
+
+def test_clear_call_args():
+    meta = MetaNamespaceDict()
+    f, g = Identifier('f'), Identifier('g')
+    meta[f].call_args = [Int(1)], {}
+    meta[g].call_args = [Int(2)], {}
+    meta[g].was_entered = True
+    meta.clear_call_args()
+    assert meta[f].call_args is None and meta[g].call_args is None
+    assert meta[g].was_entered, 'clearing call args should keep the other metadata'
+
+
+def bench_meta_access(n: int = 100_000):
+    meta = MetaNamespaceDict()
+    ast = Identifier('x')
+    t0 = perf_counter()
+    for _ in range(n):
+        meta[ast].call_args = None
+    t = perf_counter() - t0
+    print(f'{n} metadata accesses: {t*1000:.1f} ms ({t/n*1e9:.0f} ns each)')
+
+
+if __name__ == '__main__':
+    test_meta_identity()
+    test_clear_call_args()
+    bench_meta_access()
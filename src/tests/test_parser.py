@@ -0,0 +1,78 @@
+from pathlib import Path
+from random import Random
+from time import perf_counter
+from unittest.mock import patch
+from ..tokenizer import tokenize
+from ..postok import post_process, get_chains
+from ..parser import parse_chain, parse_chain_by_splitting
+import pdb
+
+
+def ambiguous(*args, **kwargs):
+    raise NotImplementedError('ambiguous precedence not handled yet')
+
+
+def run(parse, chains) -> tuple[list[str], float]:
+    """repr of each parsed chain (or the error raised), and the time spent parsing"""
+    results = []
+    t0 = perf_counter()
+    for chain in chains:
+        try:
+            results.append(repr(parse(chain)))
+        except Exception as e:
+            results.append(f'{type(e).__name__}: {e}')
+    return results, perf_counter() - t0
+
+
+def get_all_chains(src: str) -> list:
+    try:
+        tokens = tokenize(src)
+        post_process(tokens)
+        return [*get_chains(tokens)]
+    except Exception:
+        return []
+
+
+atoms = ['a', 'b', '1', '2', 'f(x)', '[1 2]', '(a)', '"s"', '#t', 'a.b', '..']
+binops = [' + ', ' - ', '*', ' / ', '^', ' = ', ' += ', ' -> ', ',', ' and ', ' or ', ' =? ', ' <? ', ':', ' => ', ' |> ', ' <| ', ' else ', ' in ', ' as ', '.', ' .+ ', ' << ', ' ', '']
+prefixes = ['', '', '', '-', 'not ', '@', '~']
+postfixes = ['', '', '', '?', ';']
+
+
+def random_chain_source(rng: Random) -> str:
+    parts = []
+    for _ in range(rng.randint(1, 8)):
+        parts.append(rng.choice(prefixes) + rng.choice(atoms) + rng.choice(postfixes))
+        parts.append(rng.choice(binops))
+    return ''.join(parts[:-1])
+
+
+@patch.object(pdb, 'set_trace', ambiguous)
+def test_parse_chain_matches_splitting():
+    example_root = Path(__file__).parent.parent.parent / 'examples'
+    chains = [chain for path in sorted(example_root.glob('*.dewy')) for chain in get_all_chains(path.read_text())]
+
+    rng = Random(0)
+    chains += [chain for _ in range(2000) for chain in get_all_chains(random_chain_source(rng))]
+
+    expected, split_time = run(parse_chain_by_splitting, chains)
+    actual, single_time = run(parse_chain, chains)
+    for chain, e, a in zip(chains, expected, actual):
+        assert a == e, f'parse_chain differs for {chain}\nexpected: {e}\nactual:   {a}'
+
+    print(f'parsing {len(chains)} chains: splitting {split_time*1000:.1f} ms, single pass {single_time*1000:.1f} ms')
+
+
+def test_long_chains():
+    for op in ['+', '^', ',']:
+        src = op.join(['1'] * 500)
+        chain, = get_all_chains(src)
+        expected, split_time = run(parse_chain_by_splitting, [chain])
+        actual, single_time = run(parse_chain, [chain])
+        assert actual == expected, f'parse_chain differs for {op!r} chain'
+        print(f'500 term {op!r} chain: splitting {split_time*1000:.1f} ms, single pass {single_time*1000:.1f} ms')
+
+
+if __name__ == '__main__':
+    test_parse_chain_matches_splitting()
+    test_long_chains()
@@ -0,0 +1,83 @@
+from pathlib import Path
+from unittest.mock import patch
+from ..tokenizer import tokenize
+from ..postok import post_process
+from .programs import example_root, unimplemented
+import json
+import pdb
+
+
+def processed(src: str) -> str:
+    """repr of the post processed tokens of src (or the error raised)"""
+    try:
+        tokens = tokenize(src)
+        post_process(tokens)
+        return repr(tokens)
+    except Exception as e:
+        return f'{type(e).__name__}: {e}'
+
+
+def test_post_process():
+    cases = {
+        # whitespace removed, with juxtaposes between tokens that were touching (except next to operators)
+        'a b': '[<Identifier_t: a>, <Identifier_t: b>]',
+        'f(x)': '[<Identifier_t: f>, <Juxtapose_t>, <Block_t: (<Identifier_t: x>)>]',
+        'x = -y': '[<Identifier_t: x>, <Operator_t: `=`>, <Operator_t: `-`>, <Identifier_t: y>]',
+        'printl"a {b c}"': "[<Identifier_t: printl>, <Juxtapose_t>, <String_t: ['a ', <Block_t: {<Identifier_t: b>, <Identifier_t: c>}>]>]",
+        '{ x = 1 + 2 }': '[<Block_t: {<Identifier_t: x>, <Operator_t: `=`>, <Integer_t: 1>, <Operator_t: `+`>, <Integer_t: 2>}>]',
+
+        # flows bundled into single tokens, with a bare else as a flow without a condition
+        'if a b else c': '[<Flow_t: <Keyword_t: if>: [<Identifier_t: a>] [<Identifier_t: b>]>, <Operator_t: `else`>, <Flow_t: None: None [<Identifier_t: c>]>]',
+        'loop a b else if c d else e': (
+            '[<Flow_t: <Keyword_t: loop>: [<Identifier_t: a>] [<Identifier_t: b>]>, <Operator_t: `else`>, '
+            '<Flow_t: <Keyword_t: if>: [<Identifier_t: c>] [<Identifier_t: d>]>, <Operator_t: `else`>, <Flow_t: None: None [<Identifier_t: e>]>]'
+        ),
+
+        # op chains, broadcasts and combined assignments
+        'x = a * -b': '[<Identifier_t: x>, <Operator_t: `=`>, <Identifier_t: a>, <OpChain_t: *->, <Identifier_t: b>]',
+        'x = 1 - - 1': '[<Identifier_t: x>, <Operator_t: `=`>, <Integer_t: 1>, <OpChain_t: -->, <Integer_t: 1>]',
+        'a .+ b': '[<Identifier_t: a>, <VectorizedOp_t: <Operator_t: `.`>, <Operator_t: `+`>>, <Identifier_t: b>]',
+        'a .* -b': '[<Identifier_t: a>, <VectorizedOp_t: <Operator_t: `.`>, <OpChain_t: *->>, <Identifier_t: b>]',
+        'x += 1': '[<Identifier_t: x>, <CombinedAssignmentOp_t: <Operator_t: `+`>, <Operator_t: `=`>>, <Integer_t: 1>]',
+        'x .+= 1': '[<Identifier_t: x>, <CombinedAssignmentOp_t: <VectorizedOp_t: <Operator_t: `.`>, <Operator_t: `+`>>, <Operator_t: `=`>>, <Integer_t: 1>]',
+        'x *= -1': '[<Identifier_t: x>, <CombinedAssignmentOp_t: <Operator_t: `*`>, <Operator_t: `=`>>, <Operator_t: `-`>, <Integer_t: 1>]',
+
+        # juxtaposes narrowed next to ranges, ellipses, type params and backticks
+        '[1..10)': '[<Block_t: [<Integer_t: 1>, <RangeJuxtapose_t>, <DotDot_t>, <RangeJuxtapose_t>, <Integer_t: 10>)>]',
+        'x = ..5': '[<Identifier_t: x>, <Operator_t: `=`>, <Undefined_t>, <RangeJuxtapose_t>, <DotDot_t>, <RangeJuxtapose_t>, <Integer_t: 5>]',
+        'x = a..': '[<Identifier_t: x>, <Operator_t: `=`>, <Identifier_t: a>, <RangeJuxtapose_t>, <DotDot_t>]',
+        'f(a...)': '[<Identifier_t: f>, <Juxtapose_t>, <Block_t: (<Identifier_t: a>, <EllipsisJuxtapose_t>, <DotDotDot_t>)>]',
+        '[...a]': '[<Block_t: [<DotDotDot_t>, <EllipsisJuxtapose_t>, <Identifier_t: a>]>]',
+        'f<T>': '[<Identifier_t: f>, <TypeParamJuxtapose_t>, <TypeParam_t: `<<Identifier_t: T>>`>]',
+        'x = `f': '[<Identifier_t: x>, <Operator_t: `=`>, <Backticks_t: `>, <BackticksJuxtapose_t>, <Identifier_t: f>]',
+        'x = f`': '[<Identifier_t: x>, <Operator_t: `=`>, <Identifier_t: f>, <BackticksJuxtapose_t>, <Backticks_t: `>]',
+
+        # several of the above next to each other
+        'a..b .+= -1': (
+            '[<Identifier_t: a>, <RangeJuxtapose_t>, <DotDot_t>, <RangeJuxtapose_t>, <Identifier_t: b>, '
+            '<CombinedAssignmentOp_t: <VectorizedOp_t: <Operator_t: `.`>, <Operator_t: `+`>>, <Operator_t: `=`>>, <Operator_t: `-`>, <Integer_t: 1>]'
+        ),
+    }
+    for src, expected in cases.items():
+        actual = processed(src)
+        assert actual == expected, f'post processing {src!r}\nexpected: {expected}\nactual:   {actual}'
+
+    assert processed('a...b').startswith('ValueError: ERROR: ellipsis operator <DotDotDot_t> must be juxtaposed on either zero or one side')
+
+
+# tokens (or error) of post processing each example, generated with the original unfused post_process
+expected_examples = json.loads((Path(__file__).parent / 'postok_examples.json').read_text())
+
+
+@patch.object(pdb, 'set_trace', unimplemented) # unimplemented keyword expressions stop in the debugger
+def test_post_process_examples():
+    paths = sorted(example_root.glob('*.dewy'))
+    assert sorted(expected_examples) == [path.name for path in paths], 'examples changed, regenerate postok_examples.json'
+    for path in paths:
+        actual = processed(path.read_text())
+        assert actual == expected_examples[path.name], f'post processing {path.name}\nexpected: {expected_examples[path.name]}\nactual:   {actual}'
+
+
+if __name__ == '__main__':
+    test_post_process()
+    test_post_process_examples()
@@ -0,0 +1,70 @@
+from contextlib import redirect_stderr, redirect_stdout
+from io import StringIO
+from pathlib import Path
+from tempfile import TemporaryDirectory
+import json
+from ..backend import python
+from ..backend.python import python_interpreter
+from ..syntax import Loop, Mod
+from ..utils import Options
+from ..profiler import Profiler, source_loc
+
+
+src = 'x = 0\nloop i in [0..50) {\n    x = x + i % 7\n}\nprintl"{x}"\n'
+
+
+def run(path: Path, profile: Path | None) -> tuple[str, str]:
+    """stdout and stderr of running the program"""
+    out, err = StringIO(), StringIO()
+    with redirect_stdout(out), redirect_stderr(err):
+        python_interpreter(path, [], Options(tokens=False, verbose=False, cache=False, profile=profile))
+    return out.getvalue(), err.getvalue()
+
+
+def test_profile():
+    with TemporaryDirectory() as tmp:
+        path, output = Path(tmp) / 'sum.dewy', Path(tmp) / 'profile.json'
+        path.write_text(src)
+
+        expected, _ = run(path, None)
+        actual, report = run(path, output)
+        assert actual == expected, f'profiling changed the output: {actual!r} != {expected!r}'
+        assert python.evaluate.__name__ == 'evaluate', 'evaluate was left instrumented'
+
+        for stage in ['tokenize', 'post_process', 'top_level_parse', 'post_parse', 'fold_constants', 'evaluate']:
+            assert f'\n{stage} ' in f'\n{report}', f'stage {stage} missing from the report\n{report}'
+        # the modulo is the first thing on line 3 that comes from the source (`i`)
+        assert f'{path}:3:13' in report, f'hot spot missing from the report\n{report}'
+
+        profile = json.loads(output.read_text())
+        frames = profile['shared']['frames']
+        names = [p['name'] for p in profile['profiles']]
+        assert names == ['stages', 'evaluate'], names
+        sampled = profile['profiles'][1]
+        assert len(sampled['samples']) == len(sampled['weights'])
+        assert {'name': 'Mod', 'file': str(path), 'line': 3, 'col': 13} in frames, frames
+
+
+def test_node_timings():
+    profiler = Profiler()
+    tokens = python.tokenize(src)
+    python.post_process(tokens)
+    ast = python.post_parse(python.top_level_parse(tokens))
+    assert source_loc(ast) == (0, 0)
+
+    with redirect_stdout(StringIO()), profiler.instrument(python):
+        python.evaluate_stream([ast], Options(tokens=False, verbose=False))
+
+    timings = profiler.node_timings()
+    assert timings[Loop].count == 1
+    assert timings[Mod].count == 50
+    for ast_type, t in timings.items():
+        assert t.self <= t.total + 1e-9, f'{ast_type.__name__} self time is more than its total time'
+    # the self times of everything make up the time of the whole program
+    assert abs(sum(t.self for t in timings.values()) - timings[type(ast)].total) < 1e-6
+
+
+if __name__ == '__main__':
+    test_profile()
+    test_node_timings()
+    print('profile tests passed')
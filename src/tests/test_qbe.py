@@ -0,0 +1,72 @@
+from ..tokenizer import tokenize
+from ..postok import post_process
+from ..parser import top_level_parse
+from ..postparse import post_parse
+from ..backend.qbe import qbe
+from ..backend.qbe.qbe import top_level_compile, build, shim_path
+from ..utils import Options
+from pathlib import Path
+from tempfile import TemporaryDirectory
+from unittest.mock import patch
+import re
+import shutil
+import subprocess
+
+
+def ssa(src: str) -> str:
+    tokens = tokenize(src)
+    post_process(tokens)
+    return str(top_level_compile(post_parse(top_level_parse(tokens))))
+
+
+def test_unboxed_shifts():
+    # qbe takes shift counts mod 64, so only counts known to be in [0, 61) are shifted inline
+    inline = ssa('x = 5 << 3\ny = x >> 2\nprintl"{y}"')
+    assert '=l shl 5, 3' in inline and '=l sar' in inline and '$__val_sh' not in inline, inline
+    for src in ['x = 1 << 70\nprintl"{x}"', 'n = 3\nx = 1 << n\nprintl"{x}"', 'x = 1 >> 61\nprintl"{x}"']:
+        out = ssa(src)
+        assert '$__val_shl' in out or '$__val_shr' in out, f'{src!r} was shifted inline\n{out}'
+
+
+def test_unboxed_literal_limit():
+    # literals in unboxed expressions have the same 61-bit limit as tagged ones
+    for src in ['x = (1 << 60) + 1\nprintl"{x}"', 'x = 1 + 1\nprintl"{x}"']:
+        ssa(src)
+    try:
+        ssa('x = 1152921504606846976 + 1\nprintl"{x}"')
+    except NotImplementedError:
+        pass
+    else:
+        assert False, 'a 62-bit literal was compiled'
+
+
+# Ints past 61 bits, which unboxed arithmetic has to wrap the same way as the tagged runtime ops
+overflow_src = 'a = 1152921504606846975\nb = a + 1\nprintl"{b} {b >? a}"\ny = (1 << 59) * 4\nprintl"{y} {y >? 0}"\n'
+overflow_output = '-1152921504606846976 false\n0 false\n'
+
+def run_qbe(src: str) -> str:
+    with TemporaryDirectory(prefix='dewy_') as build_dir:
+        exe = build(src, Path(build_dir), shim_path, Options(tokens=False, verbose=False, fold=False))
+        return subprocess.run([str(exe)], capture_output=True, text=True, check=True).stdout
+
+
+def test_unboxed_wrapping():
+    # every unboxed add/mul result is sign extended from 61 bits before it's used
+    out = ssa(overflow_src)
+    for inst in ('add', 'mul'):
+        for result in re.findall(rf'(%t\.\d+) =l {inst} ', out):
+            assert re.search(rf'=l shl {result}, 3\n\s+%t\.\d+ =l sar %t\.\d+, 3', out), f'{inst} result {result} is used without wrapping\n{out}'
+
+    if shutil.which('qbe') is None or shutil.which('cc') is None:
+        print('qbe or cc not found, only checked the generated SSA for unboxed wrapping')
+        return
+    unboxed = run_qbe(overflow_src)
+    with patch.object(qbe, 'unboxed_repr', lambda t: None):
+        boxed = run_qbe(overflow_src)
+    assert unboxed == boxed == overflow_output, f'unboxed: {unboxed!r}, boxed: {boxed!r}, expected: {overflow_output!r}'
+
+
+if __name__ == '__main__':
+    test_unboxed_shifts()
+    test_unboxed_literal_limit()
+    test_unboxed_wrapping()
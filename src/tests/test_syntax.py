@@ -0,0 +1,61 @@
+from copy import deepcopy
+from unittest.mock import patch
+from ..tokenizer import tokenize
+from ..postok import post_process
+from ..parser import top_level_parse
+from ..postparse import post_parse
+from .. import syntax, dtypes, postparse, parser
+from ..backend import python
+from ..syntax import AST, Int, Bool, Add, void, undefined, make_int, make_bool, true, false
+from .programs import example_root, unimplemented, run_program
+import pdb
+
+
+def test_nodes_are_slotted():
+    for module in (syntax, dtypes, postparse, parser, python):
+        for cls in vars(module).values():
+            if isinstance(cls, type) and issubclass(cls, AST):
+                assert '__dict__' not in dir(cls), f'{cls.__name__} instances have a __dict__'
+
+    node = Add(Int(1), Int(2))
+    assert [key for key, _ in node.__iter_members__()] == ['left', 'right']
+    assert str(node) == '1 + 2'
+
+
+@patch.object(pdb, 'set_trace', unimplemented)
+def test_deepcopy_examples():
+    for path in sorted(example_root.glob('*.dewy')):
+        try:
+            tokens = tokenize(path.read_text())
+            post_process(tokens)
+            ast = post_parse(top_level_parse(tokens))
+        except Exception:
+            continue # only files that parse
+        copy = deepcopy(ast)
+        assert copy == ast and repr(copy) == repr(ast), f'deepcopy changed the AST of {path.name}'
+    assert deepcopy(void) is void and deepcopy(undefined) is undefined
+
+
+def test_interned_values():
+    assert make_bool(True) is true and make_bool(False) is false and true == Bool(True)
+    assert make_int(5) is make_int(5) and make_int(-128) is make_int(-128)
+    assert make_int(10**6) == Int(10**6)
+    assert all(make_int(i).val == i for i in range(-200, 1100))
+
+
+@patch.object(pdb, 'set_trace', unimplemented)
+def test_interned_examples_match_fresh():
+    # the examples behave the same when every runtime Int/Bool is a fresh node
+    for path in sorted(example_root.glob('*.dewy')):
+        actual = run_program(path)
+        with patch.object(python, 'make_int', Int), patch.object(python, 'make_bool', Bool):
+            expected = run_program(path)
+        assert actual == expected, f'interned values behaved differently on {path.name}\nexpected: {expected}\nactual:   {actual}'
+    assert make_int(2 ** -1) == Int(0.5)
+
+
+if __name__ == '__main__':
+    test_nodes_are_slotted()
+    test_deepcopy_examples()
+    test_interned_values()
+    test_interned_examples_match_fresh()
@@ -1,5 +1,6 @@
 from abc import ABC
 import inspect
+import re
 from typing import Callable, Type, Generator
 from types import UnionType
 from functools import lru_cache
@@ -382,33 +383,40 @@ number_bases = {
 # units = #actually units should probably not be specific tokens, but recognized identifiers since the user can make their own units
 
 
-def peek_eat(cls: Type[Token], whitelist: list[Type[Token]] | None = None, blacklist: list[Type[Token]] | None = None):
+# characters a token may start with: a collection of characters, a predicate on a single character, or None for any character
+FirstChars = str | set[str] | Callable[[str], bool] | None
+
+
+def peek_eat(cls: Type[Token], whitelist: list[Type[Token]] | None = None, blacklist: list[Type[Token]] | None = None, first: FirstChars = None):
     """
     Decorator for functions that eat tokens, but only return how many characters would make up the token.
+    Eat functions are called as eat_func(src, i) to match the token starting at src[i], so matching doesn't copy the source.
     Makes function return include constructor for token class that it tries to eat, in tupled with return.
 
     whitelist and blacklist can be used to specify parent token contexts that may or may not consume this type as a child
+    first is the set of characters the token can start with. The function is only tried at positions starting with one of them
     """
     assert issubclass(cls, Token), f"cls must be a subclass of Token, but got {cls}"
     if whitelist is not None and blacklist is not None:
         raise ValueError("cannot specify both whitelist and blacklist")
 
-    def decorator(eat_func: Callable[[str], int | None]):
-        def wrapper(src: str) -> tuple[int | None, Type[Token]]:
-            return eat_func(src), cls
+    def decorator(eat_func: Callable[[str, int], int | None]):
+        def wrapper(src: str, i: int) -> tuple[int | None, Type[Token]]:
+            return eat_func(src, i), cls
         wrapper._is_peek_eat_decorator = True  # make it easy to check if a function has this decorator
         wrapper._eat_func = eat_func
         wrapper._token_cls = cls
         wrapper._whitelist = whitelist
         wrapper._blacklist = blacklist
+        wrapper._first = first
         return wrapper
     return decorator
 
 # TODO: full eat probably won't need to take the class as an argument, since the function will know how to construct the token itself
 
 
-def full_eat(whitelist: list[Type[Token]] | None = None, blacklist: list[Type[Token]] | None = None):
-    def decorator(eat_func: Callable[[str], tuple[int, Token] | None]):
+def full_eat(whitelist: list[Type[Token]] | None = None, blacklist: list[Type[Token]] | None = None, first: FirstChars = None):
+    def decorator(eat_func: Callable[[str, int], tuple[int, Token] | None]):
         """
         Decorator for functions that eat tokens, and return the token itself if successful.
         TBD what this actually does...for now, largely keep unmodified, but attach the metadata to the wrapped function
@@ -426,6 +434,7 @@ def full_eat(whitelist: list[Type[Token]] | None = None, blacklist: list[Type[To
         wrapper._token_cls = cls
         wrapper._whitelist = whitelist
         wrapper._blacklist = blacklist
+        wrapper._first = first
 
         return wrapper
     return decorator
@@ -455,57 +464,90 @@ def get_func_precedences(funcs: tuple[Callable]) -> tuple[int, ...]:
     return tuple(precedence.get(func._token_cls, 0) for func in funcs)
 
 
-@peek_eat(WhiteSpace_t)
-def eat_line_comment(src: str) -> int | None:
+def can_start_with(func: Callable, c: str) -> bool:
+    first = func._first
+    if first is None:
+        return True
+    if callable(first):
+        return first(c)
+    return c in first
+
+
+def case_insensitive(words: list[str]) -> Callable[[str], bool]:
+    """predicate for characters that could start one of words when compared case-insensitively"""
+    letters = {word[0] for word in words}
+    return lambda c: c.lower()[:1] in letters
+
+
+class DispatchTable(dict):
+    """
+    Maps the next character of the source to the eat functions that could match there, and their precedences,
+    so that each step of tokenizing only runs the few functions that can possibly succeed.
+    Entries are filled in the first time a character is seen
+    """
+
+    def __init__(self, funcs: tuple[Callable, ...]):
+        super().__init__()
+        self.funcs = funcs
+
+    def __missing__(self, c: str) -> tuple[tuple[Callable, ...], tuple[int, ...]]:
+        funcs = tuple(func for func in self.funcs if can_start_with(func, c))
+        self[c] = entry = (funcs, get_func_precedences(funcs))
+        return entry
+
+
+@lru_cache()
+def get_dispatch_table(context: Type[Token]) -> DispatchTable:
+    return DispatchTable(get_contextual_eat_funcs(context))
+
+
+@peek_eat(WhiteSpace_t, first='/')
+def eat_line_comment(src: str, i: int) -> int | None:
     """eat a line comment, return the number of characters eaten"""
-    if src.startswith('//'):
-        try:
-            return src.index('\n') + 1
-        except ValueError:
-            return len(src)
+    if src.startswith('//', i):
+        end = src.find('\n', i)
+        return end - i + 1 if end != -1 else len(src) - i
     return None
 
 
-@peek_eat(WhiteSpace_t)
-def eat_block_comment(src: str) -> int | None:
+block_comment_delims = re.compile(r'/\{|\}/')
+
+
+@peek_eat(WhiteSpace_t, first='/')
+def eat_block_comment(src: str, i: int) -> int | None:
     """
     Eat a block comment, return the number of characters eaten
     Block comments are of the form /{ ... }/ and can be nested.
     """
-    if not src.startswith("/{"):
+    if not src.startswith("/{", i):
         return None
 
     nesting_level = 0
-    i = 0
 
-    while i < len(src):
-        if src[i:].startswith('/{'):
+    for match in block_comment_delims.finditer(src, i):
+        if match.group() == '/{':
             nesting_level += 1
-            i += 2
-        elif src[i:].startswith('}/'):
+        else:
             nesting_level -= 1
-            i += 2
-
             if nesting_level == 0:
-                return i
-        else:
-            i += 1
+                return match.end() - i
 
     raise ValueError("unterminated block comment")
     # return None
 
 
-@peek_eat(WhiteSpace_t)
-def eat_whitespace(src: str) -> int | None:
+whitespace_pattern = re.compile(r'\s+')
+
+
+@peek_eat(WhiteSpace_t, first=str.isspace)
+def eat_whitespace(src: str, i: int) -> int | None:
     """Eat whitespace, return the number of characters eaten"""
-    i = 0
-    while i < len(src) and src[i].isspace():
-        i += 1
-    return i if i > 0 else None
+    match = whitespace_pattern.match(src, i)
+    return match.end() - i if match else None
 
 
-@peek_eat(Keyword_t)
-def eat_keyword(src: str) -> int | None:
+@peek_eat(Keyword_t, first=case_insensitive(keywords))
+def eat_keyword(src: str, i: int) -> int | None:
     """
     Eat a reserved keyword, return the number of characters eaten
 
@@ -516,7 +558,7 @@ def eat_keyword(src: str) -> int | None:
 
     max_len = max(len(keyword) for keyword in keywords)
 
-    lower_src = src[:max_len].lower()
+    lower_src = src[i:i+max_len].lower()
     for keyword in keywords:
         if lower_src.startswith(keyword):
             # TBD if we need to check that the next character is not an identifier character
@@ -535,8 +577,15 @@ start_characters = (alpha | greek | misc) - {'?'}
 continue_characters = (alpha | digits | greek | misc)
 
 
-@peek_eat(Identifier_t)
-def eat_identifier(src: str) -> int | None:
+def char_class(chars: set[str]) -> str:
+    return '[' + ''.join(re.escape(c) for c in sorted(chars)) + ']'
+
+
+identifier_pattern = re.compile(f'{char_class(start_characters)}{char_class(continue_characters)}*')
+
+
+@peek_eat(Identifier_t, first=start_characters)
+def eat_identifier(src: str, i: int) -> int | None:
     """
     Eat an identifier, return the number of characters eaten
 
@@ -546,38 +595,36 @@ def eat_identifier(src: str) -> int | None:
     - may use (TODO enumerate the full chars list somewhere. for now copying from python)
 
     """
-    if not src[0] in start_characters:
+    match = identifier_pattern.match(src, i)
+    if match is None:
         return None
 
-    i = 1
-    while i < len(src) and src[i] in continue_characters:
-        i += 1
-
     # while last character is ?, remove it
-    while i > 1 and src[i-1] == '?':
-        i -= 1
+    end = match.end()
+    while end > i + 1 and src[end-1] == '?':
+        end -= 1
 
-    return i
+    return end - i
 
 
-@peek_eat(Hashtag_t)
-def eat_hashtag(src: str) -> int | None:
+@peek_eat(Hashtag_t, first='#')
+def eat_hashtag(src: str, i: int) -> int | None:
     """
     Eat a hashtag, return the number of characters eaten
 
     hashtags are special identifiers that start with #
     """
 
-    if src.startswith('#'):
-        i, _ = eat_identifier(src[1:])
-        if i is not None:
-            return i + 1
+    if src.startswith('#', i):
+        n, _ = eat_identifier(src, i+1)
+        if n is not None:
+            return n + 1
 
     return None
 
 
-@peek_eat(Escape_t, whitelist=[String_t])
-def eat_escape(src: str) -> int | None:
+@peek_eat(Escape_t, whitelist=[String_t], first='\\')
+def eat_escape(src: str, i: int) -> int | None:
     r"""
     Eat an escape sequence, return the number of characters eaten
     Escape sequences must be either a known escape sequence:
@@ -599,29 +646,33 @@ def eat_escape(src: str) -> int | None:
     - \m converts to just a single character m
     - etc.
     """
-    if not src.startswith('\\'):
+    if not src.startswith('\\', i):
         return None
 
-    if len(src) == 1:
+    if i + 1 == len(src):
         raise ValueError("unterminated escape sequence")
 
-    if src[1] in 'uU':
-        i = 2
-        while i < len(src) and src[i].isxdigit():
-            i += 1
-        if i == 2:
+    if src[i+1] in 'uU':
+        j = i + 2
+        while j < len(src) and src[j].isxdigit():
+            j += 1
+        if j == i + 2:
             raise ValueError("invalid unicode escape sequence")
-        return i
+        return j - i
 
-    # if src[1] in 'nrtbfva0':
+    # if src[i+1] in 'nrtbfva0':
     #     return 2
 
     # all other escape sequences (known or unknown) are just a single character
     return 2
 
 
-@full_eat()
-def eat_string(src: str) -> tuple[int, String_t] | None:
+# the next place inside a string (by its delimiter) where a chunk of regular characters ends
+string_chunk_ends = {delim: re.compile(rf'[\\{{]|{re.escape(delim)}') for delim in ['"""', "'''", '"', "'"]}
+
+
+@full_eat(first='\'"')
+def eat_string(src: str, i: int) -> tuple[int, String_t] | None:
     r"""
     strings are delimited with either single (') or double quotes (")
     the character portion of a string may contain any character except the delimiter, \, or {.
@@ -635,33 +686,37 @@ def eat_string(src: str) -> tuple[int, String_t] | None:
     """
 
     # determine the starting delimiter, or exit if there is none
-    if src.startswith('"""') or src.startswith("'''"):
-        delim = src[:3]
-        i = 3
-    elif src.startswith('"') or src.startswith("'"):
-        delim = src[0]
-        i = 1
+    if src.startswith('"""', i) or src.startswith("'''", i):
+        delim = src[i:i+3]
+    elif src.startswith('"', i) or src.startswith("'", i):
+        delim = src[i]
     else:
         return None
+    chunk_end = string_chunk_ends[delim]
+    start = i
+    i += len(delim)
 
     # keep track of chunks, and the start index of the current chunk
     chunk_start = i
     body = []
 
     # add character sequences, escapes, and block sections until the end of the string
-    while i < len(src) and not src[i:].startswith(delim):
+    while True:
 
-        # regular characters
-        if src[i] not in '\\{':
-            i += 1
-            continue
+        # skip regular characters
+        match = chunk_end.search(src, i)
+        if match is None:
+            raise ValueError("unterminated string")
+        i = match.start()
+        if src.startswith(delim, i):
+            break
 
         # add the previous chunk before handling the escape/interpolation block
         if i > chunk_start:
             body.append(src[chunk_start:i])
 
         if src[i] == '\\':
-            res, _ = eat_escape(src[i:])
+            res, _ = eat_escape(src, i)
             if res is None:
                 raise ValueError("invalid escape sequence")
             body.append(Escape_t(src[i:i+res]))
@@ -669,7 +724,7 @@ def eat_string(src: str) -> tuple[int, String_t] | None:
 
         else:  # src[i] == '{':
             assert src[i] == '{', "internal error"
-            res, _ = eat_block(src[i:])
+            res, _ = eat_block(src, i)
             if res is None:
                 raise ValueError("invalid block")
             n_eaten, block = res
@@ -679,131 +734,124 @@ def eat_string(src: str) -> tuple[int, String_t] | None:
         # update the chunk start
         chunk_start = i
 
-    if i == len(src):
-        raise ValueError("unterminated string")
-
     # add the final chunk
     if i > chunk_start:
         body.append(src[chunk_start:i])
 
-    return i + len(delim), String_t(body)
+    return i + len(delim) - start, String_t(body)
 
 
-@peek_eat(RawString_t)
-def eat_raw_string(src: str) -> int | None:
+@peek_eat(RawString_t, first='r')
+def eat_raw_string(src: str, i: int) -> int | None:
     """
     raw strings start with `r`, followed by a delimiter, one of ' " ''' or \"""
     raw strings may contain any character except the delimiter.
     Escapes and interpolations are ignored.
     The string ends at the first instance of the delimiter
     """
-    if not src.startswith('r'):
+    if not src.startswith('r', i):
         return None
-    i = 1
+    j = i + 1
 
-    if src[i:].startswith('"""') or src[i:].startswith("'''"):
-        delim = src[i:i+3]
-        i += 3
-    elif src[i:].startswith('"') or src[i:].startswith("'"):
-        delim = src[i]
-        i += 1
+    if src.startswith('"""', j) or src.startswith("'''", j):
+        delim = src[j:j+3]
+    elif src.startswith('"', j) or src.startswith("'", j):
+        delim = src[j]
     else:
         return None
 
-    while i < len(src) and not src[i:].startswith(delim):
-        i += 1
-
-    if i == len(src):
+    end = src.find(delim, j + len(delim))
+    if end == -1:
         raise ValueError("unterminated raw string")
 
-    return i + len(delim)
+    return end + len(delim) - i
 
 
-@peek_eat(Integer_t)
-def eat_integer(src: str) -> int | None:
+@peek_eat(Integer_t, first=str.isdigit)
+def eat_integer(src: str, i: int) -> int | None:
     """
     eat an integer, return the number of characters eaten
     integers are of the form [0-9]+
     """
-    if not src[0].isdigit():
+    if not src[i].isdigit():
         return None
 
-    i = 1
-    while i < len(src) and src[i].isdigit() or src[i] == '_':
-        i += 1
-    return i
+    j = i + 1
+    while j < len(src) and (src[j].isdigit() or src[j] == '_'):
+        j += 1
+    return j - i
 
 
-@peek_eat(BasedNumber_t)
-def eat_based_number(src: str) -> int | None:
+@peek_eat(BasedNumber_t, first='0')
+def eat_based_number(src: str, i: int) -> int | None:
     """
     eat a based number, return the number of characters eaten
 
     based numbers have a (case-insensitive) prefix (0p) identifying the base, and (case-sensitive) allowed digits
     """
     try:
-        digits = number_bases[src[:2].lower()]
+        digits = number_bases[src[i:i+2].lower()]
     except KeyError:
         return None
 
-    i = 2
-    while i < len(src) and src[i] in digits or src[i] == '_':
-        i += 1
+    j = i + 2
+    while j < len(src) and (src[j] in digits or src[j] == '_'):
+        j += 1
 
-    return i if i > 2 else None
+    return j - i if j > i + 2 else None
 
 
-@peek_eat(Undefined_t)
-def eat_undefined(src: str) -> int | None:
+@peek_eat(Undefined_t, first=case_insensitive(['undefined']))
+def eat_undefined(src: str, i: int) -> int | None:
     """
     eat the undefined token, return the number of characters eaten
     """
-    sample = src[:9].lower()
+    sample = src[i:i+9].lower()
     if sample.startswith('undefined'):
         return 9
     return None
 
 
-@peek_eat(Void_t)
-def eat_void(src: str) -> int | None:
+@peek_eat(Void_t, first=case_insensitive(['void']))
+def eat_void(src: str, i: int) -> int | None:
     """
     eat the void token, return the number of characters eaten
     """
-    sample = src[:4].lower()
+    sample = src[i:i+4].lower()
     if sample.startswith('void'):
         return 4
     return None
 
 
-@peek_eat(End_t)
-def eat_end(src: str) -> int | None:
+@peek_eat(End_t, first=case_insensitive(['end']))
+def eat_end(src: str, i: int) -> int | None:
     """
     eat the end token, return the number of characters eaten
     """
-    sample = src[:3].lower()
+    sample = src[i:i+3].lower()
     if sample.startswith('end'):
         return 3
     return None
 
-@peek_eat(New_t)
-def eat_new(src: str) -> int | None:
+@peek_eat(New_t, first=case_insensitive(['new']))
+def eat_new(src: str, i: int) -> int | None:
     """
     eat the new token, return the number of characters eaten
     """
-    sample = src[:3].lower()
+    sample = src[i:i+3].lower()
     if sample.startswith('new'):
         return 3
     return None
 
 
-@peek_eat(Boolean_t)
-def eat_boolean(src: str) -> int | None:
+@peek_eat(Boolean_t, first=case_insensitive(['true', 'false']))
+def eat_boolean(src: str, i: int) -> int | None:
     """
     eat a boolean, return the number of characters eaten
 
     booleans are either true or false (case-insensitive)
     """
-    sample = src[:5].lower()
+    sample = src[i:i+5].lower()
     if sample.startswith('true'):
         return 4
     elif sample.startswith('false'):
@@ -812,8 +860,13 @@ def eat_boolean(src: str) -> int | None:
     return None
 
 
-@peek_eat(Operator_t)
-def eat_operator(src: str) -> int | None:
+# alternatives are tried in order, so these match the longest operator
+operator_pattern = re.compile('|'.join(re.escape(op) for op in operators))
+shift_operator_pattern = re.compile('|'.join(re.escape(op) for op in shift_operators))
+
+
+@peek_eat(Operator_t, first={op[0] for op in operators})
+def eat_operator(src: str, i: int) -> int | None:
     """
     eat a unary or binary operator, return the number of characters eaten
 
@@ -821,14 +874,12 @@ def eat_operator(src: str) -> int | None:
 
     see `operators` for full list of operators
     """
-    for op in operators:
-        if src.startswith(op):
-            return len(op)
-    return None
+    match = operator_pattern.match(src, i)
+    return match.end() - i if match else None
 
 
-@peek_eat(ShiftOperator_t, blacklist=[TypeParam_t])
-def eat_shift_operator(src: str) -> int | None:
+@peek_eat(ShiftOperator_t, blacklist=[TypeParam_t], first={op[0] for op in shift_operators})
+def eat_shift_operator(src: str, i: int) -> int | None:
     """
     eat a shift operator, return the number of characters eaten
 
@@ -837,53 +888,52 @@ def eat_shift_operator(src: str) -> int | None:
 
     see `shift_operators` for full list of operators
     """
-    for op in shift_operators:
-        if src.startswith(op):
-            return len(op)
-    return None
+    match = shift_operator_pattern.match(src, i)
+    return match.end() - i if match else None
 
 
-@peek_eat(Comma_t)
-def eat_comma(src: str) -> int | None:
+@peek_eat(Comma_t, first=',')
+def eat_comma(src: str, i: int) -> int | None:
     """
     eat a comma, return the number of characters eaten
     """
-    return 1 if src.startswith(',') else None
+    return 1 if src.startswith(',', i) else None
 
 
-@peek_eat(DotDot_t)
-def eat_dotdot(src: str) -> int | None:
+@peek_eat(DotDot_t, first='.')
+def eat_dotdot(src: str, i: int) -> int | None:
     """
     eat a dotdot, return the number of characters eaten
     """
-    return 2 if src.startswith('..') else None
+    return 2 if src.startswith('..', i) else None
 
 
-@peek_eat(DotDotDot_t)
-def eat_dotdotdot(src: str) -> int | None:
+@peek_eat(DotDotDot_t, first='.')
+def eat_dotdotdot(src: str, i: int) -> int | None:
     """
     eat a dotdotdot, return the number of characters eaten
     """
-    return 3 if src.startswith('...') else None
+    return 3 if src.startswith('...', i) else None
+
 
+cycle_pattern = re.compile('`+')
 
-@peek_eat(Backticks_t)
-def eat_cycle(src: str) -> int | None:
+
+@peek_eat(Backticks_t, first='`')
+def eat_cycle(src: str, i: int) -> int | None:
     """
     eat one or more cycle operators, return the number of characters eaten
     """
-    i = 0
-    while i < len(src) and src[i] == '`':
-        i += 1
-    return i if i > 0 else None
+    match = cycle_pattern.match(src, i)
+    return match.end() - i if match else None
 
 class EatTracker:
     i: int
     tokens: list[Token]
 
 
-@full_eat()
-def eat_type_param(src: str) -> tuple[int, TypeParam_t] | None:
+@full_eat(first='<')
+def eat_type_param(src: str, i: int) -> tuple[int, TypeParam_t] | None:
     """
     eat a type parameter, return the number of characters eaten and an instance of the TypeParam token
 
@@ -891,17 +941,17 @@ def eat_type_param(src: str) -> tuple[int, TypeParam_t] | None:
     Type parameters may not start with `<<` or contain any shift operators (`<<`, `<<<`, `>>`, `>>>`)
     Internally encountered shift operators are considered to be delimiters for the type parameter
     """
-    if not src.startswith('<') or src.startswith('<<'):
+    if not src.startswith('<', i) or src.startswith('<<', i):
         return None
 
-    i = 1
+    start = i
+    i += 1
     body: list[Token] = []
 
     while i < len(src) and src[i] != '>':
 
-        funcs = get_contextual_eat_funcs(TypeParam_t)
-        precedences = get_func_precedences(funcs)
-        res = get_best_match(src[i:], funcs, precedences)
+        funcs, precedences = get_dispatch_table(TypeParam_t)[src[i]]
+        res = get_best_match(src, i, funcs, precedences)
 
         if res is None:
             return None
@@ -922,26 +972,27 @@ def eat_type_param(src: str) -> tuple[int, TypeParam_t] | None:
     if i == len(src):
         return None
 
-    return i + 1, TypeParam_t(body)
+    return i + 1 - start, TypeParam_t(body)
 
 
-@full_eat()
-def eat_block(src: str, tracker: EatTracker | None = None) -> tuple[int, Block_t] | None:
+@full_eat(first=pair_opening_delims)
+def eat_block(src: str, i: int, tracker: EatTracker | None = None) -> tuple[int, Block_t] | None:
     """
     Eat a block, return the number of characters eaten and an instance of the Block token
 
     blocks are { ... } or ( ... ) and may contain sequences of any other tokens including other blocks
 
-    if return_partial is True, then returns (i, body) in the case where the eat process fails, instead of None
+    if a tracker is given, it is kept updated with the current position in src and the tokens eaten so far (for error reporting)
     """
 
-    if not src or src[0] not in pair_opening_delims:
+    if i >= len(src) or src[i] not in pair_opening_delims:
         return None
 
     # save the opening delimiter
-    left = src[0]
+    left = src[i]
 
-    i = 1
+    start = i
+    i += 1
     body: list[Token] = []
 
     if tracker:
@@ -949,16 +1000,14 @@ def eat_block(src: str, tracker: EatTracker | None = None) -> tuple[int, Block_t
         tracker.tokens = body
 
     while i < len(src) and src[i] not in pair_closing_delims:
-        # run all root eat functions
+        # run the eat functions that can start with the current character
         # if multiple, resolve for best match (TBD... current is longest match + precedence)
         # if no match, return None
 
         # TODO: probably break this inner part into a function that eats the next token, given a list of eat functions
         # could also think about ways to specify other multi-match resolutions, other than longest match + precedence...
-        # run all the eat functions on the current src
-        funcs = get_contextual_eat_funcs(Block_t)
-        precedences = get_func_precedences(funcs)
-        res = get_best_match(src[i:], funcs, precedences)
+        funcs, precedences = get_dispatch_table(Block_t)[src[i]]
+        res = get_best_match(src, i, funcs, precedences)
 
         # if we didn't match anything, return None
         if res is None:
@@ -994,18 +1043,20 @@ def eat_block(src: str, tracker: EatTracker | None = None) -> tuple[int, Block_t
     if tracker:
         tracker.i = i
 
-    return i, Block_t(body, left=left, right=right)
+    return i - start, Block_t(body, left=left, right=right)
 
 
-def get_best_match(src: str, eat_funcs: list, precedences: list[int]) -> tuple[int, Type[Token] | Token] | None:
+def get_best_match(src: str, i: int, eat_funcs: list, precedences: list[int]) -> tuple[int, Type[Token] | Token] | None:
     # TODO: handle selecting between full_eat and peek_eat functions that were successful...
     #      general, just need to clarify the selection order precedence
 
     # may return none if no match
-    # may return (i, token_cls) if peek match
-    # may return (i, token) if full match
+    # may return (n, token_cls) if peek match
+    # may return (n, token) if full match
 
-    matches = [eat_func(src) for eat_func in eat_funcs]
+    matches = [eat_func(src, i) for eat_func in eat_funcs]
+    if all(res is None for res, _cls in matches):
+        return None
 
     # find the longest token that matched. if multiple tied for longest, use the one with the highest precedence.
     # raise an error if multiple tokens tied, and they have the same precedence
@@ -1021,7 +1072,7 @@ def get_best_match(src: str, eat_funcs: list, precedences: list[int]) -> tuple[i
     best = max(matches, key=key)
     ties = [match for match in matches if key(match) == key(best)]
     if len(ties) > 1:
-        raise ValueError(f"multiple tokens matches tied {[match[0][1].__name__ for match in ties]}: {repr(src)}\nPlease disambiguate by providing precedence levels for these tokens.")
+        raise ValueError(f"multiple tokens matches tied {[match[0][1].__name__ for match in ties]}: {repr(src[i:])}\nPlease disambiguate by providing precedence levels for these tokens.")
 
     (res, token_cls), _ = best
 
@@ -1041,18 +1092,19 @@ def get_best_match(src: str, eat_funcs: list, precedences: list[int]) -> tuple[i
     raise ValueError(f"Internal Error: invalid return type from eat function: {res}")
 
 
-def tokenize(src: str) -> list[Token]:
+def tokenize(src: str, first_row: int = 0) -> list[Token]:
+    """tokenize a whole source. first_row is the row number of the first line of src (when src is part of a larger source)"""
 
     # insert src into a block
     src = f'{{\n{src}\n}}'
 
     # convert string to a coordinate string (for keeping track of row/col numbers)
-    src = CoordString(src, anchor=(-1, 0))
+    src = CoordString(src, anchor=(first_row - 1, 0))
 
     # eat tokens for a block
     tracker = EatTracker()
     try:
-        res, _cls = eat_block(src, tracker=tracker)
+        res, _cls = eat_block(src, 0, tracker=tracker)
     except Exception as e:
         raise ValueError(f"failed to tokenize: ```{escape_whitespace(src[tracker.i:])}```.\nCurrent tokens: {tracker.tokens}") from e
 
@@ -1069,6 +1121,25 @@ def tokenize(src: str) -> list[Token]:
     return tokens
 
 
+def top_level_spans(src: str, start: int = 0) -> Generator[tuple[int, int, Type[Token]], None, None]:
+    """
+    Scan the top level tokens of src (not wrapped in a block like tokenize does) from start onward, yielding the
+    (start, stop, token class) of each. Stops at the first point where no token can be completed, e.g. a block or
+    string that is still open at the end of src, so a source that arrives in pieces can be scanned as far as it goes.
+    """
+    while start < len(src):
+        funcs, precedences = get_dispatch_table(Block_t)[src[start]]
+        try:
+            res = get_best_match(src, start, funcs, precedences)
+        except ValueError:
+            return
+        if res is None:
+            return
+        n_eaten, token = res
+        yield start, start + n_eaten, token if isinstance(token, type) else type(token)
+        start += n_eaten
+
+
 def full_traverse_tokens(tokens: list[Token]) -> Generator[tuple[int, Token, list[Token]], int, None]:
     """
     Walk all tokens recursively, allowing for modification of the tokens list as it is traversed.
@@ -1179,9 +1250,9 @@ def validate_functions():
         return_type = signature.return_annotation
 
         # Check if the function has the correct signature
-        if len(param_types) != 1 or param_types[0] != str or return_type != int | None:
+        if param_types != [str, int] or return_type != int | None:
             pdb.set_trace()
-            raise ValueError(f"{func.__name__} has an invalid signature: `{signature}`. Expected `(src: str) -> int | None`")
+            raise ValueError(f"{func.__name__} has an invalid signature: `{signature}`. Expected `(src: str, i: int) -> int | None`")
 
     # Validate the @full_eat function signatures
     full_eat_functions = get_full_eat_funcs_with_name()
@@ -1193,7 +1264,7 @@ def validate_functions():
         return_type = signature.return_annotation
 
         # Check if the function has the correct signature
-        error_message = f"{func.__name__} has an invalid signature: `{signature}`. Expected `(src: str) -> tuple[int, Token] | None`"
+        error_message = f"{func.__name__} has an invalid signature: `{signature}`. Expected `(src: str, i: int) -> tuple[int, Token] | None`"
         if not (isinstance(return_type, UnionType) and len(return_type.__args__) == 2 and type(None) in return_type.__args__):
             raise ValueError(error_message)
         A, B = return_type.__args__
@@ -1201,7 +1272,7 @@ def validate_functions():
             B, A = A, B
         if not (isinstance(A, type(tuple)) and len(A.__args__) == 2 and A.__args__[0] is int and issubclass(A.__args__[1], Token)):
             raise ValueError(error_message)
-        if len(param_types) != 1 or param_types[0] != str:
+        if param_types != [str, int]:
             pdb.set_trace()
             raise ValueError(error_message)
 
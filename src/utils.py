@@ -1,4 +1,6 @@
 from typing import TypeVar, Generic, Callable
+from bisect import bisect_left
+from pathlib import Path
 import pdb
 
 
@@ -8,6 +10,10 @@ from dataclasses import dataclass
 class Options:
     tokens: bool
     verbose: bool
+    cache: bool = True # reuse build artifacts from ~/.cache/dewy (compiled backends' executables, the python backend's parsed ASTs)
+    closures: bool = False # python backend: compile each top level expression into python closures before running it
+    fold: bool = True # fold constant expressions and resolve statically decided branches after post parsing (see postparse.fold_constants)
+    profile: Path | None = None # time each stage (and, for the python backend, each evaluation), writing a speedscope profile here (see profiler.py)
     #TODO: other command line options
 
 
@@ -15,9 +21,7 @@ def wrap_coords(method: Callable):
     def wrapped_method(self, *args, **kwargs):
         result = method(self, *args, **kwargs)
         if isinstance(result, str) and len(result) == len(self):
-            custom_str = CoordString(result)
-            custom_str.row_col_map = self.row_col_map
-            return custom_str
+            return self._with_coords_of(result, self)
         else:
             raise ValueError("coord_string_method must return a string of the same length as the original string")
         return result
@@ -31,68 +35,113 @@ def fail_coords(method: Callable):
     return wrapped_method
 
 
+class LineIndex:
+    """
+    Offsets of the newlines in a source string, used to convert an offset into the source to a (row, column).
+    Built the first time a location is requested, and shared by every CoordString sliced from the same source
+    """
+
+    def __init__(self, text: str, anchor: tuple[int, int]):
+        self.text = text
+        self.anchor = anchor
+        self._newlines: list[int] | None = None
+
+    @property
+    def newlines(self) -> list[int]:
+        if self._newlines is None:
+            newlines = []
+            i = self.text.find('\n')
+            while i != -1:
+                newlines.append(i)
+                i = self.text.find('\n', i + 1)
+            self._newlines = newlines
+        return self._newlines
+
+    def loc(self, offset: int) -> tuple[int, int]:
+        # a newline belongs to the end of its row
+        newlines = self.newlines
+        line = bisect_left(newlines, offset)
+        row, col = self.anchor
+        if line == 0:
+            return row, col + offset
+        return row + line, offset - newlines[line - 1] - 1
+
+
 class CoordString(str):
     """
     Drop-in replacement for str that keeps track of the coordinates of each character in the string
 
-    Identical to normal strings, but attaches the `row_col(i:int) -> tuple[int, int]` method
+    Identical to normal strings, but attaches the `loc(i:int) -> tuple[int, int]` method
     which returns the (row, column) of the character at index i
 
+    Contiguous slices share the line index of the string they came from (plus an offset into it), so slicing doesn't copy
+    any coordinate information. Strings that aren't a contiguous piece of a source (e.g. stepped slices) keep an
+    explicit list of coordinates instead
+
     Args:
         anchor (tuple[int,int], optional): The row and column of the top left of the string. Defaults to (0, 0).
     """
+    __slots__ = ('_index', '_offset', '_coords')
+
     def __new__(cls, *args, anchor: tuple[int, int] = (0, 0), **kwargs):
         self = super().__new__(cls, *args, **kwargs)
-        row, col = anchor
-        self.row_col_map = self._generate_row_col_map(row, col)
+        self._index = LineIndex(str(self), anchor)
+        self._offset = 0
+        self._coords = None
 
         return self
 
-    # TODO: make init so that class recognized .row_col_map as property on instances
-    # def __init__(self, s:str, row_col_map:list[tuple[int,int]]):
-
-    def _generate_row_col_map(self, row=0, col=0) -> list[tuple[int, int]]:
-        row_col_map = []
-        for c in self:
-            if c == '\n':
-                row_col_map.append((row, col))
-                row += 1
-                col = 0
-            else:
-                row_col_map.append((row, col))
-                col += 1
-        return row_col_map
+    @staticmethod
+    def _view(s: str, index: LineIndex, offset: int) -> 'CoordString':
+        view = str.__new__(CoordString, s)
+        view._index = index
+        view._offset = offset
+        view._coords = None
+        return view
+
+    @staticmethod
+    def _with_coords_of(s: str, source: 'CoordString', start: int = 0) -> 'CoordString':
+        """s with the coordinates of the characters of source from start onward"""
+        if source._coords is None:
+            return CoordString._view(s, source._index, source._offset + start)
+        return CoordString.from_existing(s, source._coords[start:start+len(s)])
 
     def __getitem__(self, key):
         if isinstance(key, slice):
             sliced_str = super().__getitem__(key)
-            sliced_row_col_map = self.row_col_map[key]
-            custom_str = CoordString(sliced_str)
-            custom_str.row_col_map = sliced_row_col_map
-            return custom_str
+            start, stop, step = key.indices(len(self))
+            if step == 1:
+                return self._with_coords_of(sliced_str, self, start)
+            return CoordString.from_existing(sliced_str, [self.loc(i) for i in range(start, stop, step)])
         return super().__getitem__(key)
 
     def loc(self, index):
-        return self.row_col_map[index]
+        if self._coords is not None:
+            return self._coords[index]
+        if index < 0:
+            index += len(self)
+        if not 0 <= index < len(self):
+            raise IndexError("CoordString index out of range")
+        return self._index.loc(self._offset + index)
+
+    @property
+    def row_col_map(self) -> list[tuple[int, int]]:
+        return [self.loc(i) for i in range(len(self))]
 
     @staticmethod
     def from_existing(new_str: str, old_coords: list[tuple[int, int]]) -> 'CoordString':
-        new_coord_str = CoordString(new_str)
-        new_coord_str.row_col_map = old_coords
+        new_coord_str = CoordString._view(new_str, None, 0)
+        new_coord_str._coords = old_coords
         return new_coord_str
 
     # wrappers for string methods that should return CoordStrings
     def lstrip(self, *args, **kwargs):
         result = super().lstrip(*args, **kwargs)
-        custom_str = CoordString(result)
-        custom_str.row_col_map = self.row_col_map[len(self)-len(result):]
-        return custom_str
+        return self._with_coords_of(result, self, len(self)-len(result))
 
     def rstrip(self, *args, **kwargs):
         result = super().rstrip(*args, **kwargs)
-        custom_str = CoordString(result)
-        custom_str.row_col_map = self.row_col_map[:len(result)]
-        return custom_str
+        return self._with_coords_of(result, self)
 
     def strip(self, *args, **kwargs):
         return self.lstrip(*args, **kwargs).rstrip(*args, **kwargs)